@@ -10,10 +10,13 @@ log_section "Applying patches to FFmpeg source"
 FFMPEG_C="$FFMPEG_SRC_DIR/fftools/ffmpeg.c"
 FFMPEG_H="$FFMPEG_SRC_DIR/fftools/ffmpeg.h"
 OPT_COMMON_C="$FFMPEG_SRC_DIR/fftools/opt_common.c"
+PROTOCOLS_C="$FFMPEG_SRC_DIR/libavformat/protocols.c"
+LIBAVFORMAT_MAKEFILE="$FFMPEG_SRC_DIR/libavformat/Makefile"
 
 # Track if we need to apply any patches
 NEED_FFMPEG_PATCH=true
 NEED_OPT_COMMON_PATCH=true
+NEED_SHIM_PROTOCOL_PATCH=true
 
 # Check if ffmpeg.c patch is already applied
 if grep -q "ffmpeg_reset" "$FFMPEG_C" 2>/dev/null; then
@@ -27,8 +30,14 @@ if grep -q "library_program_name" "$OPT_COMMON_C" 2>/dev/null; then
   NEED_OPT_COMMON_PATCH=false
 fi
 
+# Check if the shim protocol is already registered
+if grep -q "ff_shim_protocol" "$PROTOCOLS_C" 2>/dev/null; then
+  log "shim protocol patch already applied"
+  NEED_SHIM_PROTOCOL_PATCH=false
+fi
+
 # Exit if all patches are already applied
-if [ "$NEED_FFMPEG_PATCH" = false ] && [ "$NEED_OPT_COMMON_PATCH" = false ]; then
+if [ "$NEED_FFMPEG_PATCH" = false ] && [ "$NEED_OPT_COMMON_PATCH" = false ] && [ "$NEED_SHIM_PROTOCOL_PATCH" = false ]; then
   log "All patches already applied, skipping..."
   exit 0
 fi
@@ -202,6 +211,45 @@ else
   log "opt_common.c already patched or not found, skipping..."
 fi
 
+# ============================================================================
+# Add the shim protocol - lets the CFFmpegCLI shim serve "shim:" URLs
+# ============================================================================
+
+if [ "$NEED_SHIM_PROTOCOL_PATCH" = true ]; then
+  log "Adding shim protocol to libavformat..."
+
+  cp "$PATCHES_DIR/libavformat/shimio.c" "$FFMPEG_SRC_DIR/libavformat/shimio.c"
+  cp "$PROTOCOLS_C" "$PROTOCOLS_C.orig"
+  cp "$LIBAVFORMAT_MAKEFILE" "$LIBAVFORMAT_MAKEFILE.orig"
+
+  # configure builds its protocol list from the extern declarations in protocols.c,
+  # so declaring the protocol there is enough to get CONFIG_SHIM_PROTOCOL enabled.
+  PROTOCOL_MARKER="extern const URLProtocol ff_file_protocol;"
+  MAKEFILE_MARKER="OBJS-\$(CONFIG_FILE_PROTOCOL)"
+
+  if [[ "$OSTYPE" == "darwin"* ]]; then
+    sed -i '' "/$PROTOCOL_MARKER/a\\
+extern const URLProtocol ff_shim_protocol;
+" "$PROTOCOLS_C"
+    sed -i '' "/$MAKEFILE_MARKER/a\\
+OBJS-\$(CONFIG_SHIM_PROTOCOL)               += shimio.o
+" "$LIBAVFORMAT_MAKEFILE"
+  else
+    sed -i "/$PROTOCOL_MARKER/a extern const URLProtocol ff_shim_protocol;" "$PROTOCOLS_C"
+    sed -i "/$MAKEFILE_MARKER/a OBJS-\$(CONFIG_SHIM_PROTOCOL)               += shimio.o" "$LIBAVFORMAT_MAKEFILE"
+  fi
+
+  # Verify patch was applied
+  if ! grep -q "ff_shim_protocol" "$PROTOCOLS_C" || ! grep -q "shimio.o" "$LIBAVFORMAT_MAKEFILE"; then
+    log "ERROR: Failed to add shim protocol"
+    mv "$PROTOCOLS_C.orig" "$PROTOCOLS_C"
+    mv "$LIBAVFORMAT_MAKEFILE.orig" "$LIBAVFORMAT_MAKEFILE"
+    exit 1
+  fi
+
+  log "Successfully added shim protocol"
+fi
+
 # Clean up backup files (optional - keep them for reference)
 # rm "$FFMPEG_C.orig" "$FFMPEG_H.orig"
 
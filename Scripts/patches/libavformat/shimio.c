@@ -0,0 +1,111 @@
+/*
+ * Shim I/O protocol for iOS library usage.
+ *
+ * Forwards "shim:" URLs to callbacks installed by the host application, so
+ * the host can provide custom input and output streams to fftools, which
+ * only accepts URLs. The host never needs libavformat internals: the
+ * callback table uses plain C types and negative errno values.
+ */
+
+#include <errno.h>
+
+#include "libavutil/error.h"
+#include "avformat.h"
+#include "avio.h"
+#include "url.h"
+
+typedef struct FFShimIOCallbacks {
+    int (*open)(const char *url, int flags, void **opaque, int *is_streamed);
+    int (*read)(void *opaque, unsigned char *buf, int size);
+    int (*write)(void *opaque, const unsigned char *buf, int size);
+    int64_t (*seek)(void *opaque, int64_t pos, int whence);
+    int (*close)(void *opaque);
+} FFShimIOCallbacks;
+
+void avpriv_shimio_set_callbacks(const FFShimIOCallbacks *callbacks);
+
+static FFShimIOCallbacks shim_callbacks;
+static int shim_callbacks_set;
+
+void avpriv_shimio_set_callbacks(const FFShimIOCallbacks *callbacks)
+{
+    if (callbacks) {
+        shim_callbacks = *callbacks;
+        shim_callbacks_set = 1;
+    } else {
+        shim_callbacks_set = 0;
+    }
+}
+
+typedef struct ShimContext {
+    void *opaque;
+} ShimContext;
+
+static int shim_open(URLContext *h, const char *url, int flags)
+{
+    ShimContext *c = h->priv_data;
+    int is_streamed = 0;
+    int ret;
+
+    if (!shim_callbacks_set || !shim_callbacks.open)
+        return AVERROR(ENOSYS);
+
+    ret = shim_callbacks.open(url, flags & AVIO_FLAG_READ_WRITE, &c->opaque, &is_streamed);
+    if (ret < 0)
+        return ret;
+
+    h->is_streamed = is_streamed;
+    return 0;
+}
+
+static int shim_read(URLContext *h, unsigned char *buf, int size)
+{
+    ShimContext *c = h->priv_data;
+    int ret;
+
+    if (!shim_callbacks.read)
+        return AVERROR(ENOSYS);
+
+    ret = shim_callbacks.read(c->opaque, buf, size);
+    return ret == 0 ? AVERROR_EOF : ret;
+}
+
+static int shim_write(URLContext *h, const unsigned char *buf, int size)
+{
+    ShimContext *c = h->priv_data;
+
+    if (!shim_callbacks.write)
+        return AVERROR(ENOSYS);
+
+    return shim_callbacks.write(c->opaque, buf, size);
+}
+
+static int64_t shim_seek(URLContext *h, int64_t pos, int whence)
+{
+    ShimContext *c = h->priv_data;
+
+    if (!shim_callbacks.seek)
+        return AVERROR(ENOSYS);
+
+    return shim_callbacks.seek(c->opaque, pos, whence & ~AVSEEK_FORCE);
+}
+
+static int shim_close(URLContext *h)
+{
+    ShimContext *c = h->priv_data;
+
+    if (!shim_callbacks.close)
+        return 0;
+
+    return shim_callbacks.close(c->opaque);
+}
+
+const URLProtocol ff_shim_protocol = {
+    .name           = "shim",
+    .url_open       = shim_open,
+    .url_read       = shim_read,
+    .url_write      = shim_write,
+    .url_seek       = shim_seek,
+    .url_close      = shim_close,
+    .priv_data_size = sizeof(ShimContext),
+};
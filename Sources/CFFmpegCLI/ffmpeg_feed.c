@@ -0,0 +1,252 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// --- Caller-fed input streams ---
+//
+// "shim:feed/<id>" is a non-seekable input whose bytes the caller pushes with ffmpeg_feed_write
+// while the job runs. A bounded ring buffer sits between the two: writers block (or, for
+// non-blocking writes, return short) while it is full, and the demuxer blocks while it is empty
+// until more data, end of stream, or an abort arrives. Waits wake periodically to notice job
+// cancellation, so a job reading from a stalled producer can still be cancelled.
+
+#define FEED_MAX 64
+#define FEED_MIN_CAPACITY (64 * 1024)
+#define FEED_POLL_US 100000
+
+typedef struct {
+    unsigned generation;  // bumped each time the slot is handed out, kept across frees
+    int in_use;
+    int released;
+    int reader_open;
+    int reader_closed;
+    int finished;
+    int error;
+
+    unsigned char *ring;
+    int64_t capacity;
+    int64_t read_total;    // bytes handed to the demuxer
+    int64_t write_total;   // bytes accepted from the caller
+} feed;
+
+static pthread_mutex_t g_feed_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_feed_cond = PTHREAD_COND_INITIALIZER;
+static feed g_feeds[FEED_MAX];
+
+static int feed_valid(int id) {
+    return id >= 0 && id < FEED_MAX && g_feeds[id].in_use && !g_feeds[id].released;
+}
+
+static void feed_free_locked(feed *f) {
+    unsigned generation = f->generation;
+    free(f->ring);
+    memset(f, 0, sizeof(*f));
+    f->generation = generation;
+}
+
+static void feed_timed_wait_locked(void) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += FEED_POLL_US * 1000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&g_feed_cond, &g_feed_mutex, &deadline);
+}
+
+int ffmpeg_feed_create(int64_t capacity) {
+    if (capacity < FEED_MIN_CAPACITY) {
+        capacity = FEED_MIN_CAPACITY;
+    }
+    unsigned char *ring = malloc((size_t)capacity);
+    if (!ring) {
+        return -1;
+    }
+    pthread_mutex_lock(&g_feed_mutex);
+    for (int id = 0; id < FEED_MAX; id++) {
+        if (!g_feeds[id].in_use) {
+            unsigned generation = g_feeds[id].generation + 1;
+            memset(&g_feeds[id], 0, sizeof(g_feeds[id]));
+            g_feeds[id].generation = generation;
+            g_feeds[id].in_use = 1;
+            g_feeds[id].ring = ring;
+            g_feeds[id].capacity = capacity;
+            pthread_mutex_unlock(&g_feed_mutex);
+            return id;
+        }
+    }
+    pthread_mutex_unlock(&g_feed_mutex);
+    free(ring);
+    return -1;
+}
+
+int64_t ffmpeg_feed_write(int id, const void *data, int64_t size, int blocking) {
+    const unsigned char *bytes = data;
+    int64_t written = 0;
+
+    pthread_mutex_lock(&g_feed_mutex);
+    if (!feed_valid(id)) {
+        pthread_mutex_unlock(&g_feed_mutex);
+        return -EBADF;
+    }
+    feed *f = &g_feeds[id];
+    // A writer blocked while the feed was released and the slot handed to a new feed must not pour
+    // the rest of its data into the new one.
+    unsigned generation = f->generation;
+    int closed = 0;
+    while (written < size) {
+        // The job stopped reading, the caller aborted or released the feed, or already ended it.
+        if (!feed_valid(id) || f->generation != generation || f->reader_closed || f->error || f->finished) {
+            closed = 1;
+            break;
+        }
+        int64_t room = f->capacity - (f->write_total - f->read_total);
+        if (room == 0) {
+            if (!blocking) {
+                break;
+            }
+            feed_timed_wait_locked();
+            continue;
+        }
+
+        int64_t count = size - written < room ? size - written : room;
+        int64_t offset = f->write_total % f->capacity;
+        int64_t first = f->capacity - offset < count ? f->capacity - offset : count;
+        memcpy(f->ring + offset, bytes + written, (size_t)first);
+        memcpy(f->ring, bytes + written + first, (size_t)(count - first));
+        f->write_total += count;
+        written += count;
+        pthread_cond_broadcast(&g_feed_cond);
+    }
+    pthread_mutex_unlock(&g_feed_mutex);
+    return written == 0 && closed ? -EPIPE : written;
+}
+
+void ffmpeg_feed_finish(int id) {
+    pthread_mutex_lock(&g_feed_mutex);
+    if (feed_valid(id)) {
+        g_feeds[id].finished = 1;
+        pthread_cond_broadcast(&g_feed_cond);
+    }
+    pthread_mutex_unlock(&g_feed_mutex);
+}
+
+void ffmpeg_feed_abort(int id) {
+    pthread_mutex_lock(&g_feed_mutex);
+    if (feed_valid(id)) {
+        g_feeds[id].error = -ECONNABORTED;
+        pthread_cond_broadcast(&g_feed_cond);
+    }
+    pthread_mutex_unlock(&g_feed_mutex);
+}
+
+int64_t ffmpeg_feed_buffered(int id) {
+    pthread_mutex_lock(&g_feed_mutex);
+    int64_t buffered = feed_valid(id) ? g_feeds[id].write_total - g_feeds[id].read_total : -1;
+    pthread_mutex_unlock(&g_feed_mutex);
+    return buffered;
+}
+
+void ffmpeg_feed_release(int id) {
+    pthread_mutex_lock(&g_feed_mutex);
+    if (feed_valid(id)) {
+        feed *f = &g_feeds[id];
+        f->released = 1;
+        f->error = f->error ? f->error : -ECONNABORTED;
+        pthread_cond_broadcast(&g_feed_cond);
+        // An open reader frees the feed when the job closes it.
+        if (!f->reader_open) {
+            feed_free_locked(f);
+        }
+    }
+    pthread_mutex_unlock(&g_feed_mutex);
+}
+
+static int feed_open(const char *path, int flags, void **handle, int *is_streamed) {
+    if (flags & FFIO_FLAG_WRITE) {
+        return -EACCES;
+    }
+    char *end = NULL;
+    long id = strtol(path, &end, 10);
+    if (end == path || *end != '\0') {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&g_feed_mutex);
+    int ret = !feed_valid((int)id) ? -ENOENT : g_feeds[id].reader_open || g_feeds[id].reader_closed ? -EBUSY : 0;
+    if (ret == 0) {
+        g_feeds[id].reader_open = 1;
+    }
+    pthread_mutex_unlock(&g_feed_mutex);
+    if (ret < 0) {
+        return ret;
+    }
+
+    *handle = &g_feeds[id];
+    *is_streamed = 1;
+    return 0;
+}
+
+static int feed_read(void *handle, unsigned char *buf, int size) {
+    feed *f = handle;
+    pthread_mutex_lock(&g_feed_mutex);
+    while (f->write_total == f->read_total && !f->finished && !f->error) {
+        if (ffio_cancel_requested()) {
+            pthread_mutex_unlock(&g_feed_mutex);
+            // Not EINTR: libavformat retries that, and fftools stops interrupting once transcoding runs.
+            return -ECANCELED;
+        }
+        feed_timed_wait_locked();
+    }
+
+    int count = 0;
+    int64_t available = f->write_total - f->read_total;
+    if (f->error && !f->finished) {
+        count = f->error;
+    } else if (available > 0) {
+        count = available < size ? (int)available : size;
+        int64_t offset = f->read_total % f->capacity;
+        int first = f->capacity - offset < count ? (int)(f->capacity - offset) : count;
+        memcpy(buf, f->ring + offset, (size_t)first);
+        memcpy(buf + first, f->ring, (size_t)(count - first));
+        f->read_total += count;
+        pthread_cond_broadcast(&g_feed_cond);
+    }
+    pthread_mutex_unlock(&g_feed_mutex);
+    return count;
+}
+
+static int64_t feed_seek(void *handle, int64_t pos, int whence) {
+    (void)handle;
+    (void)pos;
+    (void)whence;
+    return -ESPIPE;
+}
+
+static int feed_close(void *handle) {
+    feed *f = handle;
+    pthread_mutex_lock(&g_feed_mutex);
+    f->reader_open = 0;
+    f->reader_closed = 1;
+    if (f->released) {
+        feed_free_locked(f);
+    }
+    pthread_cond_broadcast(&g_feed_cond);
+    pthread_mutex_unlock(&g_feed_mutex);
+    return 0;
+}
+
+const ffio_kind ffio_feed_kind = {
+    .name = "feed",
+    .open = feed_open,
+    .read = feed_read,
+    .write = NULL,
+    .seek = feed_seek,
+    .close = feed_close
+};
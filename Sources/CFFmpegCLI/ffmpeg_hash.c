@@ -0,0 +1,464 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// --- SHA-256 ---
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char block[64];
+    size_t used;
+} sha256_ctx;
+
+static const uint32_t k_sha256_round[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_init(sha256_ctx *ctx) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+static void sha256_compress(sha256_ctx *ctx, const unsigned char *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    uint32_t e = ctx->state[4], f = ctx->state[5], g = ctx->state[6], h = ctx->state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) + k_sha256_round[i] + w[i];
+        uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    ctx->state[0] += a; ctx->state[1] += b; ctx->state[2] += c; ctx->state[3] += d;
+    ctx->state[4] += e; ctx->state[5] += f; ctx->state[6] += g; ctx->state[7] += h;
+}
+
+static void sha256_update(sha256_ctx *ctx, const unsigned char *data, size_t size) {
+    ctx->length += size;
+    while (size > 0) {
+        size_t chunk = 64 - ctx->used;
+        if (chunk > size) {
+            chunk = size;
+        }
+        memcpy(ctx->block + ctx->used, data, chunk);
+        ctx->used += chunk;
+        data += chunk;
+        size -= chunk;
+        if (ctx->used == 64) {
+            sha256_compress(ctx, ctx->block);
+            ctx->used = 0;
+        }
+    }
+}
+
+static void sha256_final(sha256_ctx *ctx, unsigned char digest[32]) {
+    uint64_t bits = ctx->length * 8;
+    unsigned char pad = 0x80;
+    sha256_update(ctx, &pad, 1);
+    pad = 0;
+    while (ctx->used != 56) {
+        sha256_update(ctx, &pad, 1);
+    }
+    unsigned char length[8];
+    for (int i = 0; i < 8; i++) {
+        length[i] = (unsigned char)(bits >> (56 - i * 8));
+    }
+    sha256_update(ctx, length, 8);
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (unsigned char)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+static void hex_digest(const unsigned char digest[32], char out[65]) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 32; i++) {
+        out[i * 2] = digits[digest[i] >> 4];
+        out[i * 2 + 1] = digits[digest[i] & 0xf];
+    }
+    out[64] = '\0';
+}
+
+// --- Hashing output sinks ---
+//
+// The file is hashed in fixed-size blocks as the muxer writes it. Writes at the frontier feed the
+// running block hash; a write behind the frontier (a muxer seeking back to patch a header) or past
+// it (a gap) marks the affected blocks dirty, and only those blocks are read back at close.
+
+#define HASH_BLOCK_SIZE ((int64_t)4 << 20)
+#define HASH_MAX_OUTPUTS 64
+
+typedef struct {
+    int in_use;
+    int writer_open;
+    int finished;
+    char *path;
+    int64_t frontier;
+    sha256_ctx block_ctx;
+    sha256_ctx file_ctx;
+    unsigned char (*digests)[32];
+    unsigned char *dirty;
+    int64_t block_capacity;
+    ffmpeg_output_hash result;
+} hash_output;
+
+// An open shim stream: the writer of a hash output, or a plain reader when the muxer reads back.
+typedef struct {
+    hash_output *output;
+    int fd;
+    int64_t position;
+} hash_stream;
+
+static pthread_mutex_t g_hash_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hash_output g_hash_outputs[HASH_MAX_OUTPUTS];
+
+int ffmpeg_hash_output_create(const char *path) {
+    if (!path || !*path) {
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&g_hash_mutex);
+    for (int id = 0; id < HASH_MAX_OUTPUTS; id++) {
+        hash_output *output = &g_hash_outputs[id];
+        if (output->in_use) {
+            continue;
+        }
+        memset(output, 0, sizeof(*output));
+        output->path = strdup(path);
+        if (!output->path) {
+            pthread_mutex_unlock(&g_hash_mutex);
+            return -ENOMEM;
+        }
+        output->in_use = 1;
+        pthread_mutex_unlock(&g_hash_mutex);
+        return id;
+    }
+    pthread_mutex_unlock(&g_hash_mutex);
+    return -EMFILE;
+}
+
+int ffmpeg_hash_output_finish(int id, ffmpeg_output_hash *result) {
+    if (id < 0 || id >= HASH_MAX_OUTPUTS) {
+        return -EINVAL;
+    }
+    pthread_mutex_lock(&g_hash_mutex);
+    hash_output *output = &g_hash_outputs[id];
+    if (!output->in_use) {
+        pthread_mutex_unlock(&g_hash_mutex);
+        return -EINVAL;
+    }
+    if (output->writer_open) {
+        pthread_mutex_unlock(&g_hash_mutex);
+        return -EBUSY;
+    }
+    int ret = output->finished ? 0 : -ENOENT;
+    if (ret == 0 && result) {
+        *result = output->result;
+    }
+    free(output->path);
+    memset(output, 0, sizeof(*output));
+    pthread_mutex_unlock(&g_hash_mutex);
+    return ret;
+}
+
+static int hash_ensure_blocks(hash_output *output, int64_t end) {
+    int64_t needed = (end + HASH_BLOCK_SIZE - 1) / HASH_BLOCK_SIZE + 1;
+    if (needed <= output->block_capacity) {
+        return 0;
+    }
+    int64_t capacity = output->block_capacity ? output->block_capacity : 64;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    unsigned char (*digests)[32] = realloc(output->digests, (size_t)capacity * 32);
+    if (!digests) {
+        return -ENOMEM;
+    }
+    output->digests = digests;
+    unsigned char *dirty = realloc(output->dirty, (size_t)capacity);
+    if (!dirty) {
+        return -ENOMEM;
+    }
+    memset(dirty + output->block_capacity, 0, (size_t)(capacity - output->block_capacity));
+    output->dirty = dirty;
+    output->block_capacity = capacity;
+    return 0;
+}
+
+static void hash_mark_dirty(hash_output *output, int64_t start, int64_t end) {
+    for (int64_t block = start / HASH_BLOCK_SIZE; block <= (end - 1) / HASH_BLOCK_SIZE; block++) {
+        output->dirty[block] = 1;
+    }
+}
+
+// Feed bytes written exactly at the frontier into the running block and file hashes.
+static void hash_advance(hash_output *output, const unsigned char *data, int64_t size) {
+    sha256_update(&output->file_ctx, data, (size_t)size);
+    while (size > 0) {
+        int64_t block_end = (output->frontier / HASH_BLOCK_SIZE + 1) * HASH_BLOCK_SIZE;
+        int64_t chunk = block_end - output->frontier;
+        if (chunk > size) {
+            chunk = size;
+        }
+        sha256_update(&output->block_ctx, data, (size_t)chunk);
+        output->frontier += chunk;
+        data += chunk;
+        size -= chunk;
+        if (output->frontier == block_end) {
+            sha256_final(&output->block_ctx, output->digests[block_end / HASH_BLOCK_SIZE - 1]);
+            sha256_init(&output->block_ctx);
+        }
+    }
+}
+
+static int hash_open(const char *path, int flags, void **handle, int *is_streamed) {
+    // URLs look like "shim:hash/<id>/<name>"; the name only carries the extension for format guessing.
+    char *end = NULL;
+    long id = strtol(path, &end, 10);
+    if (end == path || *end != '/' || id < 0 || id >= HASH_MAX_OUTPUTS) {
+        return -EINVAL;
+    }
+
+    hash_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        return -ENOMEM;
+    }
+
+    pthread_mutex_lock(&g_hash_mutex);
+    hash_output *output = &g_hash_outputs[id];
+    int ret = 0;
+    if (!output->in_use) {
+        ret = -ENOENT;
+    } else if (!(flags & FFIO_FLAG_WRITE)) {
+        // Muxers such as mov with +faststart reopen their output for reading.
+        stream->fd = open(output->path, O_RDONLY);
+        ret = stream->fd < 0 ? -errno : 0;
+    } else if (output->writer_open || output->finished) {
+        ret = -EBUSY;
+    } else {
+        stream->fd = open(output->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        ret = stream->fd < 0 ? -errno : 0;
+        if (ret == 0) {
+            stream->output = output;
+            output->writer_open = 1;
+            output->result.sequential = 1;
+            sha256_init(&output->block_ctx);
+            sha256_init(&output->file_ctx);
+        }
+    }
+    pthread_mutex_unlock(&g_hash_mutex);
+
+    if (ret < 0) {
+        free(stream);
+        return ret;
+    }
+    *handle = stream;
+    *is_streamed = 0;
+    return 0;
+}
+
+static int hash_write(void *handle, const unsigned char *buf, int size) {
+    hash_stream *stream = handle;
+    hash_output *output = stream->output;
+    if (!output) {
+        return -EBADF;
+    }
+    int64_t start = stream->position;
+    int64_t end = start + size;
+
+    for (int done = 0; done < size;) {
+        ssize_t written = pwrite(stream->fd, buf + done, (size_t)(size - done), start + done);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        done += (int)written;
+    }
+    stream->position = end;
+    output->result.bytes_written += size;
+
+    int ret = hash_ensure_blocks(output, end);
+    if (ret < 0) {
+        return ret;
+    }
+
+    // The frontier is always the file size: every write that ends past it moves it.
+    if (start < output->frontier) {
+        int64_t overlap_end = end < output->frontier ? end : output->frontier;
+        hash_mark_dirty(output, start, overlap_end);
+        output->result.sequential = 0;
+        if (end > output->frontier) {
+            hash_advance(output, buf + (output->frontier - start), end - output->frontier);
+        }
+    } else if (start > output->frontier) {
+        // Blocks touched by the gap are recomputed at close; the running block hash restarts at
+        // `end` and only matters again from the next block boundary.
+        hash_mark_dirty(output, output->frontier, end + 1);
+        output->result.sequential = 0;
+        output->frontier = end;
+        sha256_init(&output->block_ctx);
+    } else {
+        hash_advance(output, buf, size);
+    }
+    return size;
+}
+
+static int hash_read(void *handle, unsigned char *buf, int size) {
+    hash_stream *stream = handle;
+    ssize_t count;
+    do {
+        count = pread(stream->fd, buf, (size_t)size, stream->position);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+        return -errno;
+    }
+    stream->position += count;
+    return (int)count;
+}
+
+static int64_t hash_seek(void *handle, int64_t pos, int whence) {
+    hash_stream *stream = handle;
+    int64_t size = stream->output ? stream->output->frontier : lseek(stream->fd, 0, SEEK_END);
+    if (whence == FFIO_SEEK_SIZE) {
+        return size;
+    }
+    int64_t base = whence == SEEK_CUR ? stream->position : whence == SEEK_END ? size : 0;
+    if (base + pos < 0) {
+        return -EINVAL;
+    }
+    stream->position = base + pos;
+    return stream->position;
+}
+
+static int hash_rehash_block(hash_stream *stream, int64_t block, unsigned char *scratch) {
+    hash_output *output = stream->output;
+    int64_t start = block * HASH_BLOCK_SIZE;
+    int64_t length = output->frontier - start < HASH_BLOCK_SIZE ? output->frontier - start : HASH_BLOCK_SIZE;
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+    for (int64_t done = 0; done < length;) {
+        ssize_t count = pread(stream->fd, scratch, (size_t)(length - done), start + done);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return count < 0 ? -errno : -EIO;
+        }
+        sha256_update(&ctx, scratch, (size_t)count);
+        done += count;
+    }
+    sha256_final(&ctx, output->digests[block]);
+    output->result.bytes_rehashed += length;
+    return 0;
+}
+
+static int hash_finish_output(hash_stream *stream) {
+    hash_output *output = stream->output;
+    int ret = hash_ensure_blocks(output, output->frontier);
+    if (ret < 0) {
+        return ret;
+    }
+
+    int64_t block_count = (output->frontier + HASH_BLOCK_SIZE - 1) / HASH_BLOCK_SIZE;
+    if (output->frontier % HASH_BLOCK_SIZE != 0) {
+        sha256_final(&output->block_ctx, output->digests[block_count - 1]);
+    }
+
+    unsigned char *scratch = NULL;
+    for (int64_t block = 0; block < block_count; block++) {
+        if (!output->dirty[block]) {
+            continue;
+        }
+        if (!scratch && !(scratch = malloc((size_t)HASH_BLOCK_SIZE))) {
+            return -ENOMEM;
+        }
+        ret = hash_rehash_block(stream, block, scratch);
+        if (ret < 0) {
+            break;
+        }
+    }
+    free(scratch);
+    if (ret < 0) {
+        return ret;
+    }
+
+    // The content hash is the SHA-256 of the concatenated block digests, so it can be verified
+    // block by block during upload.
+    sha256_ctx ctx;
+    unsigned char digest[32];
+    sha256_init(&ctx);
+    sha256_update(&ctx, (const unsigned char *)output->digests, (size_t)block_count * 32);
+    sha256_final(&ctx, digest);
+    hex_digest(digest, output->result.content_hash);
+
+    if (output->result.sequential) {
+        sha256_final(&output->file_ctx, digest);
+        hex_digest(digest, output->result.sha256);
+    }
+    output->result.bytes_total = output->frontier;
+    return 0;
+}
+
+static int hash_close(void *handle) {
+    hash_stream *stream = handle;
+    hash_output *output = stream->output;
+    int ret = output ? hash_finish_output(stream) : 0;
+    close(stream->fd);
+
+    if (output) {
+        free(output->digests);
+        free(output->dirty);
+        pthread_mutex_lock(&g_hash_mutex);
+        output->digests = NULL;
+        output->dirty = NULL;
+        output->block_capacity = 0;
+        output->writer_open = 0;
+        output->finished = ret == 0;
+        pthread_mutex_unlock(&g_hash_mutex);
+    }
+    free(stream);
+    return ret;
+}
+
+const ffio_kind ffio_hash_kind = {
+    .name = "hash",
+    .open = hash_open,
+    .read = hash_read,
+    .write = hash_write,
+    .seek = hash_seek,
+    .close = hash_close
+};
@@ -0,0 +1,128 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- HTTP input over the shared connection pool ---
+//
+// "shim:http/<http(s) URL>" reads a remote file with range requests made by the registered
+// fetcher, whose connections outlive the ffmpeg run. The read buffer starts small so probing
+// fetches little, doubles with every sequential refill, and drops back after a seek.
+
+#define HTTP_MIN_CHUNK ((int64_t)64 * 1024)
+#define HTTP_MAX_CHUNK ((int64_t)4 << 20)
+
+typedef struct {
+    char *url;
+    int64_t size;       // -1 when the server did not report it
+    int64_t position;
+    unsigned char *buffer;
+    int64_t buffer_start;
+    int64_t buffer_size;
+    int64_t chunk;
+} http_stream;
+
+static int http_open(const char *path, int flags, void **handle, int *is_streamed) {
+    if (flags & FFIO_FLAG_WRITE) {
+        return -EACCES;
+    }
+    ffmpeg_http_fetch_func fetch = ffio_http_fetcher();
+    if (!fetch) {
+        return -ENOSYS;
+    }
+
+    http_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream || !(stream->url = strdup(path)) || !(stream->buffer = malloc((size_t)HTTP_MAX_CHUNK))) {
+        if (stream) {
+            free(stream->url);
+        }
+        free(stream);
+        return -ENOMEM;
+    }
+
+    ffmpeg_http_resource resource = { .size = -1 };
+    int64_t ret = fetch(stream->url, 0, 0, NULL, &resource);
+    if (ret < 0) {
+        free(stream->buffer);
+        free(stream->url);
+        free(stream);
+        return (int)ret;
+    }
+    stream->size = resource.size;
+    stream->chunk = HTTP_MIN_CHUNK;
+
+    *handle = stream;
+    *is_streamed = stream->size < 0;
+    return 0;
+}
+
+static int http_read(void *handle, unsigned char *buf, int size) {
+    http_stream *stream = handle;
+    int64_t buffer_end = stream->buffer_start + stream->buffer_size;
+
+    if (stream->position < stream->buffer_start || stream->position >= buffer_end) {
+        if (stream->size >= 0 && stream->position >= stream->size) {
+            return 0;
+        }
+        if (stream->position == buffer_end && stream->buffer_size > 0) {
+            stream->chunk = stream->chunk * 2 > HTTP_MAX_CHUNK ? HTTP_MAX_CHUNK : stream->chunk * 2;
+        } else {
+            stream->chunk = HTTP_MIN_CHUNK;
+        }
+        int64_t length = stream->chunk;
+        if (stream->size >= 0 && stream->position + length > stream->size) {
+            length = stream->size - stream->position;
+        }
+
+        ffmpeg_http_resource resource = { .size = -1 };
+        int64_t fetched = ffio_http_fetcher()(stream->url, stream->position, length, stream->buffer, &resource);
+        if (fetched <= 0) {
+            stream->buffer_size = 0;
+            return (int)fetched;
+        }
+        stream->buffer_start = stream->position;
+        stream->buffer_size = fetched;
+        buffer_end = stream->buffer_start + stream->buffer_size;
+    }
+
+    int64_t count = buffer_end - stream->position;
+    if (count > size) {
+        count = size;
+    }
+    memcpy(buf, stream->buffer + (stream->position - stream->buffer_start), (size_t)count);
+    stream->position += count;
+    return (int)count;
+}
+
+static int64_t http_seek(void *handle, int64_t pos, int whence) {
+    http_stream *stream = handle;
+    if (whence == FFIO_SEEK_SIZE) {
+        return stream->size >= 0 ? stream->size : -ENOSYS;
+    }
+    int64_t base = whence == SEEK_CUR ? stream->position : whence == SEEK_END ? stream->size : 0;
+    if ((whence == SEEK_END && stream->size < 0) || base + pos < 0) {
+        return whence == SEEK_END ? -ENOSYS : -EINVAL;
+    }
+    stream->position = base + pos;
+    return stream->position;
+}
+
+static int http_close(void *handle) {
+    http_stream *stream = handle;
+    free(stream->buffer);
+    free(stream->url);
+    free(stream);
+    return 0;
+}
+
+const ffio_kind ffio_http_kind = {
+    .name = "http",
+    .open = http_open,
+    .read = http_read,
+    .write = NULL,
+    .seek = http_seek,
+    .close = http_close
+};
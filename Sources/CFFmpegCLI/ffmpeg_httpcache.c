@@ -0,0 +1,562 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// --- HTTP range cache ---
+//
+// "shim:httpcache/<http(s) URL>" reads a remote file in fixed-size blocks through the fetcher
+// registered by the Swift layer. Blocks are kept in a memory LRU and, when a directory is
+// configured, on disk, keyed by URL, validator (ETag or Last-Modified) and size. Opening
+// revalidates with one request for the first byte; a changed validator simply selects a different
+// key. Resources without a validator are cached in memory only. A read that misses fetches the
+// whole run of adjacent missing blocks in one range request, and writes them to disk without
+// holding the cache lock. Each tier indexes its blocks in a hash table next to its LRU list.
+
+#define HTTPCACHE_BLOCK_SIZE ((int64_t)256 << 10)
+#define HTTPCACHE_MAX_RUN 16
+#define HTTPCACHE_BUCKETS 4096
+
+typedef struct httpcache_block {
+    struct httpcache_block *prev;
+    struct httpcache_block *next;
+    struct httpcache_block *bucket_next;
+    uint64_t key;
+    int64_t index;
+    int64_t size;
+    unsigned char *data;  // NULL for disk entries
+} httpcache_block;
+
+typedef struct {
+    httpcache_block *head;  // most recently used
+    httpcache_block *tail;
+    int64_t bytes;
+    int64_t limit;
+    httpcache_block *buckets[HTTPCACHE_BUCKETS];
+} httpcache_lru;
+
+typedef struct {
+    char *url;
+    uint64_t key;
+    int64_t size;
+    char validator[FFMPEG_HTTP_VALIDATOR_SIZE];
+    int use_disk;  // only with a validator: without one a changed file cannot be told apart
+    int64_t position;
+} httpcache_stream;
+
+static pthread_mutex_t g_httpcache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ffmpeg_http_fetch_func g_httpcache_fetch;
+static httpcache_lru g_httpcache_memory = { .limit = (int64_t)32 << 20 };
+static httpcache_lru g_httpcache_disk;
+static int64_t g_httpcache_memory_budget = (int64_t)32 << 20;
+static int g_httpcache_memory_percent = 100;
+static char *g_httpcache_directory;
+static ffmpeg_httpcache_stats g_httpcache_stats;
+
+void ffmpeg_http_set_fetcher(ffmpeg_http_fetch_func fetch) {
+    pthread_mutex_lock(&g_httpcache_mutex);
+    g_httpcache_fetch = fetch;
+    pthread_mutex_unlock(&g_httpcache_mutex);
+}
+
+ffmpeg_http_fetch_func ffio_http_fetcher(void) {
+    pthread_mutex_lock(&g_httpcache_mutex);
+    ffmpeg_http_fetch_func fetch = g_httpcache_fetch;
+    pthread_mutex_unlock(&g_httpcache_mutex);
+    return fetch;
+}
+
+void ffmpeg_httpcache_get_stats(ffmpeg_httpcache_stats *stats) {
+    pthread_mutex_lock(&g_httpcache_mutex);
+    *stats = g_httpcache_stats;
+    pthread_mutex_unlock(&g_httpcache_mutex);
+}
+
+// FNV-1a over URL, validator and size.
+static uint64_t httpcache_key(const char *url, const char *validator, int64_t size) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (const char *p = url; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    hash = (hash ^ '\n') * 1099511628211ULL;
+    for (const char *p = validator; *p; p++) {
+        hash = (hash ^ (unsigned char)*p) * 1099511628211ULL;
+    }
+    for (int shift = 0; shift < 64; shift += 8) {
+        hash = (hash ^ (unsigned char)((uint64_t)size >> shift)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void httpcache_block_path(const char *directory, uint64_t key, int64_t index, char *path, size_t size) {
+    snprintf(path, size, "%s/%016llx-%lld.blk", directory, (unsigned long long)key, (long long)index);
+}
+
+// --- LRU lists ---
+
+static void lru_unlink(httpcache_lru *lru, httpcache_block *block) {
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        lru->head = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    } else {
+        lru->tail = block->prev;
+    }
+    block->prev = block->next = NULL;
+    lru->bytes -= block->size;
+}
+
+static void lru_push_front(httpcache_lru *lru, httpcache_block *block) {
+    block->prev = NULL;
+    block->next = lru->head;
+    if (lru->head) {
+        lru->head->prev = block;
+    } else {
+        lru->tail = block;
+    }
+    lru->head = block;
+    lru->bytes += block->size;
+}
+
+static httpcache_block **lru_bucket(httpcache_lru *lru, uint64_t key, int64_t index) {
+    uint64_t hash = (key ^ ((uint64_t)index * 0x9e3779b97f4a7c15ULL)) * 1099511628211ULL;
+    return &lru->buckets[(hash >> 32) % HTTPCACHE_BUCKETS];
+}
+
+// Add a block to the list and the index.
+static void lru_add(httpcache_lru *lru, httpcache_block *block) {
+    httpcache_block **bucket = lru_bucket(lru, block->key, block->index);
+    block->bucket_next = *bucket;
+    *bucket = block;
+    lru_push_front(lru, block);
+}
+
+// Take a block out of the list and the index; the caller frees it.
+static void lru_remove(httpcache_lru *lru, httpcache_block *block) {
+    for (httpcache_block **link = lru_bucket(lru, block->key, block->index); *link; link = &(*link)->bucket_next) {
+        if (*link == block) {
+            *link = block->bucket_next;
+            break;
+        }
+    }
+    block->bucket_next = NULL;
+    lru_unlink(lru, block);
+}
+
+static httpcache_block *lru_lookup(httpcache_lru *lru, uint64_t key, int64_t index) {
+    for (httpcache_block *block = *lru_bucket(lru, key, index); block; block = block->bucket_next) {
+        if (block->key == key && block->index == index) {
+            return block;
+        }
+    }
+    return NULL;
+}
+
+// Look a block up and mark it most recently used.
+static httpcache_block *lru_find(httpcache_lru *lru, uint64_t key, int64_t index) {
+    httpcache_block *block = lru_lookup(lru, key, index);
+    if (block) {
+        lru_unlink(lru, block);
+        lru_push_front(lru, block);
+    }
+    return block;
+}
+
+static void lru_evict(httpcache_lru *lru, int on_disk) {
+    while (lru->bytes > lru->limit && lru->tail) {
+        httpcache_block *block = lru->tail;
+        lru_remove(lru, block);
+        if (on_disk && g_httpcache_directory) {
+            char path[1024];
+            httpcache_block_path(g_httpcache_directory, block->key, block->index, path, sizeof(path));
+            unlink(path);
+        }
+        free(block->data);
+        free(block);
+    }
+}
+
+static void lru_clear(httpcache_lru *lru) {
+    while (lru->head) {
+        httpcache_block *block = lru->head;
+        lru_remove(lru, block);
+        free(block->data);
+        free(block);
+    }
+}
+
+int ffmpeg_httpcache_configure(const char *directory, int64_t memory_bytes, int64_t disk_bytes) {
+    pthread_mutex_lock(&g_httpcache_mutex);
+    g_httpcache_memory_budget = memory_bytes;
+    g_httpcache_memory.limit = memory_bytes / 100 * g_httpcache_memory_percent;
+    lru_evict(&g_httpcache_memory, 0);
+
+    lru_clear(&g_httpcache_disk);
+    free(g_httpcache_directory);
+    g_httpcache_directory = directory && *directory ? strdup(directory) : NULL;
+    g_httpcache_disk.limit = disk_bytes;
+
+    // Index blocks left by earlier launches; file order stands in for recency.
+    if (g_httpcache_directory) {
+        DIR *dir = opendir(g_httpcache_directory);
+        struct dirent *entry;
+        while (dir && (entry = readdir(dir))) {
+            unsigned long long key = 0;
+            long long index = 0;
+            char path[1024];
+            struct stat st;
+            if (sscanf(entry->d_name, "%16llx-%lld.blk", &key, &index) != 2) {
+                continue;
+            }
+            snprintf(path, sizeof(path), "%s/%s", g_httpcache_directory, entry->d_name);
+            httpcache_block *block = calloc(1, sizeof(*block));
+            if (!block || stat(path, &st) < 0) {
+                free(block);
+                continue;
+            }
+            block->key = key;
+            block->index = index;
+            block->size = st.st_size;
+            lru_add(&g_httpcache_disk, block);
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        lru_evict(&g_httpcache_disk, 1);
+    }
+    pthread_mutex_unlock(&g_httpcache_mutex);
+    return 0;
+}
+
+int64_t ffio_httpcache_scale_memory(int percent) {
+    pthread_mutex_lock(&g_httpcache_mutex);
+    int64_t before = g_httpcache_memory.bytes;
+    g_httpcache_memory_percent = percent;
+    g_httpcache_memory.limit = g_httpcache_memory_budget / 100 * percent;
+    lru_evict(&g_httpcache_memory, 0);
+    int64_t released = before - g_httpcache_memory.bytes;
+    pthread_mutex_unlock(&g_httpcache_mutex);
+    return released;
+}
+
+void ffmpeg_httpcache_clear(void) {
+    pthread_mutex_lock(&g_httpcache_mutex);
+    lru_clear(&g_httpcache_memory);
+    int64_t limit = g_httpcache_disk.limit;
+    g_httpcache_disk.limit = 0;
+    lru_evict(&g_httpcache_disk, 1);
+    g_httpcache_disk.limit = limit;
+    pthread_mutex_unlock(&g_httpcache_mutex);
+}
+
+// Copy up to `size` bytes at `offset` within a cached block (memory first, then disk) into `buf`.
+// Returns the bytes copied, or -1 on a miss.
+static int64_t httpcache_lookup_locked(uint64_t key, int64_t index, int64_t offset, unsigned char *buf, int64_t size, int use_disk) {
+    httpcache_block *block = lru_find(&g_httpcache_memory, key, index);
+    int from_disk = 0;
+
+    if (!block && use_disk && g_httpcache_directory && (block = lru_find(&g_httpcache_disk, key, index))) {
+        // Promote to memory so later reads of this block skip the file system.
+        httpcache_block *cached = calloc(1, sizeof(*cached));
+        char path[1024];
+        httpcache_block_path(g_httpcache_directory, key, index, path, sizeof(path));
+        int fd = open(path, O_RDONLY);
+        if (cached && fd >= 0 && (cached->data = malloc((size_t)block->size)) &&
+            pread(fd, cached->data, (size_t)block->size, 0) == block->size) {
+            cached->key = key;
+            cached->index = index;
+            cached->size = block->size;
+            lru_add(&g_httpcache_memory, cached);
+            from_disk = 1;
+        } else {
+            // A missing, short or unreadable block file is dropped along with its entry.
+            if (cached) {
+                free(cached->data);
+                free(cached);
+            }
+            lru_remove(&g_httpcache_disk, block);
+            free(block);
+            unlink(path);
+            cached = NULL;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        block = cached;
+    }
+    if (!block) {
+        return -1;
+    }
+
+    int64_t count = block->size - offset;
+    if (count > size) {
+        count = size;
+    }
+    if (count < 0) {
+        count = 0;
+    }
+    memcpy(buf, block->data + offset, (size_t)count);
+    if (from_disk) {
+        g_httpcache_stats.disk_hit_bytes += count;
+        lru_evict(&g_httpcache_memory, 0);
+    } else {
+        g_httpcache_stats.memory_hit_bytes += count;
+    }
+    return count;
+}
+
+static int httpcache_contains_locked(uint64_t key, int64_t index, int use_disk) {
+    return lru_lookup(&g_httpcache_memory, key, index) || (use_disk && lru_lookup(&g_httpcache_disk, key, index));
+}
+
+static void httpcache_store_memory_locked(uint64_t key, int64_t index, const unsigned char *data, int64_t size) {
+    if (lru_lookup(&g_httpcache_memory, key, index)) {
+        return;
+    }
+    httpcache_block *block = calloc(1, sizeof(*block));
+    if (block && (block->data = malloc((size_t)size))) {
+        memcpy(block->data, data, (size_t)size);
+        block->key = key;
+        block->index = index;
+        block->size = size;
+        lru_add(&g_httpcache_memory, block);
+        lru_evict(&g_httpcache_memory, 0);
+    } else {
+        free(block);
+    }
+}
+
+// Write blocks `first`..`first + count - 1` of a fetched run, laid out back to back in `data`, to
+// the disk tier. Called without the cache lock: the files are written first and only then indexed,
+// so no lookup sees a partly written block. If the cache was reconfigured meanwhile, the files are
+// removed again.
+static void httpcache_store_disk(
+    const char *directory,
+    uint64_t key,
+    int64_t first,
+    int64_t count,
+    const unsigned char *data,
+    int64_t last_size
+) {
+    int written_count = 0;
+    int written[HTTPCACHE_MAX_RUN] = {0};
+    for (int64_t i = 0; i < count; i++) {
+        int64_t size = i == count - 1 ? last_size : HTTPCACHE_BLOCK_SIZE;
+        char path[1024];
+        httpcache_block_path(directory, key, first + i, path, sizeof(path));
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t bytes = write(fd, data + i * HTTPCACHE_BLOCK_SIZE, (size_t)size);
+        close(fd);
+        if (bytes == size) {
+            written[i] = 1;
+            written_count++;
+        } else {
+            unlink(path);
+        }
+    }
+    if (!written_count) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_httpcache_mutex);
+    int current = g_httpcache_directory && strcmp(g_httpcache_directory, directory) == 0;
+    for (int64_t i = 0; i < count; i++) {
+        if (!written[i]) {
+            continue;
+        }
+        if (!current) {
+            char path[1024];
+            httpcache_block_path(directory, key, first + i, path, sizeof(path));
+            unlink(path);
+            continue;
+        }
+        if (lru_lookup(&g_httpcache_disk, key, first + i)) {
+            continue;
+        }
+        httpcache_block *entry = calloc(1, sizeof(*entry));
+        if (!entry) {
+            continue;
+        }
+        entry->key = key;
+        entry->index = first + i;
+        entry->size = i == count - 1 ? last_size : HTTPCACHE_BLOCK_SIZE;
+        lru_add(&g_httpcache_disk, entry);
+    }
+    if (current) {
+        lru_evict(&g_httpcache_disk, 1);
+    }
+    pthread_mutex_unlock(&g_httpcache_mutex);
+}
+
+static int httpcache_open(const char *path, int flags, void **handle, int *is_streamed) {
+    if (flags & FFIO_FLAG_WRITE) {
+        return -EACCES;
+    }
+    ffmpeg_http_fetch_func fetch = ffio_http_fetcher();
+    if (!fetch) {
+        return -ENOSYS;
+    }
+
+    httpcache_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream || !(stream->url = strdup(path))) {
+        free(stream);
+        return -ENOMEM;
+    }
+
+    ffmpeg_http_resource resource = { .size = -1 };
+    int64_t ret = fetch(stream->url, 0, 0, NULL, &resource);
+    pthread_mutex_lock(&g_httpcache_mutex);
+    g_httpcache_stats.requests++;
+    pthread_mutex_unlock(&g_httpcache_mutex);
+    if (ret < 0 || resource.size < 0) {
+        free(stream->url);
+        free(stream);
+        return ret < 0 ? (int)ret : -ENOSYS;
+    }
+    stream->size = resource.size;
+    memcpy(stream->validator, resource.validator, sizeof(stream->validator));
+    stream->validator[sizeof(stream->validator) - 1] = '\0';
+    stream->key = httpcache_key(stream->url, stream->validator, stream->size);
+    // Blocks of a resource without ETag or Last-Modified stay in memory: after a relaunch the
+    // disk tier could not tell them from a same-sized new version.
+    stream->use_disk = stream->validator[0] != '\0';
+
+    *handle = stream;
+    *is_streamed = 0;
+    return 0;
+}
+
+// Fetch `index` and the adjacent missing blocks after it in one request, caching all of them.
+static int httpcache_fetch_run(httpcache_stream *stream, int64_t index) {
+    int64_t block_count = (stream->size + HTTPCACHE_BLOCK_SIZE - 1) / HTTPCACHE_BLOCK_SIZE;
+    int64_t run = 1;
+    pthread_mutex_lock(&g_httpcache_mutex);
+    while (run < HTTPCACHE_MAX_RUN && index + run < block_count && !httpcache_contains_locked(stream->key, index + run, stream->use_disk)) {
+        run++;
+    }
+    pthread_mutex_unlock(&g_httpcache_mutex);
+
+    int64_t offset = index * HTTPCACHE_BLOCK_SIZE;
+    int64_t length = run * HTTPCACHE_BLOCK_SIZE;
+    if (offset + length > stream->size) {
+        length = stream->size - offset;
+    }
+    unsigned char *data = malloc((size_t)length);
+    if (!data) {
+        return -ENOMEM;
+    }
+
+    ffmpeg_http_resource resource = { .size = -1 };
+    int64_t fetched = ffio_http_fetcher()(stream->url, offset, length, data, &resource);
+    if (fetched >= 0 && strncmp(resource.validator, stream->validator, sizeof(stream->validator)) != 0) {
+        // The resource changed since it was opened; mixing versions would corrupt the input.
+        fetched = -ESTALE;
+    }
+
+    // Only whole blocks (or the file's final block) are cached.
+    int64_t cached_blocks = fetched > 0 ? fetched / HTTPCACHE_BLOCK_SIZE : 0;
+    int64_t last_size = HTTPCACHE_BLOCK_SIZE;
+    if (fetched > 0 && fetched % HTTPCACHE_BLOCK_SIZE && offset + fetched == stream->size) {
+        last_size = fetched % HTTPCACHE_BLOCK_SIZE;
+        cached_blocks++;
+    }
+
+    char *directory = NULL;
+    pthread_mutex_lock(&g_httpcache_mutex);
+    g_httpcache_stats.requests++;
+    if (fetched > 0) {
+        g_httpcache_stats.fetched_bytes += fetched;
+        for (int64_t i = 0; i < cached_blocks; i++) {
+            int64_t size = i == cached_blocks - 1 ? last_size : HTTPCACHE_BLOCK_SIZE;
+            httpcache_store_memory_locked(stream->key, index + i, data + i * HTTPCACHE_BLOCK_SIZE, size);
+        }
+        if (cached_blocks > 0 && stream->use_disk && g_httpcache_directory && g_httpcache_disk.limit > 0) {
+            directory = strdup(g_httpcache_directory);
+        }
+    }
+    pthread_mutex_unlock(&g_httpcache_mutex);
+    if (directory) {
+        httpcache_store_disk(directory, stream->key, index, cached_blocks, data, last_size);
+        free(directory);
+    }
+    free(data);
+
+    if (fetched < 0) {
+        return (int)fetched;
+    }
+    return fetched > 0 ? 0 : -EIO;
+}
+
+static int httpcache_read(void *handle, unsigned char *buf, int size) {
+    httpcache_stream *stream = handle;
+    if (stream->position >= stream->size) {
+        return 0;
+    }
+    int64_t index = stream->position / HTTPCACHE_BLOCK_SIZE;
+    int64_t offset = stream->position - index * HTTPCACHE_BLOCK_SIZE;
+
+    int64_t count = -1;
+    for (int attempt = 0; attempt < 2 && count < 0; attempt++) {
+        pthread_mutex_lock(&g_httpcache_mutex);
+        count = httpcache_lookup_locked(stream->key, index, offset, buf, size, stream->use_disk);
+        pthread_mutex_unlock(&g_httpcache_mutex);
+        if (count < 0 && attempt == 0) {
+            int ret = httpcache_fetch_run(stream, index);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+    }
+    if (count < 0) {
+        // Nothing could be cached (zero budgets): fetch straight into the caller's buffer.
+        ffmpeg_http_resource resource = { .size = -1 };
+        count = ffio_http_fetcher()(stream->url, stream->position, size, buf, &resource);
+    }
+    if (count > 0) {
+        stream->position += count;
+    }
+    return (int)count;
+}
+
+static int64_t httpcache_seek(void *handle, int64_t pos, int whence) {
+    httpcache_stream *stream = handle;
+    if (whence == FFIO_SEEK_SIZE) {
+        return stream->size;
+    }
+    int64_t base = whence == SEEK_CUR ? stream->position : whence == SEEK_END ? stream->size : 0;
+    if (base + pos < 0) {
+        return -EINVAL;
+    }
+    stream->position = base + pos;
+    return stream->position;
+}
+
+static int httpcache_close(void *handle) {
+    httpcache_stream *stream = handle;
+    free(stream->url);
+    free(stream);
+    return 0;
+}
+
+const ffio_kind ffio_httpcache_kind = {
+    .name = "httpcache",
+    .open = httpcache_open,
+    .read = httpcache_read,
+    .write = NULL,
+    .seek = httpcache_seek,
+    .close = httpcache_close
+};
@@ -0,0 +1,254 @@
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// --- Forward declarations from the patched libavformat (Scripts/patches/libavformat/shimio.c) ---
+
+typedef struct {
+    int (*open)(const char *url, int flags, void **opaque, int *is_streamed);
+    int (*read)(void *opaque, unsigned char *buf, int size);
+    int (*write)(void *opaque, const unsigned char *buf, int size);
+    int64_t (*seek)(void *opaque, int64_t pos, int whence);
+    int (*close)(void *opaque);
+} FFShimIOCallbacks;
+
+void avpriv_shimio_set_callbacks(const FFShimIOCallbacks *callbacks);
+
+// --- Plain local files, the source of wrapping kinds given a path instead of a shim URL ---
+
+typedef struct {
+    int fd;
+    int64_t position;
+} ffio_file;
+
+static int ffio_file_open(const char *path, int flags, void **handle, int *is_streamed) {
+    int mode = (flags & FFIO_FLAG_WRITE) ? ((flags & FFIO_FLAG_READ) ? O_RDWR | O_CREAT : O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+    ffio_file *file = calloc(1, sizeof(*file));
+    if (!file) {
+        return -ENOMEM;
+    }
+    file->fd = open(path, mode, 0644);
+    if (file->fd < 0) {
+        int err = errno;
+        free(file);
+        return -err;
+    }
+    *handle = file;
+    *is_streamed = 0;
+    return 0;
+}
+
+static int ffio_file_read(void *handle, unsigned char *buf, int size) {
+    ffio_file *file = handle;
+    ssize_t count;
+    do {
+        count = pread(file->fd, buf, (size_t)size, file->position);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+        return -errno;
+    }
+    file->position += count;
+    return (int)count;
+}
+
+static int ffio_file_write(void *handle, const unsigned char *buf, int size) {
+    ffio_file *file = handle;
+    ssize_t count;
+    do {
+        count = pwrite(file->fd, buf, (size_t)size, file->position);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+        return -errno;
+    }
+    file->position += count;
+    return (int)count;
+}
+
+static int64_t ffio_file_seek(void *handle, int64_t pos, int whence) {
+    ffio_file *file = handle;
+    struct stat st;
+    if (whence == FFIO_SEEK_SIZE || whence == SEEK_END) {
+        if (fstat(file->fd, &st) < 0) {
+            return -errno;
+        }
+        if (whence == FFIO_SEEK_SIZE) {
+            return st.st_size;
+        }
+    }
+    int64_t base = whence == SEEK_CUR ? file->position : whence == SEEK_END ? st.st_size : 0;
+    if (base + pos < 0) {
+        return -EINVAL;
+    }
+    file->position = base + pos;
+    return file->position;
+}
+
+static int ffio_file_close(void *handle) {
+    ffio_file *file = handle;
+    int ret = close(file->fd) < 0 ? -errno : 0;
+    free(file);
+    return ret;
+}
+
+static const ffio_kind ffio_file_kind = {
+    .name = "file",
+    .open = ffio_file_open,
+    .read = ffio_file_read,
+    .write = ffio_file_write,
+    .seek = ffio_file_seek,
+    .close = ffio_file_close
+};
+
+// --- Dispatch "shim:<kind>/<path>" to the matching kind ---
+
+static const ffio_kind *const g_ffio_kinds[] = {
+    &ffio_hash_kind,
+    &ffio_mem_kind,
+    &ffio_mmap_kind,
+    &ffio_readahead_kind,
+    &ffio_writebehind_kind,
+    &ffio_httpcache_kind,
+    &ffio_http_kind,
+    &ffio_feed_kind,
+    &ffio_progress_kind,
+    &ffio_latency_kind,
+};
+
+// Kinds that exist for tests only, dispatched once ffmpeg_io_enable_test_kinds() was called.
+static const ffio_kind *const g_ffio_test_kinds[] = {
+    &ffio_throttle_kind,
+};
+
+static atomic_int g_ffio_test_kinds_enabled;
+
+void ffmpeg_io_enable_test_kinds(void) {
+    atomic_store(&g_ffio_test_kinds_enabled, 1);
+}
+
+struct ffio_stream {
+    const ffio_kind *kind;
+    void *handle;
+};
+
+static const ffio_kind *ffio_find_kind(const char *url, const char **path) {
+    static const char scheme[] = "shim:";
+    if (strncmp(url, scheme, sizeof(scheme) - 1) != 0) {
+        return NULL;
+    }
+    const char *name = url + sizeof(scheme) - 1;
+    const char *slash = strchr(name, '/');
+    if (!slash) {
+        return NULL;
+    }
+
+    size_t kind_count = sizeof(g_ffio_kinds) / sizeof(g_ffio_kinds[0]);
+    size_t test_count = atomic_load(&g_ffio_test_kinds_enabled) ? sizeof(g_ffio_test_kinds) / sizeof(g_ffio_test_kinds[0]) : 0;
+    for (size_t i = 0; i < kind_count + test_count; i++) {
+        const ffio_kind *kind = i < kind_count ? g_ffio_kinds[i] : g_ffio_test_kinds[i - kind_count];
+        if (strlen(kind->name) == (size_t)(slash - name) && strncmp(kind->name, name, (size_t)(slash - name)) == 0) {
+            *path = slash + 1;
+            return kind;
+        }
+    }
+    return NULL;
+}
+
+static int ffio_open_kind(const ffio_kind *kind, const char *path, int flags, ffio_stream **stream, int *is_streamed) {
+    ffio_stream *opened = calloc(1, sizeof(*opened));
+    if (!opened) {
+        return -ENOMEM;
+    }
+
+    int ret = kind->open(path, flags, &opened->handle, is_streamed);
+    if (ret < 0) {
+        free(opened);
+        return ret;
+    }
+    opened->kind = kind;
+    *stream = opened;
+    return 0;
+}
+
+int ffio_stream_open(const char *url, int flags, ffio_stream **stream, int *is_streamed) {
+    const char *path = NULL;
+    const ffio_kind *kind = ffio_find_kind(url, &path);
+    if (!kind) {
+        if (strncmp(url, "shim:", 5) == 0) {
+            return -ENOENT;
+        }
+        kind = &ffio_file_kind;
+        path = strncmp(url, "file:", 5) == 0 ? url + 5 : url;
+    }
+    return ffio_open_kind(kind, path, flags, stream, is_streamed);
+}
+
+int ffio_stream_read(ffio_stream *stream, unsigned char *buf, int size) {
+    return stream->kind->read ? stream->kind->read(stream->handle, buf, size) : -ENOSYS;
+}
+
+int ffio_stream_write(ffio_stream *stream, const unsigned char *buf, int size) {
+    return stream->kind->write ? stream->kind->write(stream->handle, buf, size) : -ENOSYS;
+}
+
+int64_t ffio_stream_seek(ffio_stream *stream, int64_t pos, int whence) {
+    return stream->kind->seek ? stream->kind->seek(stream->handle, pos, whence) : -ENOSYS;
+}
+
+int ffio_stream_close(ffio_stream *stream) {
+    int ret = stream->kind->close ? stream->kind->close(stream->handle) : 0;
+    free(stream);
+    return ret;
+}
+
+// --- Callbacks handed to libavformat ---
+
+static int ffio_open(const char *url, int flags, void **opaque, int *is_streamed) {
+    const char *path = NULL;
+    const ffio_kind *kind = ffio_find_kind(url, &path);
+    if (!kind) {
+        return -ENOENT;
+    }
+    return ffio_open_kind(kind, path, flags, (ffio_stream **)opaque, is_streamed);
+}
+
+static int ffio_read(void *opaque, unsigned char *buf, int size) {
+    ffio_pressure_pause_point();
+    return ffio_stream_read(opaque, buf, size);
+}
+
+static int ffio_write(void *opaque, const unsigned char *buf, int size) {
+    ffio_pressure_pause_point();
+    return ffio_stream_write(opaque, buf, size);
+}
+
+static int64_t ffio_seek(void *opaque, int64_t pos, int whence) {
+    return ffio_stream_seek(opaque, pos, whence);
+}
+
+static int ffio_close(void *opaque) {
+    return ffio_stream_close(opaque);
+}
+
+static pthread_once_t g_ffio_install_once = PTHREAD_ONCE_INIT;
+
+static void ffio_install_callbacks(void) {
+    static const FFShimIOCallbacks callbacks = {
+        .open = ffio_open,
+        .read = ffio_read,
+        .write = ffio_write,
+        .seek = ffio_seek,
+        .close = ffio_close
+    };
+    avpriv_shimio_set_callbacks(&callbacks);
+}
+
+void ffio_install(void) {
+    pthread_once(&g_ffio_install_once, ffio_install_callbacks);
+}
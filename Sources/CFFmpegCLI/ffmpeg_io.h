@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ffmpeg_wrapper.h"
+
+// Internal interface between the shim I/O dispatcher (ffmpeg_io.c) and the
+// stream kinds that serve "shim:<kind>/<path>" URLs.
+
+// Open flags, matching AVIO_FLAG_READ / AVIO_FLAG_WRITE.
+#define FFIO_FLAG_READ  1
+#define FFIO_FLAG_WRITE 2
+
+// Seek `whence` value asking for the stream size, matching AVSEEK_SIZE.
+#define FFIO_SEEK_SIZE 0x10000
+
+// One kind of shim stream. All callbacks return negative errno values on failure;
+// `read` returns 0 at end of stream.
+typedef struct {
+    const char *name;
+    int (*open)(const char *path, int flags, void **handle, int *is_streamed);
+    int (*read)(void *handle, unsigned char *buf, int size);
+    int (*write)(void *handle, const unsigned char *buf, int size);
+    int64_t (*seek)(void *handle, int64_t pos, int whence);
+    int (*close)(void *handle);
+} ffio_kind;
+
+extern const ffio_kind ffio_hash_kind;
+extern const ffio_kind ffio_mem_kind;
+extern const ffio_kind ffio_mmap_kind;
+extern const ffio_kind ffio_readahead_kind;
+extern const ffio_kind ffio_throttle_kind;  // test kind, see ffmpeg_io_enable_test_kinds
+extern const ffio_kind ffio_writebehind_kind;
+extern const ffio_kind ffio_httpcache_kind;
+extern const ffio_kind ffio_http_kind;
+extern const ffio_kind ffio_feed_kind;
+extern const ffio_kind ffio_progress_kind;
+extern const ffio_kind ffio_latency_kind;
+
+// A stream opened through the dispatcher, for kinds that wrap another source.
+typedef struct ffio_stream ffio_stream;
+
+// Open "shim:<kind>/<path>", or a plain local file path.
+int ffio_stream_open(const char *url, int flags, ffio_stream **stream, int *is_streamed);
+int ffio_stream_read(ffio_stream *stream, unsigned char *buf, int size);
+int ffio_stream_write(ffio_stream *stream, const unsigned char *buf, int size);
+int64_t ffio_stream_seek(ffio_stream *stream, int64_t pos, int whence);
+int ffio_stream_close(ffio_stream *stream);
+
+// The fetcher registered with ffmpeg_http_set_fetcher, or NULL.
+ffmpeg_http_fetch_func ffio_http_fetcher(void);
+
+// Nonzero once cancellation of the running job was requested, for kinds that block.
+int ffio_cancel_requested(void);
+
+// Monotonic clock in microseconds.
+int64_t ffio_now_us(void);
+
+// Progress reports written to "shim:progress/": reset at the start of a job, and the time any
+// counter last advanced, or -1 when the job has not opened a progress URL.
+void ffio_progress_reset(void);
+int64_t ffio_progress_last_advance_us(void);
+
+// Scale the HTTP cache memory budget to `percent` of the configured one, evicting down to it.
+// Returns the bytes freed.
+int64_t ffio_httpcache_scale_memory(int percent);
+
+// Move every memory file to a temporary file on disk. Returns the bytes taken out of memory.
+int64_t ffio_memfile_spill_all(void);
+
+// Memory pressure hooks for the wrapper and the dispatcher: background runs wait before taking the
+// execution slot and at every top-level read or write while pressure is critical. Foreground runs
+// report with queue(+1/-1) while they wait for the slot; a paused background run that sees one
+// cancels itself, and take_yield then tells the wrapper to run it again from the start. begin_job
+// records whether the starting run is background work and returns its thread budget (0 for automatic).
+void ffio_pressure_wait_admission(void);
+void ffio_pressure_queue(int delta);
+int ffio_pressure_take_yield(void);
+int ffio_pressure_begin_job(void);
+void ffio_pressure_pause_point(void);
+int ffio_pressure_paused(void);
+int64_t ffio_pressure_last_resume_us(void);
+
+// Install the dispatcher into libavformat's shim protocol. Safe to call repeatedly.
+void ffio_install(void);
@@ -0,0 +1,164 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+// --- Per-frame latency probes ---
+//
+// "shim:latency/<id>" is passed to -stats_mux_pre with the format "{pts} {tb}". ffmpeg writes and
+// flushes one line per packet as it reaches the muxer. When the input is timestamped with the wall
+// clock (-use_wallclock_as_timestamps 1 and -copyts), a packet's pts is the time its source frame
+// arrived, so the arrival time of the line minus the pts is that frame's latency through decode,
+// filtering, encode and the mux queue.
+
+#define LATENCY_MAX_PROBES 16
+#define LATENCY_LINE_MAX 128
+
+typedef struct {
+    int in_use;
+    int64_t *samples;
+    int64_t count;
+    int64_t capacity;
+} latency_probe;
+
+typedef struct {
+    int id;
+    char line[LATENCY_LINE_MAX];
+    int length;
+} latency_stream;
+
+static pthread_mutex_t g_latency_mutex = PTHREAD_MUTEX_INITIALIZER;
+static latency_probe g_latency_probes[LATENCY_MAX_PROBES];
+
+static int64_t latency_wall_clock_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+int ffmpeg_latency_probe_create(void) {
+    pthread_mutex_lock(&g_latency_mutex);
+    for (int id = 0; id < LATENCY_MAX_PROBES; id++) {
+        if (!g_latency_probes[id].in_use) {
+            memset(&g_latency_probes[id], 0, sizeof(g_latency_probes[id]));
+            g_latency_probes[id].in_use = 1;
+            pthread_mutex_unlock(&g_latency_mutex);
+            return id;
+        }
+    }
+    pthread_mutex_unlock(&g_latency_mutex);
+    return -1;
+}
+
+int64_t ffmpeg_latency_probe_samples(int id, int64_t *latencies_us, int64_t max_count) {
+    pthread_mutex_lock(&g_latency_mutex);
+    if (id < 0 || id >= LATENCY_MAX_PROBES || !g_latency_probes[id].in_use) {
+        pthread_mutex_unlock(&g_latency_mutex);
+        return -1;
+    }
+    latency_probe *probe = &g_latency_probes[id];
+    int64_t copied = probe->count < max_count ? probe->count : max_count;
+    if (latencies_us && copied > 0) {
+        memcpy(latencies_us, probe->samples, (size_t)copied * sizeof(*latencies_us));
+    }
+    int64_t count = probe->count;
+    pthread_mutex_unlock(&g_latency_mutex);
+    return count;
+}
+
+void ffmpeg_latency_probe_release(int id) {
+    pthread_mutex_lock(&g_latency_mutex);
+    if (id >= 0 && id < LATENCY_MAX_PROBES && g_latency_probes[id].in_use) {
+        free(g_latency_probes[id].samples);
+        memset(&g_latency_probes[id], 0, sizeof(g_latency_probes[id]));
+    }
+    pthread_mutex_unlock(&g_latency_mutex);
+}
+
+static void latency_record(int id, const char *line, int64_t arrived_us) {
+    int64_t pts = 0;
+    int num = 0;
+    int den = 0;
+    if (sscanf(line, "%" SCNd64 " %d/%d", &pts, &num, &den) != 3 || num <= 0 || den <= 0) {
+        return;  // packets without a timestamp
+    }
+    int64_t pts_us = (int64_t)((double)pts * num / den * 1000000.0);
+
+    pthread_mutex_lock(&g_latency_mutex);
+    latency_probe *probe = &g_latency_probes[id];
+    if (probe->in_use) {
+        if (probe->count == probe->capacity) {
+            int64_t capacity = probe->capacity ? probe->capacity * 2 : 1024;
+            int64_t *samples = realloc(probe->samples, (size_t)capacity * sizeof(*samples));
+            if (!samples) {
+                pthread_mutex_unlock(&g_latency_mutex);
+                return;
+            }
+            probe->samples = samples;
+            probe->capacity = capacity;
+        }
+        probe->samples[probe->count++] = arrived_us - pts_us;
+    }
+    pthread_mutex_unlock(&g_latency_mutex);
+}
+
+static int latency_open(const char *path, int flags, void **handle, int *is_streamed) {
+    if (!(flags & FFIO_FLAG_WRITE)) {
+        return -EACCES;
+    }
+    char *end = NULL;
+    long id = strtol(path, &end, 10);
+    if (end == path || *end != '\0' || id < 0 || id >= LATENCY_MAX_PROBES) {
+        return -EINVAL;
+    }
+    latency_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        return -ENOMEM;
+    }
+    stream->id = (int)id;
+    *handle = stream;
+    *is_streamed = 1;
+    return 0;
+}
+
+static int latency_write(void *handle, const unsigned char *buf, int size) {
+    latency_stream *stream = handle;
+    int64_t arrived_us = latency_wall_clock_us();
+    for (int i = 0; i < size; i++) {
+        if (buf[i] == '\n') {
+            stream->line[stream->length] = '\0';
+            latency_record(stream->id, stream->line, arrived_us);
+            stream->length = 0;
+        } else if (stream->length < LATENCY_LINE_MAX - 1) {
+            stream->line[stream->length++] = (char)buf[i];
+        }
+    }
+    return size;
+}
+
+static int64_t latency_seek(void *handle, int64_t pos, int whence) {
+    (void)handle;
+    (void)pos;
+    (void)whence;
+    return -ESPIPE;
+}
+
+static int latency_close(void *handle) {
+    free(handle);
+    return 0;
+}
+
+const ffio_kind ffio_latency_kind = {
+    .name = "latency",
+    .open = latency_open,
+    .read = NULL,
+    .write = latency_write,
+    .seek = latency_seek,
+    .close = latency_close
+};
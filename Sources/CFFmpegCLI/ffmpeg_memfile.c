@@ -0,0 +1,457 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// --- Memory-backed intermediate files ---
+//
+// Files live in scopes; "shim:mem/<scope>/<name>" names one of them. On Linux the bytes are
+// kept in a memfd (anonymous shmem, swappable, never on a real file system); elsewhere in a
+// growable heap buffer. Releasing a scope frees every file in it.
+//
+// A scope may be given a memory limit: a write that would take the scope's in-memory bytes past it
+// first moves the file being written to an unlinked temporary file in the spill directory, where it
+// keeps growing. Spilled files are read and written through their descriptor like memfds. Critical
+// memory pressure spills every file at once.
+
+#define MEM_MAX_SCOPES 64
+#define MEM_SPILL_CHUNK (256 * 1024)
+
+typedef struct mem_file {
+    struct mem_file *next;
+    char *name;
+    int fd;
+    unsigned char *data;
+    int64_t size;
+    int64_t capacity;
+    int scope;
+    int open_count;
+    int released;
+    int spilled;  // moved to a temporary file on disk
+} mem_file;
+
+typedef struct {
+    int in_use;
+    mem_file *files;
+    int64_t memory_limit;   // 0 for unlimited
+    char *spill_directory;
+} mem_scope;
+
+typedef struct {
+    mem_file *file;
+    int64_t position;
+} mem_stream;
+
+// One lock guards scopes and file contents; intermediates are written and read by a single job.
+static pthread_mutex_t g_mem_mutex = PTHREAD_MUTEX_INITIALIZER;
+static mem_scope g_mem_scopes[MEM_MAX_SCOPES];
+
+static void mem_file_free(mem_file *file) {
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    free(file->data);
+    free(file->name);
+    free(file);
+}
+
+static mem_file *mem_find_file(int scope, const char *name) {
+    for (mem_file *file = g_mem_scopes[scope].files; file; file = file->next) {
+        if (strcmp(file->name, name) == 0) {
+            return file;
+        }
+    }
+    return NULL;
+}
+
+static int mem_valid_scope(int scope) {
+    return scope >= 0 && scope < MEM_MAX_SCOPES && g_mem_scopes[scope].in_use;
+}
+
+int ffmpeg_memfile_scope_create(void) {
+    pthread_mutex_lock(&g_mem_mutex);
+    for (int scope = 0; scope < MEM_MAX_SCOPES; scope++) {
+        if (!g_mem_scopes[scope].in_use) {
+            g_mem_scopes[scope].in_use = 1;
+            g_mem_scopes[scope].files = NULL;
+            g_mem_scopes[scope].memory_limit = 0;
+            g_mem_scopes[scope].spill_directory = NULL;
+            pthread_mutex_unlock(&g_mem_mutex);
+            return scope;
+        }
+    }
+    pthread_mutex_unlock(&g_mem_mutex);
+    return -EMFILE;
+}
+
+void ffmpeg_memfile_scope_release(int scope) {
+    pthread_mutex_lock(&g_mem_mutex);
+    if (!mem_valid_scope(scope)) {
+        pthread_mutex_unlock(&g_mem_mutex);
+        return;
+    }
+    mem_file *file = g_mem_scopes[scope].files;
+    while (file) {
+        mem_file *next = file->next;
+        // A stream still open (an aborted job) frees its file when it closes.
+        if (file->open_count > 0) {
+            file->released = 1;
+        } else {
+            mem_file_free(file);
+        }
+        file = next;
+    }
+    g_mem_scopes[scope].files = NULL;
+    g_mem_scopes[scope].in_use = 0;
+    free(g_mem_scopes[scope].spill_directory);
+    g_mem_scopes[scope].spill_directory = NULL;
+    pthread_mutex_unlock(&g_mem_mutex);
+}
+
+int ffmpeg_memfile_scope_set_limit(int scope, int64_t memory_limit, const char *spill_directory) {
+    if (memory_limit < 0 || (memory_limit > 0 && !spill_directory)) {
+        return -EINVAL;
+    }
+    char *directory = spill_directory ? strdup(spill_directory) : NULL;
+    if (spill_directory && !directory) {
+        return -ENOMEM;
+    }
+    pthread_mutex_lock(&g_mem_mutex);
+    if (!mem_valid_scope(scope)) {
+        pthread_mutex_unlock(&g_mem_mutex);
+        free(directory);
+        return -ENOENT;
+    }
+    free(g_mem_scopes[scope].spill_directory);
+    g_mem_scopes[scope].spill_directory = directory;
+    g_mem_scopes[scope].memory_limit = memory_limit;
+    pthread_mutex_unlock(&g_mem_mutex);
+    return 0;
+}
+
+int64_t ffmpeg_memfile_size(int scope, const char *name) {
+    pthread_mutex_lock(&g_mem_mutex);
+    mem_file *file = mem_valid_scope(scope) ? mem_find_file(scope, name) : NULL;
+    int64_t size = file ? file->size : -ENOENT;
+    pthread_mutex_unlock(&g_mem_mutex);
+    return size;
+}
+
+static int64_t mem_scope_bytes_locked(int scope) {
+    int64_t total = 0;
+    for (mem_file *file = g_mem_scopes[scope].files; file; file = file->next) {
+        total += file->spilled ? 0 : file->size;
+    }
+    return total;
+}
+
+int64_t ffmpeg_memfile_scope_bytes(int scope) {
+    pthread_mutex_lock(&g_mem_mutex);
+    int64_t total = mem_valid_scope(scope) ? mem_scope_bytes_locked(scope) : 0;
+    pthread_mutex_unlock(&g_mem_mutex);
+    return total;
+}
+
+int64_t ffmpeg_memfile_spilled_bytes(int scope) {
+    pthread_mutex_lock(&g_mem_mutex);
+    int64_t total = 0;
+    if (mem_valid_scope(scope)) {
+        for (mem_file *file = g_mem_scopes[scope].files; file; file = file->next) {
+            total += file->spilled ? file->size : 0;
+        }
+    }
+    pthread_mutex_unlock(&g_mem_mutex);
+    return total;
+}
+
+static int64_t mem_file_read_locked(mem_file *file, int64_t offset, unsigned char *buf, int64_t size) {
+    if (offset >= file->size) {
+        return 0;
+    }
+    if (size > file->size - offset) {
+        size = file->size - offset;
+    }
+    if (file->fd < 0) {
+        memcpy(buf, file->data + offset, (size_t)size);
+        return size;
+    }
+    ssize_t count;
+    do {
+        count = pread(file->fd, buf, (size_t)size, offset);
+    } while (count < 0 && errno == EINTR);
+    return count < 0 ? -errno : count;
+}
+
+int64_t ffmpeg_memfile_read(int scope, const char *name, int64_t offset, void *buffer, int64_t size) {
+    pthread_mutex_lock(&g_mem_mutex);
+    mem_file *file = mem_valid_scope(scope) ? mem_find_file(scope, name) : NULL;
+    int64_t ret = file ? mem_file_read_locked(file, offset, buffer, size) : -ENOENT;
+    pthread_mutex_unlock(&g_mem_mutex);
+    return ret;
+}
+
+static mem_file *mem_file_create_locked(int scope, const char *name) {
+    mem_file *file = calloc(1, sizeof(*file));
+    if (!file || !(file->name = strdup(name))) {
+        free(file);
+        return NULL;
+    }
+    file->fd = -1;
+    file->scope = scope;
+#ifdef __linux__
+    file->fd = memfd_create("ffmpeg-intermediate", MFD_CLOEXEC);
+#endif
+    file->next = g_mem_scopes[scope].files;
+    g_mem_scopes[scope].files = file;
+    return file;
+}
+
+// Move a file's bytes to an unlinked temporary file in `directory`.
+static int mem_file_spill_locked(mem_file *file, const char *directory) {
+    char path[1024];
+    if (snprintf(path, sizeof(path), "%s/ffmpeg-intermediate-XXXXXX", directory) >= (int)sizeof(path)) {
+        return -ENAMETOOLONG;
+    }
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -errno;
+    }
+    unlink(path);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    unsigned char *chunk = file->fd >= 0 ? malloc(MEM_SPILL_CHUNK) : NULL;
+    int ret = file->fd >= 0 && !chunk ? -ENOMEM : 0;
+    for (int64_t done = 0; ret == 0 && done < file->size;) {
+        int64_t size = file->size - done < MEM_SPILL_CHUNK ? file->size - done : MEM_SPILL_CHUNK;
+        const unsigned char *data = file->data + done;
+        if (chunk) {
+            int64_t count = mem_file_read_locked(file, done, chunk, size);
+            if (count <= 0) {
+                ret = count < 0 ? (int)count : -EIO;
+                break;
+            }
+            size = count;
+            data = chunk;
+        }
+        ssize_t written = pwrite(fd, data, (size_t)size, done);
+        if (written < 0 && errno != EINTR) {
+            ret = -errno;
+        } else if (written > 0) {
+            done += written;
+        }
+    }
+    free(chunk);
+    if (ret < 0) {
+        close(fd);
+        return ret;
+    }
+
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    free(file->data);
+    file->data = NULL;
+    file->capacity = 0;
+    file->fd = fd;
+    file->spilled = 1;
+    return 0;
+}
+
+// Spill every in-memory file of a scope; returns the bytes moved.
+static int64_t mem_scope_spill_locked(int scope) {
+    const char *fallback = getenv("TMPDIR");
+    const char *directory = g_mem_scopes[scope].spill_directory;
+    directory = directory ? directory : fallback && *fallback ? fallback : "/tmp";
+    int64_t moved = 0;
+    for (mem_file *file = g_mem_scopes[scope].files; file; file = file->next) {
+        if (!file->spilled && file->size > 0 && mem_file_spill_locked(file, directory) == 0) {
+            moved += file->size;
+        }
+    }
+    return moved;
+}
+
+int64_t ffmpeg_memfile_scope_spill(int scope) {
+    pthread_mutex_lock(&g_mem_mutex);
+    int64_t moved = mem_valid_scope(scope) ? mem_scope_spill_locked(scope) : 0;
+    pthread_mutex_unlock(&g_mem_mutex);
+    return moved;
+}
+
+int64_t ffio_memfile_spill_all(void) {
+    int64_t moved = 0;
+    pthread_mutex_lock(&g_mem_mutex);
+    for (int scope = 0; scope < MEM_MAX_SCOPES; scope++) {
+        if (g_mem_scopes[scope].in_use) {
+            moved += mem_scope_spill_locked(scope);
+        }
+    }
+    pthread_mutex_unlock(&g_mem_mutex);
+    return moved;
+}
+
+static int mem_file_write_locked(mem_file *file, int64_t offset, const unsigned char *buf, int size) {
+    int64_t end = offset + size;
+    mem_scope *scope = &g_mem_scopes[file->scope];
+    if (!file->spilled && !file->released && scope->memory_limit > 0 && end > file->size &&
+        mem_scope_bytes_locked(file->scope) + (end - file->size) > scope->memory_limit) {
+        int ret = mem_file_spill_locked(file, scope->spill_directory);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    if (file->fd >= 0) {
+        for (int done = 0; done < size;) {
+            ssize_t written = pwrite(file->fd, buf + done, (size_t)(size - done), offset + done);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -errno;
+            }
+            done += (int)written;
+        }
+    } else {
+        if (end > file->capacity) {
+            int64_t capacity = file->capacity ? file->capacity : 64 * 1024;
+            while (capacity < end) {
+                capacity *= 2;
+            }
+            unsigned char *data = realloc(file->data, (size_t)capacity);
+            if (!data) {
+                return -ENOMEM;
+            }
+            file->data = data;
+            file->capacity = capacity;
+        }
+        if (offset > file->size) {
+            memset(file->data + file->size, 0, (size_t)(offset - file->size));
+        }
+        memcpy(file->data + offset, buf, (size_t)size);
+    }
+    if (end > file->size) {
+        file->size = end;
+    }
+    return size;
+}
+
+static int mem_open(const char *path, int flags, void **handle, int *is_streamed) {
+    // Paths look like "<scope>/<name>".
+    char *end = NULL;
+    long scope = strtol(path, &end, 10);
+    if (end == path || *end != '/' || end[1] == '\0') {
+        return -EINVAL;
+    }
+    const char *name = end + 1;
+
+    mem_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        return -ENOMEM;
+    }
+
+    pthread_mutex_lock(&g_mem_mutex);
+    int ret = 0;
+    mem_file *file = NULL;
+    if (!mem_valid_scope((int)scope)) {
+        ret = -ENOENT;
+    } else if ((file = mem_find_file((int)scope, name))) {
+        // Opening for writing truncates, like the file protocol.
+        if ((flags & FFIO_FLAG_WRITE) && !(flags & FFIO_FLAG_READ)) {
+            file->size = 0;
+            if (file->fd >= 0 && ftruncate(file->fd, 0) < 0) {
+                ret = -errno;
+            }
+        }
+    } else if (flags & FFIO_FLAG_WRITE) {
+        file = mem_file_create_locked((int)scope, name);
+        ret = file ? 0 : -ENOMEM;
+    } else {
+        ret = -ENOENT;
+    }
+    if (ret == 0) {
+        file->open_count++;
+        stream->file = file;
+    }
+    pthread_mutex_unlock(&g_mem_mutex);
+
+    if (ret < 0) {
+        free(stream);
+        return ret;
+    }
+    *handle = stream;
+    *is_streamed = 0;
+    return 0;
+}
+
+static int mem_read(void *handle, unsigned char *buf, int size) {
+    mem_stream *stream = handle;
+    pthread_mutex_lock(&g_mem_mutex);
+    int64_t count = mem_file_read_locked(stream->file, stream->position, buf, size);
+    pthread_mutex_unlock(&g_mem_mutex);
+    if (count > 0) {
+        stream->position += count;
+    }
+    return (int)count;
+}
+
+static int mem_write(void *handle, const unsigned char *buf, int size) {
+    mem_stream *stream = handle;
+    pthread_mutex_lock(&g_mem_mutex);
+    int ret = mem_file_write_locked(stream->file, stream->position, buf, size);
+    pthread_mutex_unlock(&g_mem_mutex);
+    if (ret > 0) {
+        stream->position += ret;
+    }
+    return ret;
+}
+
+static int64_t mem_seek(void *handle, int64_t pos, int whence) {
+    mem_stream *stream = handle;
+    pthread_mutex_lock(&g_mem_mutex);
+    int64_t size = stream->file->size;
+    pthread_mutex_unlock(&g_mem_mutex);
+    if (whence == FFIO_SEEK_SIZE) {
+        return size;
+    }
+    int64_t base = whence == SEEK_CUR ? stream->position : whence == SEEK_END ? size : 0;
+    if (base + pos < 0) {
+        return -EINVAL;
+    }
+    stream->position = base + pos;
+    return stream->position;
+}
+
+static int mem_close(void *handle) {
+    mem_stream *stream = handle;
+    pthread_mutex_lock(&g_mem_mutex);
+    mem_file *file = stream->file;
+    if (--file->open_count == 0 && file->released) {
+        mem_file_free(file);
+    }
+    pthread_mutex_unlock(&g_mem_mutex);
+    free(stream);
+    return 0;
+}
+
+const ffio_kind ffio_mem_kind = {
+    .name = "mem",
+    .open = mem_open,
+    .read = mem_read,
+    .write = mem_write,
+    .seek = mem_seek,
+    .close = mem_close
+};
@@ -0,0 +1,148 @@
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// --- Memory-mapped file input ---
+//
+// "shim:mmap/<absolute path>" maps the whole file read-only. Reads are a memcpy from the mapped
+// pages straight into the AVIO buffer, with no read() system call per refill. The mapping is
+// advised sequential, and the window ahead of the read position is prefetched with WILLNEED,
+// including after seeks.
+//
+// Touching a page past the end of a file truncated while it is mapped raises SIGBUS, so files
+// another writer may still change must not be mapped. When the mapping itself fails (address
+// space limits, ENOMEM, file systems without mmap), the stream falls back to pread().
+
+#define MMAP_PREFETCH_WINDOW ((int64_t)8 << 20)
+
+typedef struct {
+    int fd;
+    /// NULL when the file is read with pread() instead.
+    unsigned char *data;
+    int64_t size;
+    int64_t position;
+    int64_t prefetched_until;
+} mmap_stream;
+
+static void mmap_prefetch(mmap_stream *stream) {
+    if (stream->position + MMAP_PREFETCH_WINDOW / 2 < stream->prefetched_until) {
+        return;
+    }
+    int64_t page = sysconf(_SC_PAGESIZE);
+    int64_t start = stream->position / page * page;
+    int64_t end = start + MMAP_PREFETCH_WINDOW;
+    if (end > stream->size) {
+        end = stream->size;
+    }
+    if (end > start) {
+        madvise(stream->data + start, (size_t)(end - start), MADV_WILLNEED);
+    }
+    stream->prefetched_until = end;
+}
+
+static int mmap_open(const char *path, int flags, void **handle, int *is_streamed) {
+    if (flags & FFIO_FLAG_WRITE) {
+        return -EACCES;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
+    struct stat st;
+    int err = fstat(fd, &st) < 0 ? errno : S_ISREG(st.st_mode) ? 0 : EINVAL;
+    if (err) {
+        close(fd);
+        return -err;
+    }
+
+    mmap_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        close(fd);
+        return -ENOMEM;
+    }
+    stream->fd = fd;
+    stream->size = st.st_size;
+    if (stream->size > 0 && (uint64_t)stream->size <= SIZE_MAX) {
+        void *data = mmap(NULL, (size_t)stream->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            stream->data = data;
+            madvise(stream->data, (size_t)stream->size, MADV_SEQUENTIAL);
+        }
+    }
+
+    *handle = stream;
+    *is_streamed = 0;
+    return 0;
+}
+
+static int mmap_read(void *handle, unsigned char *buf, int size) {
+    mmap_stream *stream = handle;
+    if (stream->position >= stream->size) {
+        return 0;
+    }
+    int64_t count = stream->size - stream->position;
+    if (count > size) {
+        count = size;
+    }
+    if (!stream->data) {
+        ssize_t n;
+        do {
+            n = pread(stream->fd, buf, (size_t)count, stream->position);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            return -errno;
+        }
+        stream->position += n;
+        return (int)n;
+    }
+    mmap_prefetch(stream);
+    memcpy(buf, stream->data + stream->position, (size_t)count);
+    stream->position += count;
+    return (int)count;
+}
+
+static int64_t mmap_seek(void *handle, int64_t pos, int whence) {
+    mmap_stream *stream = handle;
+    if (whence == FFIO_SEEK_SIZE) {
+        return stream->size;
+    }
+    int64_t base = whence == SEEK_CUR ? stream->position : whence == SEEK_END ? stream->size : 0;
+    if (base + pos < 0) {
+        return -EINVAL;
+    }
+    int64_t target = base + pos;
+    if (target < stream->position || target > stream->prefetched_until) {
+        // Restart prefetching at the new position.
+        stream->prefetched_until = target;
+    }
+    stream->position = target;
+    return stream->position;
+}
+
+static int mmap_close(void *handle) {
+    mmap_stream *stream = handle;
+    if (stream->data) {
+        munmap(stream->data, (size_t)stream->size);
+    }
+    close(stream->fd);
+    free(stream);
+    return 0;
+}
+
+const ffio_kind ffio_mmap_kind = {
+    .name = "mmap",
+    .open = mmap_open,
+    .read = mmap_read,
+    .write = NULL,
+    .seek = mmap_seek,
+    .close = mmap_close
+};
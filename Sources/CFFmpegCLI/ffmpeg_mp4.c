@@ -0,0 +1,709 @@
+#include "ffmpeg_wrapper.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <sys/clonefile.h>
+#elif defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+// MP4/MOV container edits that only touch the `moov` atom.
+// Media data (`mdat`) is never moved, so chunk offsets stay valid as long as
+// the rewritten `moov` fits into the space the old one (plus adjacent
+// padding) occupied, or `moov` is the last atom in the file.
+//
+// Where the file system can clone files (APFS, Btrfs, XFS), the edit is made
+// to a copy-on-write clone that then replaces the original with rename(2), so
+// a crash leaves either the old or the new file. Elsewhere the new `moov` is
+// written over the old one and synced; a crash during that write can leave a
+// damaged `moov`.
+
+#define MP4_MAX_MOOV_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} mp4_buffer;
+
+typedef struct {
+    const char *key;
+    const char fourcc[5];
+} mp4_tag_mapping;
+
+// Same names the FFmpeg mov muxer uses for iTunes-style metadata.
+static const mp4_tag_mapping g_mp4_tag_mappings[] = {
+    { "title",        "\xa9nam" },
+    { "artist",       "\xa9""ART" },
+    { "album_artist", "aART" },
+    { "album",        "\xa9""alb" },
+    { "comment",      "\xa9""cmt" },
+    { "composer",     "\xa9wrt" },
+    { "date",         "\xa9""day" },
+    { "genre",        "\xa9gen" },
+    { "copyright",    "cprt" },
+    { "description",  "desc" },
+    { "encoder",      "\xa9too" },
+    { "grouping",     "\xa9grp" },
+    { "lyrics",       "\xa9lyr" },
+};
+
+static uint32_t mp4_read_u32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t mp4_read_u64(const uint8_t *p) {
+    return ((uint64_t)mp4_read_u32(p) << 32) | mp4_read_u32(p + 4);
+}
+
+static void mp4_write_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static int mp4_buffer_reserve(mp4_buffer *buf, size_t extra) {
+    if (buf->size + extra <= buf->capacity) {
+        return 0;
+    }
+    size_t capacity = buf->capacity ? buf->capacity : 4096;
+    while (capacity < buf->size + extra) {
+        capacity *= 2;
+    }
+    uint8_t *data = realloc(buf->data, capacity);
+    if (!data) {
+        return -ENOMEM;
+    }
+    buf->data = data;
+    buf->capacity = capacity;
+    return 0;
+}
+
+static int mp4_buffer_append(mp4_buffer *buf, const void *bytes, size_t len) {
+    int ret = mp4_buffer_reserve(buf, len);
+    if (ret < 0) {
+        return ret;
+    }
+    memcpy(buf->data + buf->size, bytes, len);
+    buf->size += len;
+    return 0;
+}
+
+// Start an atom and return the offset of its size field, patched by mp4_buffer_end_atom.
+static long mp4_buffer_begin_atom(mp4_buffer *buf, const char *type) {
+    uint8_t header[8] = {0};
+    memcpy(header + 4, type, 4);
+    if (mp4_buffer_append(buf, header, sizeof(header)) < 0) {
+        return -1;
+    }
+    return (long)(buf->size - sizeof(header));
+}
+
+static void mp4_buffer_end_atom(mp4_buffer *buf, long start) {
+    mp4_write_u32(buf->data + start, (uint32_t)(buf->size - (size_t)start));
+}
+
+// Parse the atom header at `p` (with `avail` bytes left in the parent).
+// Returns the header length, or 0 if the atom is malformed.
+static size_t mp4_atom_header(const uint8_t *p, size_t avail, uint64_t *atom_size) {
+    if (avail < 8) {
+        return 0;
+    }
+    uint64_t size = mp4_read_u32(p);
+    size_t header = 8;
+    if (size == 1) {
+        if (avail < 16) {
+            return 0;
+        }
+        size = mp4_read_u64(p + 8);
+        header = 16;
+    } else if (size == 0) {
+        size = avail;
+    }
+    if (size < header || size > avail) {
+        return 0;
+    }
+    *atom_size = size;
+    return header;
+}
+
+// Find the first child atom of `type` inside [start, end) of `data`.
+static int mp4_find_child(const uint8_t *data, size_t start, size_t end, const char *type, size_t *offset, size_t *size) {
+    size_t pos = start;
+    while (pos < end) {
+        uint64_t atom_size = 0;
+        if (!mp4_atom_header(data + pos, end - pos, &atom_size)) {
+            return 0;
+        }
+        if (memcmp(data + pos + 4, type, 4) == 0) {
+            *offset = pos;
+            *size = (size_t)atom_size;
+            return 1;
+        }
+        pos += (size_t)atom_size;
+    }
+    return 0;
+}
+
+typedef struct {
+    int64_t moov_offset;
+    uint64_t moov_size;
+    uint64_t free_after_moov;
+    int moov_is_last;
+} mp4_layout;
+
+// Read the top-level atom header at `pos`. Returns 0 and fills `type`/`size`, or a negative errno.
+static int mp4_read_top_level_atom(int fd, int64_t pos, int64_t file_size, uint8_t type[4], uint64_t *size) {
+    uint8_t header[16];
+    if (pread(fd, header, sizeof(header), pos) < 8) {
+        return -EIO;
+    }
+    uint64_t atom_size = mp4_read_u32(header);
+    if (atom_size == 1) {
+        atom_size = mp4_read_u64(header + 8);
+    } else if (atom_size == 0) {
+        atom_size = (uint64_t)(file_size - pos);
+    }
+    if (atom_size < 8 || (int64_t)atom_size > file_size - pos) {
+        return -EINVAL;
+    }
+    memcpy(type, header + 4, 4);
+    *size = atom_size;
+    return 0;
+}
+
+static int mp4_scan_layout(int fd, int64_t file_size, mp4_layout *layout) {
+    int64_t pos = 0;
+    memset(layout, 0, sizeof(*layout));
+    layout->moov_offset = -1;
+
+    while (pos + 8 <= file_size) {
+        uint8_t type[4];
+        uint64_t size = 0;
+        int ret = mp4_read_top_level_atom(fd, pos, file_size, type, &size);
+        if (ret < 0) {
+            return ret;
+        }
+
+        if (memcmp(type, "moov", 4) == 0) {
+            layout->moov_offset = pos;
+            layout->moov_size = size;
+        } else if (layout->moov_offset >= 0 &&
+                   pos == layout->moov_offset + (int64_t)layout->moov_size &&
+                   (memcmp(type, "free", 4) == 0 || memcmp(type, "skip", 4) == 0)) {
+            layout->free_after_moov = size;
+        }
+        pos += (int64_t)size;
+    }
+
+    if (layout->moov_offset < 0) {
+        return -EINVAL;
+    }
+    int64_t moov_end = layout->moov_offset + (int64_t)layout->moov_size + (int64_t)layout->free_after_moov;
+    layout->moov_is_last = (moov_end >= file_size);
+    return 0;
+}
+
+int ffmpeg_mp4_scan_atoms(const char *path, ffmpeg_mp4_atom *atoms, int max_atoms) {
+    if (!path || max_atoms < 0 || (max_atoms > 0 && !atoms)) {
+        return -EINVAL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int ret = -errno;
+        close(fd);
+        return ret;
+    }
+
+    int64_t file_size = (int64_t)st.st_size;
+    int64_t pos = 0;
+    int count = 0;
+    while (pos + 8 <= file_size) {
+        uint8_t type[4];
+        uint64_t size = 0;
+        int ret = mp4_read_top_level_atom(fd, pos, file_size, type, &size);
+        if (ret < 0) {
+            close(fd);
+            return count > 0 ? count : ret;
+        }
+        if (count < max_atoms) {
+            atoms[count].type = mp4_read_u32(type);
+            atoms[count].offset = pos;
+            atoms[count].size = (int64_t)size;
+        }
+        count++;
+        pos += (int64_t)size;
+    }
+
+    close(fd);
+    return count;
+}
+
+static const char *mp4_fourcc_for_key(const char *key) {
+    for (size_t i = 0; i < sizeof(g_mp4_tag_mappings) / sizeof(g_mp4_tag_mappings[0]); i++) {
+        if (strcmp(g_mp4_tag_mappings[i].key, key) == 0) {
+            return g_mp4_tag_mappings[i].fourcc;
+        }
+    }
+    return NULL;
+}
+
+static int mp4_tag_index(const char *fourcc, const char *const *keys, int count) {
+    for (int i = 0; i < count; i++) {
+        const char *mapped = mp4_fourcc_for_key(keys[i]);
+        if (mapped && memcmp(mapped, fourcc, 4) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Append a `data` item atom: ilst/<fourcc>/data with a UTF-8 payload.
+static int mp4_append_ilst_item(mp4_buffer *buf, const char *fourcc, const char *value) {
+    long item = mp4_buffer_begin_atom(buf, fourcc);
+    long data = mp4_buffer_begin_atom(buf, "data");
+    uint8_t type_and_locale[8] = {0, 0, 0, 1, 0, 0, 0, 0};
+    if (item < 0 || data < 0 ||
+        mp4_buffer_append(buf, type_and_locale, sizeof(type_and_locale)) < 0 ||
+        mp4_buffer_append(buf, value, strlen(value)) < 0) {
+        return -ENOMEM;
+    }
+    mp4_buffer_end_atom(buf, data);
+    mp4_buffer_end_atom(buf, item);
+    return 0;
+}
+
+// Append ilst with the items of `old_ilst` (NULL for none) that are not being edited, followed by
+// the requested values.
+static int mp4_append_merged_ilst(
+    mp4_buffer *out,
+    const uint8_t *old_ilst,
+    size_t old_ilst_size,
+    const char *const *keys,
+    const char *const *values,
+    int count
+) {
+    long ilst = mp4_buffer_begin_atom(out, "ilst");
+    if (ilst < 0) {
+        return -ENOMEM;
+    }
+
+    if (old_ilst) {
+        size_t pos = 8;
+        while (pos < old_ilst_size) {
+            uint64_t atom_size = 0;
+            if (!mp4_atom_header(old_ilst + pos, old_ilst_size - pos, &atom_size)) {
+                return -EINVAL;
+            }
+            if (mp4_tag_index((const char *)old_ilst + pos + 4, keys, count) < 0 &&
+                mp4_buffer_append(out, old_ilst + pos, (size_t)atom_size) < 0) {
+                return -ENOMEM;
+            }
+            pos += (size_t)atom_size;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!values[i] || values[i][0] == '\0') {
+            continue;
+        }
+        int ret = mp4_append_ilst_item(out, mp4_fourcc_for_key(keys[i]), values[i]);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    mp4_buffer_end_atom(out, ilst);
+    return 0;
+}
+
+// Build udta/meta/ilst with the existing items merged with the requested edits. The children of an
+// existing meta (its hdlr, and anything besides ilst) are kept as they are. Returns
+// FFMPEG_MP4_EDIT_NEEDS_REWRITE when that meta is not an iTunes-style (`mdir`) item list, such as
+// a QuickTime `mdta` meta with a `keys` atom, whose items the ilst edit would not line up with.
+// `udta_size` is 0 when the movie has no user data yet.
+static int mp4_build_udta(
+    mp4_buffer *out,
+    const uint8_t *moov,
+    size_t udta_offset,
+    size_t udta_size,
+    const char *const *keys,
+    const char *const *values,
+    int count
+) {
+    long udta = mp4_buffer_begin_atom(out, "udta");
+    if (udta < 0) {
+        return -ENOMEM;
+    }
+
+    size_t meta_offset = 0;
+    size_t meta_size = 0;
+
+    if (udta_size) {
+        size_t pos = udta_offset + 8;
+        size_t end = udta_offset + udta_size;
+        while (pos < end) {
+            uint64_t atom_size = 0;
+            if (!mp4_atom_header(moov + pos, end - pos, &atom_size)) {
+                return -EINVAL;
+            }
+            const uint8_t *atom = moov + pos;
+            if (memcmp(atom + 4, "meta", 4) == 0 && !meta_size) {
+                meta_offset = pos;
+                meta_size = (size_t)atom_size;
+            } else if (memcmp(atom + 4, "meta", 4) == 0 || mp4_tag_index((const char *)atom + 4, keys, count) < 0) {
+                // Keep unrelated user data; QuickTime-style duplicates of edited keys are dropped
+                // so they cannot shadow the new values.
+                if (mp4_buffer_append(out, atom, (size_t)atom_size) < 0) {
+                    return -ENOMEM;
+                }
+            }
+            pos += (size_t)atom_size;
+        }
+    }
+
+    long meta = mp4_buffer_begin_atom(out, "meta");
+    static const uint8_t meta_version[4] = {0, 0, 0, 0};
+    if (meta < 0 || mp4_buffer_append(out, meta_size ? moov + meta_offset + 8 : meta_version, 4) < 0) {
+        return -ENOMEM;
+    }
+
+    if (meta_size) {
+        // meta is a full box: 4 bytes of version/flags precede its children.
+        size_t hdlr_offset = 0;
+        size_t hdlr_size = 0;
+        if (meta_size < 12 ||
+            !mp4_find_child(moov, meta_offset + 12, meta_offset + meta_size, "hdlr", &hdlr_offset, &hdlr_size) ||
+            hdlr_size < 20 || memcmp(moov + hdlr_offset + 16, "mdir", 4) != 0) {
+            return FFMPEG_MP4_EDIT_NEEDS_REWRITE;
+        }
+
+        int wrote_ilst = 0;
+        size_t pos = meta_offset + 12;
+        size_t end = meta_offset + meta_size;
+        while (pos < end) {
+            uint64_t atom_size = 0;
+            if (!mp4_atom_header(moov + pos, end - pos, &atom_size)) {
+                return -EINVAL;
+            }
+            int ret = 0;
+            if (memcmp(moov + pos + 4, "ilst", 4) == 0 && !wrote_ilst) {
+                ret = mp4_append_merged_ilst(out, moov + pos, (size_t)atom_size, keys, values, count);
+                wrote_ilst = 1;
+            } else if (memcmp(moov + pos + 4, "ilst", 4) != 0) {
+                ret = mp4_buffer_append(out, moov + pos, (size_t)atom_size) < 0 ? -ENOMEM : 0;
+            }
+            if (ret < 0) {
+                return ret;
+            }
+            pos += (size_t)atom_size;
+        }
+        if (!wrote_ilst) {
+            int ret = mp4_append_merged_ilst(out, NULL, 0, keys, values, count);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+    } else {
+        static const uint8_t hdlr[] = {
+            0, 0, 0, 33, 'h', 'd', 'l', 'r',
+            0, 0, 0, 0,
+            0, 0, 0, 0,
+            'm', 'd', 'i', 'r',
+            'a', 'p', 'p', 'l',
+            0, 0, 0, 0,
+            0, 0, 0, 0,
+            0
+        };
+        if (mp4_buffer_append(out, hdlr, sizeof(hdlr)) < 0) {
+            return -ENOMEM;
+        }
+        int ret = mp4_append_merged_ilst(out, NULL, 0, keys, values, count);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    mp4_buffer_end_atom(out, meta);
+    mp4_buffer_end_atom(out, udta);
+    return 0;
+}
+
+// Overwrite the tkhd matrix of every video track (non-zero presentation size).
+static void mp4_apply_rotation(uint8_t *moov, size_t moov_size, int rotation) {
+    size_t pos = 8;
+    while (pos < moov_size) {
+        uint64_t trak_size = 0;
+        if (!mp4_atom_header(moov + pos, moov_size - pos, &trak_size)) {
+            return;
+        }
+        size_t tkhd_offset = 0;
+        size_t tkhd_size = 0;
+        if (memcmp(moov + pos + 4, "trak", 4) == 0 &&
+            mp4_find_child(moov, pos + 8, pos + (size_t)trak_size, "tkhd", &tkhd_offset, &tkhd_size)) {
+            uint8_t *tkhd = moov + tkhd_offset;
+            size_t matrix = tkhd[8] == 1 ? 60 : 48;
+            if (tkhd_size >= matrix + 44) {
+                uint32_t width = mp4_read_u32(tkhd + matrix + 36) >> 16;
+                uint32_t height = mp4_read_u32(tkhd + matrix + 40) >> 16;
+                if (width && height) {
+                    // Same matrices the FFmpeg mov muxer writes for a clockwise `rotate` tag.
+                    int32_t a = 1, b = 0, c = 0, d = 1;
+                    uint32_t tx = 0, ty = 0;
+                    switch (rotation) {
+                    case 90:  a = 0;  b = 1;  c = -1; d = 0;  tx = height; break;
+                    case 180: a = -1; b = 0;  c = 0;  d = -1; tx = width; ty = height; break;
+                    case 270: a = 0;  b = -1; c = 1;  d = 0;  ty = width; break;
+                    default: break;
+                    }
+                    uint8_t *m = tkhd + matrix;
+                    mp4_write_u32(m + 0, (uint32_t)(a * 65536));
+                    mp4_write_u32(m + 4, (uint32_t)(b * 65536));
+                    mp4_write_u32(m + 8, 0);
+                    mp4_write_u32(m + 12, (uint32_t)(c * 65536));
+                    mp4_write_u32(m + 16, (uint32_t)(d * 65536));
+                    mp4_write_u32(m + 20, 0);
+                    mp4_write_u32(m + 24, tx << 16);
+                    mp4_write_u32(m + 28, ty << 16);
+                    mp4_write_u32(m + 32, 1u << 30);
+                }
+            }
+        }
+        pos += (size_t)trak_size;
+    }
+}
+
+static int mp4_write_all(int fd, const uint8_t *data, size_t size, int64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        data += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+    return 0;
+}
+
+// Clone `fd` into a new file next to `path` without copying data. Returns the clone's descriptor
+// with its name in `temp_path`, or a negative errno value when the file system cannot clone.
+static int mp4_clone_to_temp(const char *path, int fd, const struct stat *st, char *temp_path, size_t temp_size) {
+    if (snprintf(temp_path, temp_size, "%s.XXXXXX", path) >= (int)temp_size) {
+        return -ENAMETOOLONG;
+    }
+#if defined(__APPLE__)
+    int reserved = mkstemp(temp_path);
+    if (reserved < 0) {
+        return -errno;
+    }
+    close(reserved);
+    unlink(temp_path);
+    if (fclonefileat(fd, AT_FDCWD, temp_path, 0) < 0) {
+        return -errno;
+    }
+    int clone_fd = open(temp_path, O_RDWR);
+    if (clone_fd < 0) {
+        int ret = -errno;
+        unlink(temp_path);
+        return ret;
+    }
+    return clone_fd;
+#elif defined(__linux__) && defined(FICLONE)
+    int clone_fd = mkstemp(temp_path);
+    if (clone_fd < 0) {
+        return -errno;
+    }
+    if (ioctl(clone_fd, FICLONE, fd) < 0 || fchmod(clone_fd, st->st_mode & 07777) < 0) {
+        int ret = -errno;
+        close(clone_fd);
+        unlink(temp_path);
+        return ret;
+    }
+    return clone_fd;
+#else
+    (void)fd;
+    (void)st;
+    return -EOPNOTSUPP;
+#endif
+}
+
+static int mp4_edit_fd(
+    int fd,
+    int64_t file_size,
+    const char *const *keys,
+    const char *const *values,
+    int count,
+    int rotation
+) {
+    mp4_layout layout;
+    uint8_t *moov = NULL;
+    mp4_buffer rebuilt = {0};
+    int ret = mp4_scan_layout(fd, file_size, &layout);
+    if (ret < 0) {
+        goto end;
+    }
+    if (layout.moov_size > MP4_MAX_MOOV_SIZE) {
+        ret = FFMPEG_MP4_EDIT_NEEDS_REWRITE;
+        goto end;
+    }
+
+    moov = malloc((size_t)layout.moov_size);
+    if (!moov) {
+        ret = -ENOMEM;
+        goto end;
+    }
+    if (pread(fd, moov, (size_t)layout.moov_size, layout.moov_offset) != (ssize_t)layout.moov_size) {
+        ret = -EIO;
+        goto end;
+    }
+
+    size_t cmov_offset = 0;
+    size_t cmov_size = 0;
+    uint64_t moov_atom_size = 0;
+    if (mp4_atom_header(moov, (size_t)layout.moov_size, &moov_atom_size) != 8 ||
+        mp4_find_child(moov, 8, (size_t)layout.moov_size, "cmov", &cmov_offset, &cmov_size)) {
+        ret = FFMPEG_MP4_EDIT_NEEDS_REWRITE;
+        goto end;
+    }
+
+    if (rotation >= 0) {
+        mp4_apply_rotation(moov, (size_t)layout.moov_size, rotation);
+    }
+
+    if (count == 0) {
+        // Rotation only changes bytes in place; the moov size is unchanged.
+        ret = mp4_write_all(fd, moov, (size_t)layout.moov_size, layout.moov_offset);
+        goto end;
+    }
+
+    size_t udta_offset = 0;
+    size_t udta_size = 0;
+    mp4_find_child(moov, 8, (size_t)layout.moov_size, "udta", &udta_offset, &udta_size);
+
+    long moov_start = mp4_buffer_begin_atom(&rebuilt, "moov");
+    if (moov_start < 0) {
+        ret = -ENOMEM;
+        goto end;
+    }
+    size_t pos = 8;
+    while (pos < layout.moov_size) {
+        uint64_t atom_size = 0;
+        if (!mp4_atom_header(moov + pos, (size_t)layout.moov_size - pos, &atom_size)) {
+            ret = -EINVAL;
+            goto end;
+        }
+        if (memcmp(moov + pos + 4, "udta", 4) != 0 &&
+            mp4_buffer_append(&rebuilt, moov + pos, (size_t)atom_size) < 0) {
+            ret = -ENOMEM;
+            goto end;
+        }
+        pos += (size_t)atom_size;
+    }
+    ret = mp4_build_udta(&rebuilt, moov, udta_offset, udta_size, keys, values, count);
+    if (ret != 0) {
+        goto end;
+    }
+    mp4_buffer_end_atom(&rebuilt, moov_start);
+
+    uint64_t available = layout.moov_size + layout.free_after_moov;
+    if (rebuilt.size == available || rebuilt.size + 8 <= available) {
+        uint64_t padding = available - rebuilt.size;
+        if (padding > 0) {
+            long free_atom = mp4_buffer_begin_atom(&rebuilt, "free");
+            if (free_atom < 0 || mp4_buffer_reserve(&rebuilt, (size_t)padding - 8) < 0) {
+                ret = -ENOMEM;
+                goto end;
+            }
+            memset(rebuilt.data + rebuilt.size, 0, (size_t)padding - 8);
+            rebuilt.size += (size_t)padding - 8;
+            mp4_buffer_end_atom(&rebuilt, free_atom);
+        }
+        ret = mp4_write_all(fd, rebuilt.data, rebuilt.size, layout.moov_offset);
+    } else if (layout.moov_is_last) {
+        // Nothing follows moov, so it can grow or shrink without moving media data.
+        ret = mp4_write_all(fd, rebuilt.data, rebuilt.size, layout.moov_offset);
+        if (ret == 0 && ftruncate(fd, layout.moov_offset + (off_t)rebuilt.size) < 0) {
+            ret = -errno;
+        }
+    } else {
+        ret = FFMPEG_MP4_EDIT_NEEDS_REWRITE;
+    }
+
+end:
+    if (ret == 0 && fsync(fd) < 0) {
+        ret = -errno;
+    }
+    free(rebuilt.data);
+    free(moov);
+    return ret;
+}
+
+int ffmpeg_mp4_edit_metadata(
+    const char *path,
+    const char *const *keys,
+    const char *const *values,
+    int count,
+    int rotation
+) {
+    if (!path || count < 0 || (count > 0 && (!keys || !values))) {
+        return -EINVAL;
+    }
+    if (rotation > 0 && rotation != 90 && rotation != 180 && rotation != 270) {
+        return -EINVAL;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!keys[i] || !mp4_fourcc_for_key(keys[i])) {
+            return -EINVAL;
+        }
+    }
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        return -errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int ret = -errno;
+        close(fd);
+        return ret;
+    }
+
+    char temp_path[4096];
+    int clone_fd = mp4_clone_to_temp(path, fd, &st, temp_path, sizeof(temp_path));
+    if (clone_fd < 0) {
+        int ret = mp4_edit_fd(fd, (int64_t)st.st_size, keys, values, count, rotation);
+        close(fd);
+        return ret;
+    }
+
+    int ret = mp4_edit_fd(clone_fd, (int64_t)st.st_size, keys, values, count, rotation);
+    close(clone_fd);
+    close(fd);
+    if (ret == 0 && rename(temp_path, path) < 0) {
+        ret = -errno;
+    }
+    if (ret != 0) {
+        unlink(temp_path);
+    }
+    return ret;
+}
@@ -0,0 +1,252 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// --- Memory pressure ---
+//
+// The current level is set by ffmpeg_pressure_signal, called by the Swift layer from the platform
+// notification, by the PSI monitor on Linux, or by tests. Raising it shrinks the HTTP cache memory
+// tier and lowers the thread count jobs started afterwards use for codecs and filters, which is
+// what bounds the frames they keep in flight. At the critical level memory files move to disk,
+// background jobs wait to start, and a running background job blocks in its shim reads and writes
+// until the level drops. A blocked job still holds the execution slot, so as soon as another run
+// queues for it the background job cancels itself and is run again from the start once admitted.
+
+#define PRESSURE_POLL_US 100000
+
+static atomic_int g_pressure_level;
+static atomic_int g_pressure_running_background;
+static atomic_int g_pressure_paused;
+static atomic_llong g_pressure_last_resume_us;
+static atomic_int g_pressure_queued;    // foreground runs waiting for the execution slot
+static atomic_int g_pressure_yielded;   // the running background job cancelled itself for them
+static _Thread_local int g_pressure_job_background;
+
+static pthread_mutex_t g_pressure_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ffmpeg_pressure_stats g_pressure_stats;
+
+static pthread_t g_pressure_monitor;
+static atomic_int g_pressure_monitor_running;
+static double g_pressure_warning_avg10;
+static double g_pressure_critical_avg10;
+static int g_pressure_interval_ms;
+static ffmpeg_pressure_func g_pressure_callback;
+
+static int pressure_thread_budget(int level) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (level >= FFMPEG_PRESSURE_CRITICAL) {
+        return 1;
+    }
+    if (level == FFMPEG_PRESSURE_WARNING) {
+        return cores > 2 ? (int)(cores / 2) : 1;
+    }
+    return 0;
+}
+
+void ffmpeg_pressure_signal(int level, ffmpeg_pressure_response *response) {
+    if (level < FFMPEG_PRESSURE_NORMAL) {
+        level = FFMPEG_PRESSURE_NORMAL;
+    } else if (level > FFMPEG_PRESSURE_CRITICAL) {
+        level = FFMPEG_PRESSURE_CRITICAL;
+    }
+    atomic_store(&g_pressure_level, level);
+
+    // Normal restores the full cache budget; warning halves it; critical empties it.
+    int percent = level == FFMPEG_PRESSURE_CRITICAL ? 0 : level == FFMPEG_PRESSURE_WARNING ? 50 : 100;
+    int64_t released = ffio_httpcache_scale_memory(percent);
+    int64_t spilled = level == FFMPEG_PRESSURE_CRITICAL ? ffio_memfile_spill_all() : 0;
+
+    pthread_mutex_lock(&g_pressure_mutex);
+    g_pressure_stats.signals++;
+    g_pressure_stats.httpcache_bytes_released += released;
+    g_pressure_stats.memfile_bytes_spilled += spilled;
+    pthread_mutex_unlock(&g_pressure_mutex);
+
+    if (response) {
+        response->level = level;
+        response->httpcache_bytes_released = released;
+        response->memfile_bytes_spilled = spilled;
+        response->thread_budget = pressure_thread_budget(level);
+    }
+}
+
+int ffmpeg_pressure_level(void) {
+    return atomic_load(&g_pressure_level);
+}
+
+void ffmpeg_set_job_background(int background) {
+    g_pressure_job_background = background != 0;
+}
+
+void ffmpeg_pressure_get_stats(ffmpeg_pressure_stats *stats) {
+    pthread_mutex_lock(&g_pressure_mutex);
+    *stats = g_pressure_stats;
+    pthread_mutex_unlock(&g_pressure_mutex);
+}
+
+// Wait while a critical level holds a paused job back, until it drops or the job is cancelled.
+// A running job (`yield`) cancels itself instead once another run queues for the execution slot.
+static void pressure_wait(int yield) {
+    int64_t started = ffio_now_us();
+    atomic_fetch_add(&g_pressure_paused, 1);
+    while (atomic_load(&g_pressure_level) >= FFMPEG_PRESSURE_CRITICAL && !ffio_cancel_requested()) {
+        if (yield && atomic_load(&g_pressure_queued) > 0) {
+            atomic_store(&g_pressure_yielded, 1);
+            ffmpeg_request_cancel();
+            break;
+        }
+        usleep(PRESSURE_POLL_US);
+    }
+    int64_t resumed = ffio_now_us();
+    atomic_store(&g_pressure_last_resume_us, resumed);
+    atomic_fetch_sub(&g_pressure_paused, 1);
+
+    pthread_mutex_lock(&g_pressure_mutex);
+    g_pressure_stats.background_pauses++;
+    g_pressure_stats.paused_us += resumed - started;
+    pthread_mutex_unlock(&g_pressure_mutex);
+}
+
+void ffio_pressure_wait_admission(void) {
+    if (g_pressure_job_background && atomic_load(&g_pressure_level) >= FFMPEG_PRESSURE_CRITICAL) {
+        pressure_wait(0);
+    }
+}
+
+void ffio_pressure_queue(int delta) {
+    if (!g_pressure_job_background) {
+        atomic_fetch_add(&g_pressure_queued, delta);
+    }
+}
+
+int ffio_pressure_take_yield(void) {
+    if (!atomic_exchange(&g_pressure_yielded, 0)) {
+        return 0;
+    }
+    pthread_mutex_lock(&g_pressure_mutex);
+    g_pressure_stats.background_requeues++;
+    pthread_mutex_unlock(&g_pressure_mutex);
+    return 1;
+}
+
+int ffio_pressure_begin_job(void) {
+    atomic_store(&g_pressure_running_background, g_pressure_job_background);
+    return pressure_thread_budget(atomic_load(&g_pressure_level));
+}
+
+void ffio_pressure_pause_point(void) {
+    if (atomic_load(&g_pressure_running_background) && atomic_load(&g_pressure_level) >= FFMPEG_PRESSURE_CRITICAL) {
+        pressure_wait(1);
+    }
+}
+
+int ffio_pressure_paused(void) {
+    return atomic_load(&g_pressure_paused) > 0;
+}
+
+int64_t ffio_pressure_last_resume_us(void) {
+    return atomic_load(&g_pressure_last_resume_us);
+}
+
+// --- Linux pressure stall information ---
+
+#ifdef __linux__
+// Parse the "some" and "full" avg10 percentages of /proc/pressure/memory.
+static int pressure_read_psi(double *some_avg10, double *full_avg10) {
+    FILE *file = fopen("/proc/pressure/memory", "r");
+    if (!file) {
+        return -errno;
+    }
+    char line[256];
+    int found = 0;
+    while (fgets(line, sizeof(line), file)) {
+        double avg10 = 0;
+        if (sscanf(line, "some avg10=%lf", &avg10) == 1) {
+            *some_avg10 = avg10;
+            found++;
+        } else if (sscanf(line, "full avg10=%lf", &avg10) == 1) {
+            *full_avg10 = avg10;
+            found++;
+        }
+    }
+    fclose(file);
+    return found ? 0 : -EINVAL;
+}
+
+static void *pressure_monitor_thread(void *arg) {
+    (void)arg;
+    int reported = -1;
+    while (atomic_load(&g_pressure_monitor_running)) {
+        double some = 0;
+        double full = 0;
+        if (pressure_read_psi(&some, &full) == 0) {
+            int level = full >= g_pressure_critical_avg10 ? FFMPEG_PRESSURE_CRITICAL
+                : some >= g_pressure_warning_avg10 ? FFMPEG_PRESSURE_WARNING
+                : FFMPEG_PRESSURE_NORMAL;
+            if (level != reported) {
+                reported = level;
+                g_pressure_callback(level);
+            }
+        }
+        for (int slept = 0; slept < g_pressure_interval_ms && atomic_load(&g_pressure_monitor_running); slept += 50) {
+            usleep(50000);
+        }
+    }
+    return NULL;
+}
+#endif
+
+int ffmpeg_pressure_monitor_start(double warning_avg10, double critical_avg10, int interval_ms, ffmpeg_pressure_func callback) {
+#ifdef __linux__
+    if (!callback || interval_ms <= 0) {
+        return -EINVAL;
+    }
+    double some = 0;
+    double full = 0;
+    int ret = pressure_read_psi(&some, &full);
+    if (ret < 0) {
+        return ret;
+    }
+    pthread_mutex_lock(&g_pressure_mutex);
+    if (atomic_load(&g_pressure_monitor_running)) {
+        pthread_mutex_unlock(&g_pressure_mutex);
+        return -EBUSY;
+    }
+    g_pressure_warning_avg10 = warning_avg10;
+    g_pressure_critical_avg10 = critical_avg10;
+    g_pressure_interval_ms = interval_ms;
+    g_pressure_callback = callback;
+    atomic_store(&g_pressure_monitor_running, 1);
+    if (pthread_create(&g_pressure_monitor, NULL, pressure_monitor_thread, NULL) != 0) {
+        atomic_store(&g_pressure_monitor_running, 0);
+        pthread_mutex_unlock(&g_pressure_mutex);
+        return -EAGAIN;
+    }
+    pthread_mutex_unlock(&g_pressure_mutex);
+    return 0;
+#else
+    (void)warning_avg10;
+    (void)critical_avg10;
+    (void)interval_ms;
+    (void)callback;
+    return -ENOSYS;
+#endif
+}
+
+void ffmpeg_pressure_monitor_stop(void) {
+#ifdef __linux__
+    pthread_mutex_lock(&g_pressure_mutex);
+    if (atomic_exchange(&g_pressure_monitor_running, 0)) {
+        pthread_mutex_unlock(&g_pressure_mutex);
+        pthread_join(g_pressure_monitor, NULL);
+        return;
+    }
+    pthread_mutex_unlock(&g_pressure_mutex);
+#endif
+}
@@ -0,0 +1,122 @@
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// --- Progress reports for the job watchdog ---
+//
+// "shim:progress/<any>" is passed to ffmpeg's -progress option. ffmpeg writes a block of key=value lines
+// every stats period, even while nothing moves; this kind parses frame, total_size and
+// out_time_us and records when any of them last advanced.
+
+#define PROGRESS_LINE_MAX 256
+
+typedef struct {
+    char line[PROGRESS_LINE_MAX];
+    int length;
+} progress_stream;
+
+static atomic_int g_progress_open;
+static atomic_llong g_progress_frame;
+static atomic_llong g_progress_bytes;
+static atomic_llong g_progress_out_time_us;
+static atomic_llong g_progress_last_advance_us;
+
+int64_t ffio_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void ffio_progress_reset(void) {
+    atomic_store(&g_progress_open, 0);
+    atomic_store(&g_progress_frame, 0);
+    atomic_store(&g_progress_bytes, 0);
+    atomic_store(&g_progress_out_time_us, 0);
+    atomic_store(&g_progress_last_advance_us, ffio_now_us());
+}
+
+int64_t ffio_progress_last_advance_us(void) {
+    return atomic_load(&g_progress_open) ? atomic_load(&g_progress_last_advance_us) : -1;
+}
+
+static void progress_update(atomic_llong *counter, const char *value) {
+    char *end = NULL;
+    long long parsed = strtoll(value, &end, 10);
+    if (end == value) {
+        return;  // "N/A" before the first frame
+    }
+    if (parsed > atomic_load(counter)) {
+        atomic_store(counter, parsed);
+        atomic_store(&g_progress_last_advance_us, ffio_now_us());
+    }
+}
+
+static void progress_parse_line(const char *line) {
+    const char *value = strchr(line, '=');
+    if (!value) {
+        return;
+    }
+    size_t key_length = (size_t)(value - line);
+    value++;
+    if (key_length == 5 && strncmp(line, "frame", 5) == 0) {
+        progress_update(&g_progress_frame, value);
+    } else if (key_length == 10 && strncmp(line, "total_size", 10) == 0) {
+        progress_update(&g_progress_bytes, value);
+    } else if (key_length == 11 && strncmp(line, "out_time_us", 11) == 0) {
+        progress_update(&g_progress_out_time_us, value);
+    }
+}
+
+static int progress_open(const char *path, int flags, void **handle, int *is_streamed) {
+    (void)path;
+    if (!(flags & FFIO_FLAG_WRITE)) {
+        return -EACCES;
+    }
+    progress_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        return -ENOMEM;
+    }
+    atomic_store(&g_progress_open, 1);
+    *handle = stream;
+    *is_streamed = 1;
+    return 0;
+}
+
+static int progress_write(void *handle, const unsigned char *buf, int size) {
+    progress_stream *stream = handle;
+    for (int i = 0; i < size; i++) {
+        if (buf[i] == '\n') {
+            stream->line[stream->length] = '\0';
+            progress_parse_line(stream->line);
+            stream->length = 0;
+        } else if (stream->length < PROGRESS_LINE_MAX - 1) {
+            stream->line[stream->length++] = (char)buf[i];
+        }
+    }
+    return size;
+}
+
+static int64_t progress_seek(void *handle, int64_t pos, int whence) {
+    (void)handle;
+    (void)pos;
+    (void)whence;
+    return -ESPIPE;
+}
+
+static int progress_close(void *handle) {
+    free(handle);
+    return 0;
+}
+
+const ffio_kind ffio_progress_kind = {
+    .name = "progress",
+    .open = progress_open,
+    .read = NULL,
+    .write = progress_write,
+    .seek = progress_seek,
+    .close = progress_close
+};
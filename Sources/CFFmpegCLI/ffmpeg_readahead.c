@@ -0,0 +1,391 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// --- Read-ahead input ---
+//
+// "shim:readahead/<buffer bytes>/<source>" wraps a local path or another shim URL. A background
+// thread owns the source and fills a ring buffer ahead of the reader. Prefetching stays one chunk
+// deep until the reader has made a few sequential reads, so header probing and random access do
+// not pull in data that is never used. A seek outside the buffered range cancels the prefetch in
+// flight and restarts it at the new position; seeks inside it are served from the buffer.
+
+#define READAHEAD_CHUNK_SIZE (256 * 1024)
+#define READAHEAD_MIN_BUFFER (2 * READAHEAD_CHUNK_SIZE)
+#define READAHEAD_SEQUENTIAL_READS 4
+#define READAHEAD_POLL_US 100000
+
+typedef struct {
+    ffio_stream *source;
+    int64_t size;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    unsigned char *ring;
+    int64_t capacity;
+    int64_t start;      // first buffered byte still kept (for short backward seeks)
+    int64_t end;        // first byte not yet buffered
+    int64_t position;   // reader position, start <= position <= end unless a seek is pending
+    int generation;     // bumped by every seek that discards the buffer
+    int sequential_reads;
+    int eof;
+    int error;
+    int stop;
+} readahead_stream;
+
+static atomic_llong g_readahead_source_bytes;
+static atomic_llong g_readahead_source_reads;
+static atomic_llong g_readahead_discarded_bytes;
+static atomic_llong g_readahead_wait_us;
+
+void ffmpeg_readahead_get_stats(ffmpeg_readahead_stats *stats) {
+    stats->source_bytes = atomic_load(&g_readahead_source_bytes);
+    stats->source_reads = atomic_load(&g_readahead_source_reads);
+    stats->discarded_bytes = atomic_load(&g_readahead_discarded_bytes);
+    stats->reader_wait_us = atomic_load(&g_readahead_wait_us);
+}
+
+// Wait for the fill thread, waking periodically so a cancelled job is not held by a stalled source.
+static void readahead_timed_wait_locked(readahead_stream *stream) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += READAHEAD_POLL_US * 1000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&stream->cond, &stream->mutex, &deadline);
+}
+
+static int64_t readahead_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// How far ahead of the reader the thread may fill, given what the reader has done so far.
+static int64_t readahead_depth_locked(readahead_stream *stream) {
+    return stream->sequential_reads >= READAHEAD_SEQUENTIAL_READS ? stream->capacity : READAHEAD_CHUNK_SIZE;
+}
+
+static int readahead_should_fill_locked(readahead_stream *stream) {
+    if (stream->stop || stream->eof || stream->error) {
+        return 0;
+    }
+    return stream->end - stream->position < readahead_depth_locked(stream) &&
+           stream->end - stream->start < stream->capacity;
+}
+
+static void *readahead_thread(void *arg) {
+    readahead_stream *stream = arg;
+    unsigned char *chunk = malloc(READAHEAD_CHUNK_SIZE);
+    int64_t source_position = 0;
+
+    pthread_mutex_lock(&stream->mutex);
+    if (!chunk) {
+        stream->error = -ENOMEM;
+        pthread_cond_broadcast(&stream->cond);
+    }
+    while (chunk && !stream->stop) {
+        if (!readahead_should_fill_locked(stream)) {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+            continue;
+        }
+
+        int generation = stream->generation;
+        int64_t offset = stream->end;
+        int64_t room = stream->capacity - (stream->end - stream->start);
+        int size = room < READAHEAD_CHUNK_SIZE ? (int)room : READAHEAD_CHUNK_SIZE;
+        pthread_mutex_unlock(&stream->mutex);
+
+        // The source is read without the lock so the reader can consume what is already buffered.
+        int count = 0;
+        if (source_position != offset) {
+            int64_t sought = ffio_stream_seek(stream->source, offset, SEEK_SET);
+            count = sought < 0 ? (int)sought : 0;
+            source_position = sought < 0 ? -1 : offset;
+        }
+        if (count == 0) {
+            count = ffio_stream_read(stream->source, chunk, size);
+            atomic_fetch_add(&g_readahead_source_reads, 1);
+            if (count > 0) {
+                source_position += count;
+                atomic_fetch_add(&g_readahead_source_bytes, count);
+            }
+        }
+
+        pthread_mutex_lock(&stream->mutex);
+        if (generation != stream->generation) {
+            if (count > 0) {
+                atomic_fetch_add(&g_readahead_discarded_bytes, count);
+            }
+            continue;
+        }
+        if (count < 0) {
+            stream->error = count;
+        } else if (count == 0) {
+            stream->eof = 1;
+        } else {
+            int64_t ring_offset = offset % stream->capacity;
+            int64_t first = stream->capacity - ring_offset < count ? stream->capacity - ring_offset : count;
+            memcpy(stream->ring + ring_offset, chunk, (size_t)first);
+            memcpy(stream->ring, chunk + first, (size_t)(count - first));
+            stream->end += count;
+        }
+        pthread_cond_broadcast(&stream->cond);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    free(chunk);
+    return NULL;
+}
+
+static int readahead_open(const char *path, int flags, void **handle, int *is_streamed) {
+    if (flags & FFIO_FLAG_WRITE) {
+        return -EACCES;
+    }
+    char *end = NULL;
+    long long capacity = strtoll(path, &end, 10);
+    if (end == path || *end != '/' || end[1] == '\0') {
+        return -EINVAL;
+    }
+    if (capacity < READAHEAD_MIN_BUFFER) {
+        capacity = READAHEAD_MIN_BUFFER;
+    }
+
+    readahead_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        return -ENOMEM;
+    }
+    int source_streamed = 0;
+    int ret = ffio_stream_open(end + 1, FFIO_FLAG_READ, &stream->source, &source_streamed);
+    if (ret < 0) {
+        free(stream);
+        return ret;
+    }
+    stream->capacity = capacity;
+    stream->ring = malloc((size_t)capacity);
+    stream->size = ffio_stream_seek(stream->source, 0, FFIO_SEEK_SIZE);
+    if (!stream->ring) {
+        ffio_stream_close(stream->source);
+        free(stream);
+        return -ENOMEM;
+    }
+
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->cond, NULL);
+    if (pthread_create(&stream->thread, NULL, readahead_thread, stream) != 0) {
+        pthread_cond_destroy(&stream->cond);
+        pthread_mutex_destroy(&stream->mutex);
+        ffio_stream_close(stream->source);
+        free(stream->ring);
+        free(stream);
+        return -EAGAIN;
+    }
+
+    *handle = stream;
+    *is_streamed = source_streamed;
+    return 0;
+}
+
+static int readahead_read(void *handle, unsigned char *buf, int size) {
+    readahead_stream *stream = handle;
+    pthread_mutex_lock(&stream->mutex);
+
+    int64_t wait_started = 0;
+    while (stream->position >= stream->end && !stream->eof && !stream->error) {
+        if (!wait_started) {
+            wait_started = readahead_now_us();
+        }
+        if (ffio_cancel_requested()) {
+            atomic_fetch_add(&g_readahead_wait_us, readahead_now_us() - wait_started);
+            pthread_mutex_unlock(&stream->mutex);
+            // Not EINTR: libavformat retries that, and fftools stops interrupting once transcoding runs.
+            return -ECANCELED;
+        }
+        pthread_cond_broadcast(&stream->cond);
+        readahead_timed_wait_locked(stream);
+    }
+    if (wait_started) {
+        atomic_fetch_add(&g_readahead_wait_us, readahead_now_us() - wait_started);
+    }
+
+    int count = 0;
+    if (stream->position < stream->end) {
+        int64_t available = stream->end - stream->position;
+        count = available < size ? (int)available : size;
+        int64_t ring_offset = stream->position % stream->capacity;
+        int first = stream->capacity - ring_offset < count ? (int)(stream->capacity - ring_offset) : count;
+        memcpy(buf, stream->ring + ring_offset, (size_t)first);
+        memcpy(buf + first, stream->ring, (size_t)(count - first));
+        stream->position += count;
+        stream->sequential_reads++;
+
+        // Keep a quarter of the buffer behind the reader for short backward seeks.
+        int64_t keep_from = stream->position - stream->capacity / 4;
+        if (keep_from > stream->start) {
+            stream->start = keep_from;
+        }
+        pthread_cond_broadcast(&stream->cond);
+    } else if (stream->error) {
+        count = stream->error;
+    }
+
+    pthread_mutex_unlock(&stream->mutex);
+    return count;
+}
+
+static int64_t readahead_seek(void *handle, int64_t pos, int whence) {
+    readahead_stream *stream = handle;
+    if (whence == FFIO_SEEK_SIZE) {
+        return stream->size;
+    }
+    pthread_mutex_lock(&stream->mutex);
+    int64_t base = whence == SEEK_CUR ? stream->position : whence == SEEK_END ? stream->size : 0;
+    int64_t target = base + pos;
+    if ((whence == SEEK_END && stream->size < 0) || target < 0) {
+        pthread_mutex_unlock(&stream->mutex);
+        return whence == SEEK_END ? -ENOSYS : -EINVAL;
+    }
+
+    if (target >= stream->start && target <= stream->end) {
+        if (target != stream->position) {
+            stream->sequential_reads = 0;
+        }
+        // Release what lies more than a quarter buffer behind the new position, as reads do;
+        // otherwise a seek to the end of a full buffer leaves no room to fill.
+        int64_t keep_from = target - stream->capacity / 4;
+        if (keep_from > stream->start) {
+            stream->start = keep_from;
+        }
+    } else {
+        stream->generation++;
+        stream->start = target;
+        stream->end = target;
+        stream->sequential_reads = 0;
+        stream->eof = 0;
+        stream->error = 0;
+    }
+    stream->position = target;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->mutex);
+    return target;
+}
+
+static int readahead_close(void *handle) {
+    readahead_stream *stream = handle;
+    pthread_mutex_lock(&stream->mutex);
+    stream->stop = 1;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->mutex);
+    pthread_join(stream->thread, NULL);
+
+    int ret = ffio_stream_close(stream->source);
+    pthread_cond_destroy(&stream->cond);
+    pthread_mutex_destroy(&stream->mutex);
+    free(stream->ring);
+    free(stream);
+    return ret;
+}
+
+const ffio_kind ffio_readahead_kind = {
+    .name = "readahead",
+    .open = readahead_open,
+    .read = readahead_read,
+    .write = NULL,
+    .seek = readahead_seek,
+    .close = readahead_close
+};
+
+// --- Throttled input, a stand-in for slow storage in tests ---
+//
+// "shim:throttle/<latency us>/<bytes per second>/<source>" delays every read and write by the
+// latency plus the transfer time at the given rate (0 for unlimited). Only dispatched after
+// ffmpeg_io_enable_test_kinds().
+
+typedef struct {
+    ffio_stream *source;
+    int64_t latency_us;
+    int64_t bytes_per_second;
+} throttle_stream;
+
+static int throttle_open(const char *path, int flags, void **handle, int *is_streamed) {
+    char *end = NULL;
+    long long latency = strtoll(path, &end, 10);
+    if (end == path || *end != '/') {
+        return -EINVAL;
+    }
+    const char *rate_text = end + 1;
+    long long rate = strtoll(rate_text, &end, 10);
+    if (end == rate_text || *end != '/' || end[1] == '\0' || latency < 0 || rate < 0) {
+        return -EINVAL;
+    }
+
+    throttle_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream) {
+        return -ENOMEM;
+    }
+    int ret = ffio_stream_open(end + 1, flags, &stream->source, is_streamed);
+    if (ret < 0) {
+        free(stream);
+        return ret;
+    }
+    stream->latency_us = latency;
+    stream->bytes_per_second = rate;
+    *handle = stream;
+    return 0;
+}
+
+static void throttle_delay(throttle_stream *stream, int count) {
+    int64_t delay = stream->latency_us;
+    if (count > 0 && stream->bytes_per_second > 0) {
+        delay += (int64_t)count * 1000000 / stream->bytes_per_second;
+    }
+    if (delay > 0) {
+        usleep((useconds_t)delay);
+    }
+}
+
+static int throttle_read(void *handle, unsigned char *buf, int size) {
+    throttle_stream *stream = handle;
+    int count = ffio_stream_read(stream->source, buf, size);
+    throttle_delay(stream, count);
+    return count;
+}
+
+static int throttle_write(void *handle, const unsigned char *buf, int size) {
+    throttle_stream *stream = handle;
+    int count = ffio_stream_write(stream->source, buf, size);
+    throttle_delay(stream, count);
+    return count;
+}
+
+static int64_t throttle_seek(void *handle, int64_t pos, int whence) {
+    throttle_stream *stream = handle;
+    return ffio_stream_seek(stream->source, pos, whence);
+}
+
+static int throttle_close(void *handle) {
+    throttle_stream *stream = handle;
+    int ret = ffio_stream_close(stream->source);
+    free(stream);
+    return ret;
+}
+
+const ffio_kind ffio_throttle_kind = {
+    .name = "throttle",
+    .open = throttle_open,
+    .read = throttle_read,
+    .write = throttle_write,
+    .seek = throttle_seek,
+    .close = throttle_close
+};
@@ -1,4 +1,5 @@
 #include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -31,6 +32,10 @@ void term_exit(void);
 
 // FFmpeg logging API
 void av_log_set_level(int level);
+void av_log(void *avcl, int level, const char *fmt, ...);
+
+// CPU count used for automatic codec and filter thread counts; 0 restores detection.
+void av_cpu_force_count(int count);
 
 // --- Global state for Swift log callback ---
 
@@ -38,6 +43,9 @@ static ffmpeg_swift_log_func g_swift_log_func = NULL;
 static pthread_mutex_t g_exec_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t g_log_callback_mutex = PTHREAD_MUTEX_INITIALIZER;
 static atomic_int g_cancel_requested = 0;
+static atomic_int g_watchdog_exit_code = 0;
+static _Thread_local int64_t g_job_deadline_us = 0;
+static _Thread_local int64_t g_job_stall_us = 0;
 
 // Optional: default log level if Swift doesn't set it
 static int g_log_level = 32; // roughly AV_LOG_INFO
@@ -61,6 +69,19 @@ void ffmpeg_clear_cancel(void) {
     atomic_store(&g_cancel_requested, 0);
 }
 
+int ffmpeg_cancel_requested(void) {
+    return atomic_load(&g_cancel_requested);
+}
+
+void ffmpeg_set_job_limits(int64_t deadline_us, int64_t stall_us) {
+    g_job_deadline_us = deadline_us > 0 ? deadline_us : 0;
+    g_job_stall_us = stall_us > 0 ? stall_us : 0;
+}
+
+int ffio_cancel_requested(void) {
+    return atomic_load(&g_cancel_requested);
+}
+
 // --- Setup logging once ---
 
 static int g_logging_initialized = 0;
@@ -86,6 +107,7 @@ static void ffmpeg_setup_logging_if_needed(void) {
 
 int ffmpeg_execute(int argc, char *argv[]) {
     ffmpeg_setup_logging_if_needed();
+    ffio_install();
     ffmpeg_reset();
     set_library_program_name("ffmpeg");
     return ffmpeg_main(argc, argv);
@@ -93,6 +115,7 @@ int ffmpeg_execute(int argc, char *argv[]) {
 
 int ffprobe_execute(int argc, char *argv[]) {
     ffmpeg_setup_logging_if_needed();
+    ffio_install();
     ffmpeg_reset();
     set_library_program_name("ffprobe");
     return ffprobe_main(argc, argv);
@@ -110,6 +133,9 @@ typedef struct {
 
 typedef struct {
     atomic_int *done;
+    int64_t started_us;
+    int64_t deadline_us;
+    int64_t stall_us;
 } cancel_watcher_ctx;
 
 static void close_if_valid(int fd) {
@@ -166,11 +192,39 @@ static void *output_reader_thread(void *arg) {
     return NULL;
 }
 
+// Cancel the run, recording why, once its deadline passes or its progress stops advancing.
+static void cancel_watcher_check_limits(cancel_watcher_ctx *ctx) {
+    int64_t now = ffio_now_us();
+    int exit_code = 0;
+    if (ctx->deadline_us && now - ctx->started_us > ctx->deadline_us) {
+        exit_code = FFMPEG_EXIT_DEADLINE_EXCEEDED;
+    } else if (ctx->stall_us) {
+        // Time a background run spends paused for memory pressure is not a stall.
+        int64_t last_advance = ffio_progress_last_advance_us();
+        int64_t resumed = ffio_pressure_last_resume_us();
+        if (resumed > last_advance && last_advance >= 0) {
+            last_advance = resumed;
+        }
+        if (last_advance >= 0 && !ffio_pressure_paused() && now - last_advance > ctx->stall_us) {
+            exit_code = FFMPEG_EXIT_STALLED;
+        }
+    }
+    if (exit_code) {
+        av_log(NULL, 16 /* AV_LOG_ERROR */, "%s, cancelling\n",
+               exit_code == FFMPEG_EXIT_STALLED ? "No progress within the stall limit" : "Deadline exceeded");
+        atomic_store(&g_watchdog_exit_code, exit_code);
+        ffmpeg_request_cancel();
+    }
+}
+
 static void *cancel_watcher_thread(void *arg) {
     cancel_watcher_ctx *ctx = (cancel_watcher_ctx *)arg;
     int cancel_requested = 0;
 
     while (!atomic_load(ctx->done)) {
+        if (!atomic_load(&g_cancel_requested)) {
+            cancel_watcher_check_limits(ctx);
+        }
         if (!atomic_load(&g_cancel_requested)) {
             usleep(20000);
             continue;
@@ -189,14 +243,21 @@ static void *cancel_watcher_thread(void *arg) {
 
 static int execute_tool_main(int argc, char *argv[], int (*tool_main)(int, char *[]), const char *program_name) {
     ffmpeg_setup_logging_if_needed();
+    ffio_install();
     ffmpeg_clear_cancel();
     ffmpeg_reset();
     set_library_program_name(program_name);
     term_init();
+    av_cpu_force_count(ffio_pressure_begin_job());
 
     atomic_int cancel_done = 0;
+    atomic_store(&g_watchdog_exit_code, 0);
+    ffio_progress_reset();
     cancel_watcher_ctx cancel_ctx = {
-        .done = &cancel_done
+        .done = &cancel_done,
+        .started_us = ffio_now_us(),
+        .deadline_us = g_job_deadline_us,
+        .stall_us = g_job_stall_us
     };
     pthread_t cancel_tid;
     int cancel_started = (pthread_create(&cancel_tid, NULL, cancel_watcher_thread, &cancel_ctx) == 0);
@@ -209,10 +270,12 @@ static int execute_tool_main(int argc, char *argv[], int (*tool_main)(int, char
     }
 
     ffmpeg_clear_cancel();
-    return exit_code;
+    // A run that still completed when the watchdog fired keeps its own result.
+    int watchdog_exit_code = atomic_load(&g_watchdog_exit_code);
+    return watchdog_exit_code && exit_code != 0 ? watchdog_exit_code : exit_code;
 }
 
-static int execute_with_output_common(
+static int execute_with_output_once(
     int argc,
     char *argv[],
     char *stdout_buffer,
@@ -222,7 +285,10 @@ static int execute_with_output_common(
     int (*tool_main)(int, char *[]),
     const char *program_name
 ) {
+    ffio_pressure_wait_admission();
+    ffio_pressure_queue(1);
     pthread_mutex_lock(&g_exec_mutex);
+    ffio_pressure_queue(-1);
 
     if (stdout_buffer && stdout_buffer_size > 0) {
         stdout_buffer[0] = '\0';
@@ -332,6 +398,34 @@ static int execute_with_output_common(
     return exit_code;
 }
 
+static int execute_with_output_common(
+    int argc,
+    char *argv[],
+    char *stdout_buffer,
+    size_t stdout_buffer_size,
+    char *stderr_buffer,
+    size_t stderr_buffer_size,
+    int (*tool_main)(int, char *[]),
+    const char *program_name
+) {
+    // A background run paused under critical pressure gives the execution slot up to a waiting run
+    // by cancelling itself; it starts over once pressure lets it in again.
+    int exit_code;
+    do {
+        exit_code = execute_with_output_once(
+            argc,
+            argv,
+            stdout_buffer,
+            stdout_buffer_size,
+            stderr_buffer,
+            stderr_buffer_size,
+            tool_main,
+            program_name
+        );
+    } while (ffio_pressure_take_yield());
+    return exit_code;
+}
+
 int ffmpeg_execute_with_output(
     int argc,
     char *argv[],
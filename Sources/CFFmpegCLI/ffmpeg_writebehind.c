@@ -0,0 +1,359 @@
+#include "ffmpeg_wrapper.h"
+#include "ffmpeg_io.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// --- Write-behind output ---
+//
+// "shim:writebehind/<budget bytes>/<sink>" copies every muxer write into a queue that a background
+// thread applies to the sink (a local path or another shim URL) in order. Each queued write carries
+// its own offset, so a muxer seeking back to patch a header simply queues a write at the earlier
+// offset and the final bytes match a synchronous write. The muxer only blocks when the queue holds
+// more than the budget. A muxer that reopens its output for reading (mov +faststart) gets a reader
+// that drains the queue before every read.
+
+typedef struct writebehind_op {
+    struct writebehind_op *next;
+    int64_t offset;
+    int size;
+    unsigned char data[];
+} writebehind_op;
+
+typedef struct writebehind_stream {
+    struct writebehind_stream *next_open;
+    char *sink_url;
+    ffio_stream *sink;
+    int references;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    writebehind_op *head;
+    writebehind_op *tail;
+    int64_t queued_bytes;
+    int64_t budget;
+    int writing;
+    int error;
+    int stop;
+
+    int64_t position;
+    int64_t size;
+} writebehind_stream;
+
+// An open handle: the writer itself, or a reader of the sink that waits for the writer's queue.
+typedef struct {
+    writebehind_stream *stream;
+    ffio_stream *reader;
+} writebehind_handle;
+
+static pthread_mutex_t g_writebehind_mutex = PTHREAD_MUTEX_INITIALIZER;
+static writebehind_stream *g_writebehind_open;
+
+static atomic_llong g_writebehind_bytes;
+static atomic_llong g_writebehind_stall_us;
+static atomic_llong g_writebehind_peak_queued;
+
+void ffmpeg_writebehind_get_stats(ffmpeg_writebehind_stats *stats) {
+    stats->bytes_written = atomic_load(&g_writebehind_bytes);
+    stats->stall_us = atomic_load(&g_writebehind_stall_us);
+    stats->peak_queued_bytes = atomic_load(&g_writebehind_peak_queued);
+}
+
+static int64_t writebehind_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void *writebehind_thread(void *arg) {
+    writebehind_stream *stream = arg;
+    int64_t sink_position = 0;
+
+    pthread_mutex_lock(&stream->mutex);
+    for (;;) {
+        while (!stream->head && !stream->stop) {
+            pthread_cond_wait(&stream->cond, &stream->mutex);
+        }
+        writebehind_op *op = stream->head;
+        if (!op) {
+            break;
+        }
+        stream->writing = 1;
+        pthread_mutex_unlock(&stream->mutex);
+
+        int ret = 0;
+        if (sink_position != op->offset) {
+            int64_t sought = ffio_stream_seek(stream->sink, op->offset, SEEK_SET);
+            ret = sought < 0 ? (int)sought : 0;
+            sink_position = sought < 0 ? -1 : op->offset;
+        }
+        for (int done = 0; ret == 0 && done < op->size;) {
+            int written = ffio_stream_write(stream->sink, op->data + done, op->size - done);
+            if (written <= 0) {
+                ret = written < 0 ? written : -EIO;
+                break;
+            }
+            done += written;
+            sink_position += written;
+        }
+        if (ret == 0) {
+            atomic_fetch_add(&g_writebehind_bytes, op->size);
+        }
+
+        pthread_mutex_lock(&stream->mutex);
+        stream->head = op->next;
+        if (!stream->head) {
+            stream->tail = NULL;
+        }
+        stream->queued_bytes -= op->size;
+        stream->writing = 0;
+        if (ret < 0 && !stream->error) {
+            stream->error = ret;
+        }
+        free(op);
+        pthread_cond_broadcast(&stream->cond);
+    }
+    pthread_mutex_unlock(&stream->mutex);
+    return NULL;
+}
+
+// Wait until everything queued so far has reached the sink.
+static int writebehind_drain(writebehind_stream *stream) {
+    pthread_mutex_lock(&stream->mutex);
+    while ((stream->head || stream->writing) && !stream->error) {
+        pthread_cond_wait(&stream->cond, &stream->mutex);
+    }
+    int ret = stream->error;
+    pthread_mutex_unlock(&stream->mutex);
+    return ret;
+}
+
+static void writebehind_release(writebehind_stream *stream) {
+    pthread_mutex_lock(&g_writebehind_mutex);
+    int last = --stream->references == 0;
+    pthread_mutex_unlock(&g_writebehind_mutex);
+    if (last) {
+        pthread_cond_destroy(&stream->cond);
+        pthread_mutex_destroy(&stream->mutex);
+        free(stream->sink_url);
+        free(stream);
+    }
+}
+
+static int writebehind_open_reader(const char *sink_url, writebehind_handle *handle, int *is_streamed) {
+    int ret = ffio_stream_open(sink_url, FFIO_FLAG_READ, &handle->reader, is_streamed);
+    if (ret < 0) {
+        return ret;
+    }
+
+    pthread_mutex_lock(&g_writebehind_mutex);
+    for (writebehind_stream *open = g_writebehind_open; open; open = open->next_open) {
+        if (strcmp(open->sink_url, sink_url) == 0) {
+            open->references++;
+            handle->stream = open;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_writebehind_mutex);
+    return 0;
+}
+
+static int writebehind_open_writer(const char *sink_url, int flags, int64_t budget, writebehind_handle *handle, int *is_streamed) {
+    writebehind_stream *stream = calloc(1, sizeof(*stream));
+    if (!stream || !(stream->sink_url = strdup(sink_url))) {
+        free(stream);
+        return -ENOMEM;
+    }
+    int ret = ffio_stream_open(sink_url, flags, &stream->sink, is_streamed);
+    if (ret < 0) {
+        free(stream->sink_url);
+        free(stream);
+        return ret;
+    }
+    stream->budget = budget;
+    stream->references = 1;
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->cond, NULL);
+    if (pthread_create(&stream->thread, NULL, writebehind_thread, stream) != 0) {
+        ffio_stream_close(stream->sink);
+        writebehind_release(stream);
+        return -EAGAIN;
+    }
+
+    pthread_mutex_lock(&g_writebehind_mutex);
+    stream->next_open = g_writebehind_open;
+    g_writebehind_open = stream;
+    pthread_mutex_unlock(&g_writebehind_mutex);
+
+    handle->stream = stream;
+    return 0;
+}
+
+static int writebehind_open(const char *path, int flags, void **handle, int *is_streamed) {
+    char *end = NULL;
+    long long budget = strtoll(path, &end, 10);
+    if (end == path || *end != '/' || end[1] == '\0' || budget <= 0) {
+        return -EINVAL;
+    }
+
+    writebehind_handle *opened = calloc(1, sizeof(*opened));
+    if (!opened) {
+        return -ENOMEM;
+    }
+    int ret = (flags & FFIO_FLAG_WRITE)
+        ? writebehind_open_writer(end + 1, flags, budget, opened, is_streamed)
+        : writebehind_open_reader(end + 1, opened, is_streamed);
+    if (ret < 0) {
+        free(opened);
+        return ret;
+    }
+    *handle = opened;
+    return 0;
+}
+
+static int writebehind_write(void *handle, const unsigned char *buf, int size) {
+    writebehind_handle *opened = handle;
+    writebehind_stream *stream = opened->stream;
+    if (opened->reader) {
+        return -EBADF;
+    }
+
+    writebehind_op *op = malloc(sizeof(*op) + (size_t)size);
+    if (!op) {
+        return -ENOMEM;
+    }
+    op->next = NULL;
+    op->offset = stream->position;
+    op->size = size;
+    memcpy(op->data, buf, (size_t)size);
+
+    pthread_mutex_lock(&stream->mutex);
+    int64_t stall_started = 0;
+    // A single write larger than the budget is queued once the queue is empty.
+    while (stream->queued_bytes > 0 && stream->queued_bytes + size > stream->budget && !stream->error) {
+        if (!stall_started) {
+            stall_started = writebehind_now_us();
+        }
+        pthread_cond_wait(&stream->cond, &stream->mutex);
+    }
+    if (stall_started) {
+        atomic_fetch_add(&g_writebehind_stall_us, writebehind_now_us() - stall_started);
+    }
+    if (stream->error) {
+        int ret = stream->error;
+        pthread_mutex_unlock(&stream->mutex);
+        free(op);
+        return ret;
+    }
+
+    if (stream->tail) {
+        stream->tail->next = op;
+    } else {
+        stream->head = op;
+    }
+    stream->tail = op;
+    stream->queued_bytes += size;
+    long long peak = atomic_load(&g_writebehind_peak_queued);
+    while (stream->queued_bytes > peak &&
+           !atomic_compare_exchange_weak(&g_writebehind_peak_queued, &peak, stream->queued_bytes)) {
+    }
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->mutex);
+
+    stream->position += size;
+    if (stream->position > stream->size) {
+        stream->size = stream->position;
+    }
+    return size;
+}
+
+static int writebehind_read(void *handle, unsigned char *buf, int size) {
+    writebehind_handle *opened = handle;
+    if (!opened->reader) {
+        return -EBADF;
+    }
+    if (opened->stream) {
+        int ret = writebehind_drain(opened->stream);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return ffio_stream_read(opened->reader, buf, size);
+}
+
+static int64_t writebehind_seek(void *handle, int64_t pos, int whence) {
+    writebehind_handle *opened = handle;
+    writebehind_stream *stream = opened->stream;
+    if (opened->reader) {
+        if (stream) {
+            int ret = writebehind_drain(stream);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+        return ffio_stream_seek(opened->reader, pos, whence);
+    }
+
+    // Seeks only move the offset of later writes; the queue applies them in order.
+    if (whence == FFIO_SEEK_SIZE) {
+        return stream->size;
+    }
+    int64_t base = whence == SEEK_CUR ? stream->position : whence == SEEK_END ? stream->size : 0;
+    if (base + pos < 0) {
+        return -EINVAL;
+    }
+    stream->position = base + pos;
+    return stream->position;
+}
+
+static int writebehind_close(void *handle) {
+    writebehind_handle *opened = handle;
+    writebehind_stream *stream = opened->stream;
+    int ret = 0;
+
+    if (opened->reader) {
+        ret = ffio_stream_close(opened->reader);
+        if (stream) {
+            writebehind_release(stream);
+        }
+        free(opened);
+        return ret;
+    }
+
+    pthread_mutex_lock(&g_writebehind_mutex);
+    for (writebehind_stream **link = &g_writebehind_open; *link; link = &(*link)->next_open) {
+        if (*link == stream) {
+            *link = stream->next_open;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_writebehind_mutex);
+
+    pthread_mutex_lock(&stream->mutex);
+    stream->stop = 1;
+    pthread_cond_broadcast(&stream->cond);
+    pthread_mutex_unlock(&stream->mutex);
+    pthread_join(stream->thread, NULL);
+
+    ret = stream->error;
+    int close_ret = ffio_stream_close(stream->sink);
+    writebehind_release(stream);
+    free(opened);
+    return ret < 0 ? ret : close_ret;
+}
+
+const ffio_kind ffio_writebehind_kind = {
+    .name = "writebehind",
+    .open = writebehind_open,
+    .read = writebehind_read,
+    .write = writebehind_write,
+    .seek = writebehind_seek,
+    .close = writebehind_close
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +29,21 @@ void ffmpeg_request_cancel(void);
 /// Clear any pending FFmpeg/ffprobe cancellation request.
 void ffmpeg_clear_cancel(void);
 
+/// \return Nonzero once cancellation of the active execution was requested, by the caller or a watchdog
+int ffmpeg_cancel_requested(void);
+
+/// Exit code of a run cancelled because its deadline passed.
+#define FFMPEG_EXIT_DEADLINE_EXCEEDED 124
+
+/// Exit code of a run cancelled because its progress stopped advancing.
+#define FFMPEG_EXIT_STALLED 125
+
+/// Set watchdog limits for runs started on the calling thread; 0 disables a limit.
+/// The stall limit only applies to ffmpeg runs writing "-progress shim:progress/<any>".
+/// \param deadline_us Longest wall-clock time a run may take
+/// \param stall_us Longest time frame, size and output time counters may stay unchanged
+void ffmpeg_set_job_limits(int64_t deadline_us, int64_t stall_us);
+
 /// Execute ffprobe as if calling its CLI.
 /// \param argc Number of arguments
 /// \param argv Array of C strings (argv[0] is normally "ffprobe")
@@ -68,6 +84,259 @@ int ffprobe_execute_with_output(
     size_t stderr_buffer_size
 );
 
+/// Returned by ffmpeg_mp4_edit_metadata when the edit cannot be applied in place
+/// and the file has to be rewritten (for example by a `-c copy` remux).
+#define FFMPEG_MP4_EDIT_NEEDS_REWRITE 1
+
+/// Edit MP4/MOV metadata and display rotation by rewriting only the `moov` atom.
+/// On file systems that clone files (APFS, Btrfs, XFS) the edit goes to a clone that atomically
+/// replaces `path`; elsewhere `moov` is overwritten in place and synced, so a crash during the write
+/// can leave the file damaged.
+/// \param path File to edit
+/// \param keys Metadata keys (FFmpeg mov muxer names such as "title", "artist", "comment")
+/// \param values Values for `keys`; an empty string removes the tag
+/// \param count Number of key/value pairs
+/// \param rotation Clockwise display rotation (0, 90, 180, 270), or -1 to leave it unchanged
+/// \return 0 on success, FFMPEG_MP4_EDIT_NEEDS_REWRITE when `moov` has no room to grow or its
+///         `udta/meta` is not an iTunes-style item list (a handler other than `mdir`, such as a
+///         QuickTime `mdta` meta with `keys`), or a negative errno value (-EINVAL also covers keys
+///         that have no atom mapping)
+int ffmpeg_mp4_edit_metadata(
+    const char *path,
+    const char *const *keys,
+    const char *const *values,
+    int count,
+    int rotation
+);
+
+/// A top-level MP4/MOV atom.
+typedef struct {
+    uint32_t type;   ///< Four-character code, big-endian (e.g. 'moof')
+    int64_t offset;  ///< Byte offset of the atom header
+    int64_t size;    ///< Atom size including its header
+} ffmpeg_mp4_atom;
+
+/// List the top-level atoms of an MP4/MOV file without reading media data.
+/// \param path File to scan
+/// \param atoms Output array (may be NULL when max_atoms is 0)
+/// \param max_atoms Capacity of `atoms`
+/// \return Total number of atoms in the file (call again with a larger array if it exceeds
+///         max_atoms), or a negative errno value. A truncated trailing atom ends the scan.
+int ffmpeg_mp4_scan_atoms(const char *path, ffmpeg_mp4_atom *atoms, int max_atoms);
+
+/// Hashes of an output written through a `shim:hash/<id>/<name>` URL.
+typedef struct {
+    char content_hash[65];   ///< Hex SHA-256 of the concatenated SHA-256 digests of each 4 MiB block
+    char sha256[65];         ///< Hex SHA-256 of the whole file, or empty unless it was written sequentially
+    int64_t bytes_total;     ///< Final file size
+    int64_t bytes_written;   ///< Bytes passed to write, including rewritten header bytes
+    int64_t bytes_rehashed;  ///< Bytes read back at close because they changed after being hashed
+    int sequential;          ///< 1 when the muxer never seeked while writing
+} ffmpeg_output_hash;
+
+/// Register an output file that is hashed while FFmpeg writes it.
+/// Pass "shim:hash/<id>/<name>" as the output URL, where <name> keeps the extension used for
+/// format guessing. The file is created at `path`.
+/// \return Output id (>= 0), or a negative errno value
+int ffmpeg_hash_output_create(const char *path);
+
+/// Collect the hashes of a registered output and release its id.
+/// \return 0 on success, -ENOENT if the output was never completely written, or a negative errno value
+int ffmpeg_hash_output_finish(int id, ffmpeg_output_hash *result);
+
+/// Create a scope for memory-backed intermediate files.
+/// Files are named "shim:mem/<scope>/<name>" and created when first opened for writing. They are
+/// held in a memfd on Linux and in heap memory elsewhere, and never touch the file system.
+/// \return Scope id (>= 0), or a negative errno value
+int ffmpeg_memfile_scope_create(void);
+
+/// Free every file in a scope. Files still open by a running job are freed when they close.
+void ffmpeg_memfile_scope_release(int scope);
+
+/// \return Size of a memory file in bytes, or -ENOENT if it does not exist
+int64_t ffmpeg_memfile_size(int scope, const char *name);
+
+/// Copy bytes out of a memory file.
+/// \return Bytes copied (0 at the end of the file), or a negative errno value
+int64_t ffmpeg_memfile_read(int scope, const char *name, int64_t offset, void *buffer, int64_t size);
+
+/// \return Total bytes held in memory by the files in a scope, excluding spilled files
+int64_t ffmpeg_memfile_scope_bytes(int scope);
+
+/// Bound the memory a scope holds. A write that would take the scope past `memory_limit` bytes
+/// first moves the file being written to an unlinked temporary file in `spill_directory`, where it
+/// stays until released; its URL does not change.
+/// \param memory_limit Bytes, or 0 for no limit
+/// \return 0 on success, or a negative errno value
+int ffmpeg_memfile_scope_set_limit(int scope, int64_t memory_limit, const char *spill_directory);
+
+/// \return Total bytes of the files in a scope that were spilled to disk
+int64_t ffmpeg_memfile_spilled_bytes(int scope);
+
+/// Move every file of a scope that is still in memory to disk now, as a limit would on its next write.
+/// \return Bytes moved
+int64_t ffmpeg_memfile_scope_spill(int scope);
+
+/// Counters for all "shim:readahead/<buffer bytes>/<source>" inputs since launch.
+typedef struct {
+    int64_t source_bytes;     ///< Bytes read from sources by prefetch threads
+    int64_t source_reads;     ///< Read requests prefetch threads made to sources
+    int64_t discarded_bytes;  ///< Prefetched bytes dropped because the reader seeked away
+    int64_t reader_wait_us;   ///< Time demuxers spent waiting for data that was not prefetched yet
+} ffmpeg_readahead_stats;
+
+/// Read the cumulative read-ahead counters.
+void ffmpeg_readahead_get_stats(ffmpeg_readahead_stats *stats);
+
+/// Test hook: make "shim:throttle/<latency us>/<bytes per second>/<source>", a stand-in for slow
+/// storage, available to jobs. It is not recognized until this is called.
+void ffmpeg_io_enable_test_kinds(void);
+
+/// Counters for all "shim:writebehind/<budget bytes>/<sink>" outputs since launch.
+typedef struct {
+    int64_t bytes_written;      ///< Bytes applied to sinks by writer threads
+    int64_t stall_us;           ///< Time muxers spent blocked because a queue was over budget
+    int64_t peak_queued_bytes;  ///< Largest amount of data queued for one output
+} ffmpeg_writebehind_stats;
+
+/// Read the cumulative write-behind counters.
+void ffmpeg_writebehind_get_stats(ffmpeg_writebehind_stats *stats);
+
+/// Longest validator (ETag or Last-Modified value) kept for an HTTP resource, including the terminator.
+#define FFMPEG_HTTP_VALIDATOR_SIZE 256
+
+/// Description of an HTTP resource returned by a fetch.
+typedef struct {
+    int64_t size;                                  ///< Total resource size, or -1 if unknown
+    char validator[FFMPEG_HTTP_VALIDATOR_SIZE];    ///< ETag, else Last-Modified, else empty
+} ffmpeg_http_resource;
+
+/// Fetch `length` bytes at `offset` of `url` into `buffer` with a range request.
+/// A `length` of 0 only describes the resource (a one-byte range request, since some servers
+/// refuse HEAD). Fetchers return -ECANCELED once the running job is cancelled.
+/// \return Bytes fetched, or a negative errno value
+typedef int64_t (*ffmpeg_http_fetch_func)(
+    const char *url,
+    int64_t offset,
+    int64_t length,
+    void *buffer,
+    ffmpeg_http_resource *resource
+);
+
+/// Register the function "shim:httpcache/<url>" and "shim:http/<url>" inputs use to reach the network.
+void ffmpeg_http_set_fetcher(ffmpeg_http_fetch_func fetch);
+
+/// Configure the HTTP range cache.
+/// \param directory Directory for cached blocks, or NULL for memory only
+/// \param memory_bytes Memory budget for cached blocks
+/// \param disk_bytes Disk budget for cached blocks
+/// \return 0 on success
+int ffmpeg_httpcache_configure(const char *directory, int64_t memory_bytes, int64_t disk_bytes);
+
+/// Drop every cached block from memory and disk.
+void ffmpeg_httpcache_clear(void);
+
+/// Counters for all "shim:httpcache/<url>" inputs since launch.
+typedef struct {
+    int64_t requests;          ///< HTTP requests made, including revalidation on open
+    int64_t fetched_bytes;     ///< Bytes transferred by range requests
+    int64_t memory_hit_bytes;  ///< Bytes served from cached blocks in memory
+    int64_t disk_hit_bytes;    ///< Bytes served from cached blocks on disk
+} ffmpeg_httpcache_stats;
+
+/// Read the cumulative HTTP cache counters.
+void ffmpeg_httpcache_get_stats(ffmpeg_httpcache_stats *stats);
+
+/// Create a caller-fed input, read by a job as "shim:feed/<id>".
+/// \param capacity Bytes buffered between the caller and the demuxer
+/// \return Feed id, or -1 on failure
+int ffmpeg_feed_create(int64_t capacity);
+
+/// Push bytes into a feed.
+/// \param blocking Nonzero to wait while the buffer is full, zero to accept only what fits now
+/// \return Bytes accepted, or -EPIPE once the job stopped reading or the feed ended
+int64_t ffmpeg_feed_write(int id, const void *data, int64_t size, int blocking);
+
+/// Signal end of stream; the job reads what is buffered, then sees EOF.
+void ffmpeg_feed_finish(int id);
+
+/// End the stream with an error; the job's next read fails.
+void ffmpeg_feed_abort(int id);
+
+/// Bytes written but not yet read, or -1 for an unknown feed.
+int64_t ffmpeg_feed_buffered(int id);
+
+/// Free a feed. A job still reading it sees an error unless the feed was finished.
+void ffmpeg_feed_release(int id);
+
+/// Create a latency probe, written by a job as "-stats_mux_pre shim:latency/<id> -stats_mux_pre_fmt '{pts} {tb}'"
+/// with wall-clock input timestamps. Samples are taken before the muxer's interleaving queue.
+/// \return Probe id, or -1 when all probes are in use
+int ffmpeg_latency_probe_create(void);
+
+/// Copy per-packet latencies of a probe, in microseconds, in muxing order.
+/// \param latencies_us Destination, or NULL to only count
+/// \param max_count Capacity of latencies_us
+/// \return Number of samples recorded, or -1 for an unknown probe
+int64_t ffmpeg_latency_probe_samples(int id, int64_t *latencies_us, int64_t max_count);
+
+/// Free a latency probe.
+void ffmpeg_latency_probe_release(int id);
+
+/// Memory pressure levels.
+#define FFMPEG_PRESSURE_NORMAL   0
+#define FFMPEG_PRESSURE_WARNING  1
+#define FFMPEG_PRESSURE_CRITICAL 2
+
+/// What the shim did in response to a pressure signal.
+typedef struct {
+    int level;                         ///< Level now in effect
+    int64_t httpcache_bytes_released;  ///< Bytes freed from the HTTP cache memory tier
+    int64_t memfile_bytes_spilled;     ///< Bytes of memory files moved to temporary files on disk
+    int thread_budget;                 ///< Codec and filter threads for jobs started from now on, 0 for automatic
+} ffmpeg_pressure_response;
+
+/// Set the memory pressure level. Warning halves the HTTP cache memory budget and the thread budget;
+/// critical empties the cache, spills memory files to disk, allows one thread, and pauses background
+/// jobs; normal restores the budgets.
+/// \param response Filled with the measures taken, or NULL
+void ffmpeg_pressure_signal(int level, ffmpeg_pressure_response *response);
+
+/// \return The memory pressure level in effect
+int ffmpeg_pressure_level(void);
+
+/// Mark runs started on the calling thread as background work, paused under critical pressure.
+/// A paused run holds the execution slot, so when another run is waiting for it the paused run
+/// cancels itself and starts over once pressure drops; its outputs must be safe to rewrite.
+void ffmpeg_set_job_background(int background);
+
+/// Receives pressure level changes from the monitor.
+typedef void (*ffmpeg_pressure_func)(int level);
+
+/// Poll Linux pressure stall information (/proc/pressure/memory) and report level changes.
+/// \param warning_avg10 "some" avg10 percentage from which the level is warning
+/// \param critical_avg10 "full" avg10 percentage from which the level is critical
+/// \param interval_ms Polling interval
+/// \param callback Called on the monitor thread with each new level
+/// \return 0 on success, -ENOSYS off Linux, or another negative errno value
+int ffmpeg_pressure_monitor_start(double warning_avg10, double critical_avg10, int interval_ms, ffmpeg_pressure_func callback);
+
+/// Stop the PSI monitor, if running.
+void ffmpeg_pressure_monitor_stop(void);
+
+/// Counters for memory pressure responses since launch.
+typedef struct {
+    int64_t signals;                   ///< Pressure signals received
+    int64_t httpcache_bytes_released;  ///< Bytes freed from the HTTP cache memory tier
+    int64_t background_pauses;         ///< Times a background job waited for pressure to clear
+    int64_t paused_us;                 ///< Time background jobs spent waiting
+    int64_t background_requeues;       ///< Background runs cancelled and restarted to let another run in
+    int64_t memfile_bytes_spilled;     ///< Bytes of memory files moved to disk
+} ffmpeg_pressure_stats;
+
+/// Read the cumulative memory pressure counters.
+void ffmpeg_pressure_get_stats(ffmpeg_pressure_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
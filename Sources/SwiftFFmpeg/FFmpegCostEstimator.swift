@@ -0,0 +1,437 @@
+import Foundation
+#if canImport(Darwin)
+import Darwin
+#endif
+
+/// Predicts the wall time and peak memory of ffmpeg jobs on this device, for ordering a job queue.
+///
+/// A `Calibration` is produced once per device (and FFmpeg build) by short lavfi micro-benchmarks:
+/// per-run overhead, encode and decode throughput in pixels per second, audio encode speed, stream
+/// copy throughput, and how many frames' worth of memory a transcode keeps in flight. An estimate
+/// probes the job's inputs (cached by path, size and modification time), reads the codecs, output
+/// size and duration limits from the arguments, and scales the calibrated rates.
+///
+/// Running jobs through `execute(_:)` records predicted against actual time and peak memory, and
+/// `accuracy` summarizes the error so far.
+public final class FFmpegCostEstimator {
+    public struct Calibration: Codable, Equatable {
+        /// `ffmpeg -version` line of the build that was measured.
+        public var buildVersion: String
+        /// Fixed cost of starting and finishing a run.
+        public var runOverhead: TimeInterval
+        /// Encoded pixels per second, by encoder name.
+        public var encodePixelsPerSecond: [String: Double]
+        /// Decoded pixels per second, by codec name as ffprobe reports it.
+        public var decodePixelsPerSecond: [String: Double]
+        /// Media seconds of audio encoded per second, by encoder name.
+        public var audioSecondsPerSecond: [String: Double]
+        /// Bytes per second of `-c copy` remuxing.
+        public var copyBytesPerSecond: Double
+        /// Memory a run needs regardless of frame size.
+        public var baseMemoryBytes: Int64
+        /// Peak memory above the base, in units of one frame of the largest picture in the job.
+        public var framesInFlight: Double
+    }
+
+    public struct Estimate {
+        public let wallTime: TimeInterval
+        public let peakMemoryBytes: Int64
+        /// Media seconds the job is expected to process.
+        public let mediaDuration: Double
+    }
+
+    public struct Accuracy {
+        public let samples: Int
+        /// Mean of |actual - predicted| / actual for wall time.
+        public let wallTimeError: Double
+        /// Mean of |actual - predicted| / actual for peak memory.
+        public let memoryError: Double
+        /// Mean of actual / predicted wall time; above 1 means estimates run short.
+        public let wallTimeBias: Double
+    }
+
+    public struct Execution {
+        public let execution: FFmpegExecutionResult
+        public let estimate: Estimate
+        public let wallTime: TimeInterval
+        public let peakMemoryBytes: Int64
+    }
+
+    public let calibration: Calibration
+
+    private let lock = NSLock()
+    private var probes: [String: FFmpegMediaInfo] = [:]
+    private var records: [(predicted: Estimate, wallTime: TimeInterval, peakMemory: Int64)] = []
+
+    private static let instancesLock = NSLock()
+    private static let instances = NSHashTable<FFmpegCostEstimator>.weakObjects()
+
+    public init(calibration: Calibration) {
+        self.calibration = calibration
+        Self.instancesLock.lock()
+        Self.instances.add(self)
+        Self.instancesLock.unlock()
+    }
+
+    /// Drop the probe caches of every live estimator; returns the approximate bytes they held.
+    static func releaseProbeCaches() -> Int {
+        instancesLock.lock()
+        let estimators = instances.allObjects
+        instancesLock.unlock()
+        return estimators.reduce(0) { $0 + $1.releaseProbeCache() }
+    }
+
+    private func releaseProbeCache() -> Int {
+        lock.lock()
+        let released = probes.reduce(0) { total, probe in
+            total + probe.key.utf8.count
+                + MemoryLayout<FFmpegMediaInfo>.stride
+                + probe.value.streams.count * MemoryLayout<FFmpegMediaInfo.Stream>.stride
+        }
+        probes.removeAll()
+        lock.unlock()
+        return released
+    }
+
+    /// Load the calibration stored at `url` when it was made with this FFmpeg build, otherwise
+    /// calibrate and store the result there.
+    public static func loadOrCalibrate(at url: URL) throws -> FFmpegCostEstimator {
+        if let data = try? Data(contentsOf: url),
+           let stored = try? JSONDecoder().decode(Calibration.self, from: data),
+           stored.buildVersion == SwiftFFmpeg.buildVersion {
+            return FFmpegCostEstimator(calibration: stored)
+        }
+        let calibration = try calibrate()
+        try FileManager.default.createDirectory(at: url.deletingLastPathComponent(), withIntermediateDirectories: true)
+        try JSONEncoder().encode(calibration).write(to: url, options: .atomic)
+        return FFmpegCostEstimator(calibration: calibration)
+    }
+
+    /// Run the micro-benchmarks, about `seconds` of media per measurement at 1280x720.
+    public static func calibrate(seconds: Double = 2, encoders: [String] = ["mpeg4", "h264_videotoolbox"]) throws -> Calibration {
+        let width = 1280, height = 720, rate = 30.0
+        let pixels = Double(width * height) * rate * seconds
+        let source = "testsrc2=size=\(width)x\(height):rate=\(Int(rate)):duration=\(seconds)"
+
+        let overhead = try measure(["-f", "lavfi", "-i", "testsrc2=size=160x120:rate=25:duration=0.04", "-f", "null", "-"])
+        let generate = try measure(["-f", "lavfi", "-i", source, "-f", "null", "-"])
+
+        var encodeRates: [String: Double] = [:]
+        var framesInFlight = 0.0
+        for encoder in encoders {
+            // Encoders missing from this build or unavailable on this device are skipped.
+            guard let run = try? measure(["-f", "lavfi", "-i", source, "-c:v", encoder, "-f", "null", "-"]) else { continue }
+            encodeRates[encoder] = pixels / max(run.time - generate.time, 0.001)
+            let frameBytes = Double(width * height) * 1.5
+            framesInFlight = max(framesInFlight, Double(run.peakMemory - overhead.peakMemory) / frameBytes)
+        }
+        guard !encodeRates.isEmpty else {
+            throw SwiftFFmpegError.invalidArgument("none of \(encoders) could be benchmarked")
+        }
+
+        // Decode speed differs widely between codecs, so each is measured on a sample of its own,
+        // made with the first of its encoders this build and device provide.
+        var decodeRates: [String: Double] = [:]
+        var copyRate = 0.0
+        for (codec, encoderArguments) in decodeSamples where decodeRates[codec] == nil {
+            let sample = FileManager.default.temporaryDirectory.appendingPathComponent("calibration-\(UUID().uuidString).mp4")
+            defer { try? FileManager.default.removeItem(at: sample) }
+            guard (try? SwiftFFmpeg.executeDetailed(["-y", "-f", "lavfi", "-i", source] + encoderArguments + [sample.path])) != nil else {
+                continue
+            }
+            let decode = try measure(["-i", sample.path, "-f", "null", "-"])
+            decodeRates[codec] = pixels / max(decode.time - overhead.time, 0.001)
+            if codec == "mpeg4" {
+                let sampleBytes = (try? FileManager.default.attributesOfItem(atPath: sample.path)[.size] as? Int64) ?? 0
+                let copy = try measure(["-i", sample.path, "-c", "copy", "-f", "null", "-"])
+                copyRate = Double(sampleBytes) / max(copy.time - overhead.time, 0.001)
+            }
+        }
+
+        var audioRates: [String: Double] = [:]
+        let audioSeconds = seconds * 10
+        if let aac = try? measure(["-f", "lavfi", "-i", "sine=duration=\(audioSeconds)", "-c:a", "aac", "-f", "null", "-"]) {
+            audioRates["aac"] = audioSeconds / max(aac.time - overhead.time, 0.001)
+        }
+
+        return Calibration(
+            buildVersion: SwiftFFmpeg.buildVersion,
+            runOverhead: overhead.time,
+            encodePixelsPerSecond: encodeRates,
+            decodePixelsPerSecond: decodeRates,
+            audioSecondsPerSecond: audioRates,
+            copyBytesPerSecond: copyRate,
+            baseMemoryBytes: max(overhead.peakMemory, 0),
+            framesInFlight: max(framesInFlight, 1)
+        )
+    }
+
+    /// Codecs whose decode speed is calibrated, with the encoders that can make their samples.
+    private static let decodeSamples: [(codec: String, encoderArguments: [String])] = [
+        ("mpeg4", ["-c:v", "mpeg4", "-q:v", "4"]),
+        ("h264", ["-c:v", "h264_videotoolbox", "-b:v", "6M"]),
+        ("h264", ["-c:v", "libx264", "-preset", "veryfast"]),
+        ("hevc", ["-c:v", "hevc_videotoolbox", "-b:v", "4M"])
+    ]
+
+    /// Predict the cost of running ffmpeg with `arguments`.
+    public func estimate(_ arguments: [String]) throws -> Estimate {
+        let job = FFmpegJobShape(arguments)
+        var inputs: [(info: FFmpegMediaInfo, seek: Double)] = []
+        for input in job.inputs {
+            inputs.append((try probeCached(input.path), input.seek))
+        }
+        guard !inputs.isEmpty else {
+            throw SwiftFFmpegError.invalidArgument("no probeable -i input in \(arguments)")
+        }
+
+        let available = inputs.compactMap { input in input.info.duration.map { max($0 - input.seek - job.outputSeek, 0) } }.max() ?? 0
+        let duration = job.outputDuration.map { min($0, available) } ?? available
+        var videoTime = 0.0
+        var audioTime = 0.0
+        var largestFrame = 0.0
+
+        if let source = inputs.first(where: { !$0.info.videoStreams.isEmpty }), let video = source.info.videoStreams.first, !job.dropsVideo {
+            let fps = job.outputFrameRate ?? video.framesPerSecond ?? 30
+            let inputPixels = Double((video.width ?? 1280) * (video.height ?? 720))
+            let outputPixels = job.outputSize.map { Double($0.width * $0.height) } ?? inputPixels
+            largestFrame = max(inputPixels, outputPixels) * 1.5
+
+            if job.videoCodec == "copy" {
+                let inputDuration = source.info.duration ?? duration
+                let bytes = Double(source.info.format.size ?? 0) * (inputDuration > 0 ? duration / inputDuration : 1)
+                videoTime = bytes / max(calibration.copyBytesPerSecond, 1)
+            } else {
+                let decodeRate = calibration.decodePixelsPerSecond[video.codecName ?? ""]
+                    ?? calibration.decodePixelsPerSecond.values.min() ?? 1
+                let encodeRate = calibration.encodePixelsPerSecond[job.videoCodec ?? "mpeg4"]
+                    ?? calibration.encodePixelsPerSecond.values.min() ?? 1
+                videoTime = duration * fps * (inputPixels / decodeRate + outputPixels / encodeRate)
+            }
+        }
+
+        if inputs.contains(where: { !$0.info.audioStreams.isEmpty }), !job.dropsAudio, job.audioCodec != "copy" {
+            let rate = calibration.audioSecondsPerSecond[job.audioCodec ?? "aac"]
+                ?? calibration.audioSecondsPerSecond.values.min() ?? 50
+            audioTime = duration / rate
+        }
+
+        // Audio is encoded on its own thread alongside video.
+        let wallTime = calibration.runOverhead + max(videoTime, audioTime)
+        let memory = Double(calibration.baseMemoryBytes) + calibration.framesInFlight * largestFrame
+        return Estimate(wallTime: wallTime, peakMemoryBytes: Int64(memory), mediaDuration: duration)
+    }
+
+    /// Estimate, run and record the job so `accuracy` reflects it.
+    public func execute(_ arguments: [String]) throws -> Execution {
+        let predicted = try estimate(arguments)
+        let run = try Self.measuring { try SwiftFFmpeg.executeDetailed(arguments) }
+
+        lock.lock()
+        records.append((predicted, run.time, run.peakMemory))
+        lock.unlock()
+        return Execution(execution: run.result, estimate: predicted, wallTime: run.time, peakMemoryBytes: run.peakMemory)
+    }
+
+    /// Error of the estimates of every job run through `execute(_:)`.
+    public var accuracy: Accuracy {
+        lock.lock()
+        let records = self.records
+        lock.unlock()
+        guard !records.isEmpty else {
+            return Accuracy(samples: 0, wallTimeError: 0, memoryError: 0, wallTimeBias: 1)
+        }
+        let count = Double(records.count)
+        let timeError = records.map { abs($0.wallTime - $0.predicted.wallTime) / max($0.wallTime, 0.001) }.reduce(0, +)
+        let memoryError = records.map {
+            abs(Double($0.peakMemory - $0.predicted.peakMemoryBytes)) / max(Double($0.peakMemory), 1)
+        }.reduce(0, +)
+        let bias = records.map { $0.wallTime / max($0.predicted.wallTime, 0.001) }.reduce(0, +)
+        return Accuracy(samples: records.count, wallTimeError: timeError / count, memoryError: memoryError / count, wallTimeBias: bias / count)
+    }
+
+    private func probeCached(_ path: String) throws -> FFmpegMediaInfo {
+        let attributes = try? FileManager.default.attributesOfItem(atPath: path)
+        let size = (attributes?[.size] as? Int64).map(String.init) ?? "-"
+        let modified = (attributes?[.modificationDate] as? Date).map { String($0.timeIntervalSince1970) } ?? "-"
+        let key = "\(path)\n\(size)\n\(modified)"
+
+        lock.lock()
+        let cached = probes[key]
+        lock.unlock()
+        if let cached {
+            return cached
+        }
+        let info = try SwiftFFmpeg.probe(path)
+        lock.lock()
+        probes[key] = info
+        lock.unlock()
+        return info
+    }
+
+    private static func measure(_ arguments: [String]) throws -> (time: TimeInterval, peakMemory: Int64) {
+        let run = try measuring { try SwiftFFmpeg.executeDetailed(arguments) }
+        return (run.time, run.peakMemory)
+    }
+
+    /// Wall time of `body` and the peak memory it added, sampled every 10 ms.
+    private static func measuring<Result>(
+        _ body: () throws -> Result
+    ) throws -> (result: Result, time: TimeInterval, peakMemory: Int64) {
+        let baseline = residentMemory()
+        let peakLock = NSLock()
+        var peak = baseline
+        let timer = DispatchSource.makeTimerSource(queue: DispatchQueue.global(qos: .utility))
+        timer.schedule(deadline: .now(), repeating: .milliseconds(10))
+        timer.setEventHandler {
+            let current = residentMemory()
+            peakLock.lock()
+            peak = max(peak, current)
+            peakLock.unlock()
+        }
+        timer.resume()
+
+        let started = Date()
+        defer { timer.cancel() }
+        let result = try body()
+        let time = Date().timeIntervalSince(started)
+
+        peakLock.lock()
+        let added = max(peak, residentMemory()) - baseline
+        peakLock.unlock()
+        return (result, time, added)
+    }
+
+    /// Current memory footprint of the process.
+    static func residentMemory() -> Int64 {
+        #if canImport(Darwin)
+        var info = task_vm_info_data_t()
+        var count = mach_msg_type_number_t(MemoryLayout<task_vm_info_data_t>.size / MemoryLayout<natural_t>.size)
+        let result = withUnsafeMutablePointer(to: &info) {
+            $0.withMemoryRebound(to: integer_t.self, capacity: Int(count)) {
+                task_info(mach_task_self_, task_flavor_t(TASK_VM_INFO), $0, &count)
+            }
+        }
+        return result == KERN_SUCCESS ? Int64(info.phys_footprint) : 0
+        #else
+        guard let statm = try? String(contentsOfFile: "/proc/self/statm", encoding: .utf8) else { return 0 }
+        let fields = statm.split(separator: " ")
+        guard fields.count > 1, let pages = Int64(fields[1]) else { return 0 }
+        return pages * Int64(sysconf(Int32(_SC_PAGESIZE)))
+        #endif
+    }
+}
+
+/// What an ffmpeg argument list asks for, as far as cost is concerned.
+struct FFmpegJobShape {
+    struct Input {
+        let path: String
+        let seek: Double
+    }
+
+    var inputs: [Input] = []
+    var videoCodec: String?
+    var audioCodec: String?
+    var dropsVideo = false
+    var dropsAudio = false
+    var outputSeek = 0.0
+    var outputDuration: Double?
+    var outputFrameRate: Double?
+    var outputSize: (width: Int, height: Int)?
+
+    init(_ arguments: [String]) {
+        var pendingSeek = 0.0
+        var pendingFormat: String?
+        var index = 0
+        while index < arguments.count {
+            let option = arguments[index]
+            let value = index + 1 < arguments.count ? arguments[index + 1] : nil
+            switch option {
+            case "-i":
+                // Synthetic (lavfi) and device inputs cannot be probed and are left out.
+                if let value, pendingFormat != "lavfi" {
+                    inputs.append(Input(path: value, seek: pendingSeek))
+                }
+                pendingSeek = 0
+                pendingFormat = nil
+            case "-ss":
+                pendingSeek = value.flatMap(Self.seconds) ?? 0
+            case "-f":
+                pendingFormat = value
+            case "-c:v", "-codec:v", "-vcodec":
+                videoCodec = value
+            case "-c:a", "-codec:a", "-acodec":
+                audioCodec = value
+            case "-c", "-codec":
+                videoCodec = videoCodec ?? value
+                audioCodec = audioCodec ?? value
+            case "-vn":
+                dropsVideo = true
+            case "-an":
+                dropsAudio = true
+            case "-t":
+                outputDuration = value.flatMap(Self.seconds)
+            case "-r":
+                outputFrameRate = value.flatMap(FFmpegMediaInfo.parseRational)
+            case "-s":
+                outputSize = value.flatMap(Self.size)
+            case "-vf", "-filter:v":
+                outputSize = value.flatMap(Self.scaledSize) ?? outputSize
+            default:
+                break
+            }
+            index += Self.takesValue(option) ? 2 : 1
+        }
+        // A seek after the last input is an output option and skips that much of every input.
+        outputSeek = pendingSeek
+    }
+
+    /// Options known to take a value, without stream specifiers. Any other argument is read on its
+    /// own: a flag such as `-nostats` must not swallow the option after it, and a value of an
+    /// unlisted option is skipped harmlessly as a word that is not an option read here.
+    private static let valuedOptions: Set<String> = [
+        "-i", "-f", "-ss", "-sseof", "-t", "-to", "-itsoffset", "-stream_loop", "-r", "-s", "-aspect",
+        "-c", "-codec", "-vcodec", "-acodec", "-scodec", "-b", "-q", "-qscale", "-crf", "-preset",
+        "-tune", "-profile", "-level", "-g", "-bf", "-pix_fmt", "-maxrate", "-minrate", "-bufsize",
+        "-vf", "-af", "-filter", "-filter_complex", "-lavfi", "-map", "-map_metadata", "-map_chapters",
+        "-metadata", "-disposition", "-frames", "-vframes", "-aframes", "-ar", "-ac", "-channel_layout",
+        "-sample_fmt", "-fps_mode", "-vsync", "-threads", "-filter_threads", "-v", "-loglevel",
+        "-progress", "-stats_period", "-movflags", "-fflags", "-flags", "-probesize",
+        "-analyzeduration", "-skip_frame", "-lowres", "-hwaccel", "-hwaccel_output_format", "-tag",
+        "-max_muxing_queue_size", "-safe", "-protocol_whitelist", "-x264-params", "-x265-params",
+        "-timelimit", "-fs", "-max_interleave_delta", "-muxdelay", "-muxpreload", "-flush_packets"
+    ]
+
+    /// Whether `option` is known to take a value; `-c:v:0` is looked up as `-c`.
+    static func takesValue(_ option: String) -> Bool {
+        valuedOptions.contains(option) ||
+            option.split(separator: ":", maxSplits: 1).first.map { valuedOptions.contains(String($0)) } == true
+    }
+
+    /// Seconds from `SS(.fff)` or `HH:MM:SS(.fff)`.
+    static func seconds(_ value: String) -> Double? {
+        value.split(separator: ":").reduce(Double?(0)) { total, part in
+            guard let total, let component = Double(part) else { return nil }
+            return total * 60 + component
+        }
+    }
+
+    static func size(_ value: String) -> (width: Int, height: Int)? {
+        let parts = value.split(separator: "x")
+        guard parts.count == 2, let width = Int(parts[0]), let height = Int(parts[1]) else { return nil }
+        return (width, height)
+    }
+
+    /// Output size of an explicit `scale=W:H` in a filter chain.
+    static func scaledSize(_ filters: String) -> (width: Int, height: Int)? {
+        guard let range = filters.range(of: "scale=") else { return nil }
+        let parts = filters[range.upperBound...].prefix { $0 != "," && $0 != "[" }.split(separator: ":")
+        guard parts.count >= 2,
+              let width = Int(parts[0].replacingOccurrences(of: "w=", with: "")),
+              let height = Int(parts[1].replacingOccurrences(of: "h=", with: "")),
+              width > 0, height > 0 else {
+            return nil
+        }
+        return (width, height)
+    }
+}
@@ -0,0 +1,126 @@
+import Foundation
+internal import CFFmpegCLI
+
+/// A non-seekable input that the caller writes into while a job reads it.
+///
+/// Pass `url` to `-i` (with `-f` when the format cannot be probed from the first bytes) and write
+/// chunks as they arrive, e.g. from a download, on a thread other than the one running the job. At
+/// most `capacity` bytes are buffered: `write(_:)` blocks and the async `write(_:)` suspends until the
+/// demuxer has caught up, while `tryWrite(_:)` takes only what fits. `finish()` ends the stream
+/// normally and `abort()` makes the job fail; cancelling the job also interrupts a demuxer waiting
+/// for data. Writing after the job stopped reading throws `EPIPE`.
+public final class FFmpegFeed {
+    private let id: Int32
+    private let lock = NSLock()
+    private var released = false
+    private static let writeQueue = DispatchQueue(label: "SwiftFFmpeg.FFmpegFeed.write", attributes: .concurrent)
+
+    public init(capacity: Int = 4 << 20) throws {
+        let id = ffmpeg_feed_create(Int64(capacity))
+        if id < 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: "shim:feed", errno: ENOMEM)
+        }
+        self.id = id
+    }
+
+    deinit {
+        release()
+    }
+
+    /// Input URL of this feed. A feed can be read by one job.
+    public var url: String {
+        "shim:feed/\(id)"
+    }
+
+    /// Bytes written but not yet read by the job.
+    public var bufferedBytes: Int {
+        max(0, Int(ffmpeg_feed_buffered(id)))
+    }
+
+    /// Write all of `data`, blocking while the buffer is full.
+    public func write(_ data: Data) throws {
+        _ = try write(data, blocking: true)
+    }
+
+    /// Write all of `data`, suspending while the buffer is full.
+    public func write(_ data: Data) async throws {
+        try await withCheckedThrowingContinuation { (continuation: CheckedContinuation<Void, Error>) in
+            FFmpegFeed.writeQueue.async {
+                continuation.resume(with: Result { _ = try self.write(data, blocking: true) })
+            }
+        }
+    }
+
+    /// Write as much of `data` as fits without waiting and return how many bytes were taken.
+    @discardableResult
+    public func tryWrite(_ data: Data) throws -> Int {
+        try write(data, blocking: false)
+    }
+
+    /// End the stream; the job reads what is buffered and then sees end of file.
+    public func finish() {
+        ffmpeg_feed_finish(id)
+    }
+
+    /// End the stream with an error; the job's next read fails.
+    public func abort() {
+        ffmpeg_feed_abort(id)
+    }
+
+    /// Free the feed. Safe to call more than once.
+    public func release() {
+        lock.lock()
+        defer { lock.unlock() }
+        guard !released else { return }
+        released = true
+        ffmpeg_feed_release(id)
+    }
+
+    private func write(_ data: Data, blocking: Bool) throws -> Int {
+        lock.lock()
+        let isReleased = released
+        lock.unlock()
+        if isReleased {
+            throw SwiftFFmpegError.fileOperationFailed(path: url, errno: EBADF)
+        }
+
+        let written = data.withUnsafeBytes { buffer in
+            ffmpeg_feed_write(id, buffer.baseAddress, Int64(buffer.count), blocking ? 1 : 0)
+        }
+        if written < 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: url, errno: Int32(-written))
+        }
+        return Int(written)
+    }
+}
+
+extension SwiftFFmpeg {
+    /// Run a job whose input is fed by `produce` while it runs.
+    ///
+    /// `arguments` receives the feed's URL to use as an input. `produce` runs on a background queue
+    /// and writes chunks as they become available; the feed is finished when it returns and aborted
+    /// if it throws. If the job ends first, the producer's next write throws.
+    public static func executeFeeding(
+        capacity: Int = 4 << 20,
+        _ arguments: (String) -> [String],
+        produce: @escaping (FFmpegFeed) throws -> Void
+    ) throws -> FFmpegExecutionResult {
+        let feed = try FFmpegFeed(capacity: capacity)
+        let producerDone = DispatchGroup()
+        producerDone.enter()
+        DispatchQueue.global(qos: .userInitiated).async {
+            defer { producerDone.leave() }
+            do {
+                try produce(feed)
+                feed.finish()
+            } catch {
+                feed.abort()
+            }
+        }
+        defer {
+            feed.release()
+            producerDone.wait()
+        }
+        return try executeDetailed(arguments(feed.url))
+    }
+}
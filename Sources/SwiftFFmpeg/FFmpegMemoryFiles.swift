@@ -0,0 +1,122 @@
+import Foundation
+internal import CFFmpegCLI
+
+/// Memory-backed intermediate files for multi-step jobs.
+///
+/// `url(_:)` names a file that ffmpeg and ffprobe can write and read like any output or input, e.g. a
+/// temporary remux between two runs. The bytes live in a memfd on Linux and in process memory
+/// elsewhere, and are freed by `release()` or when the object is deallocated.
+///
+/// FFmpeg writes two-pass statistics with plain stdio rather than through a protocol, so
+/// `passLogPrefix` points into `/dev/shm` (tmpfs) on Linux and into a private temporary directory
+/// elsewhere; that directory is removed on release as well.
+public final class FFmpegMemoryFiles {
+    private let scope: Int32
+    private let lock = NSLock()
+    private var released = false
+    private var passLogDirectory: URL?
+
+    public init() throws {
+        let scope = ffmpeg_memfile_scope_create()
+        if scope < 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: "shim:mem", errno: -scope)
+        }
+        self.scope = scope
+    }
+
+    deinit {
+        release()
+    }
+
+    /// URL of the memory file `name`. The extension is used for format guessing, as with paths.
+    public func url(_ name: String) -> String {
+        "shim:mem/\(scope)/\(name)"
+    }
+
+    /// Prefix for `-passlogfile`, removed with the other intermediates.
+    public var passLogPrefix: String {
+        lock.lock()
+        defer { lock.unlock() }
+        if let passLogDirectory {
+            return passLogDirectory.appendingPathComponent("pass").path
+        }
+        let shm = URL(fileURLWithPath: "/dev/shm", isDirectory: true)
+        let base = FileManager.default.fileExists(atPath: shm.path)
+            ? shm
+            : FileManager.default.temporaryDirectory
+        let directory = base.appendingPathComponent("ffmpeg-\(UUID().uuidString)", isDirectory: true)
+        try? FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        passLogDirectory = directory
+        return directory.appendingPathComponent("pass").path
+    }
+
+    /// Size of the memory file `name`, or `nil` if nothing has written it.
+    public func size(of name: String) -> Int64? {
+        let size = ffmpeg_memfile_size(scope, name)
+        return size < 0 ? nil : size
+    }
+
+    /// Total bytes currently held in memory by this object's files; spilled files are not counted.
+    public var bytesInUse: Int64 {
+        ffmpeg_memfile_scope_bytes(scope)
+    }
+
+    /// Total bytes of this object's files that were spilled to disk.
+    public var spilledBytes: Int64 {
+        ffmpeg_memfile_spilled_bytes(scope)
+    }
+
+    /// Keep at most `bytes` in memory (`nil` for no limit). A file whose next write would go past the
+    /// limit is moved to an unlinked temporary file in `spillDirectory` and keeps growing there; its
+    /// URL stays the same.
+    public func limitMemory(to bytes: Int64?, spillDirectory: URL = FileManager.default.temporaryDirectory) throws {
+        let limit = bytes.map { max($0, 1) } ?? 0
+        let result = ffmpeg_memfile_scope_set_limit(scope, limit, spillDirectory.path)
+        if result < 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: spillDirectory.path, errno: -result)
+        }
+    }
+
+    /// Move every file still held in memory to disk now, into the `limitMemory` spill directory or
+    /// the temporary directory. Later writes to those files go to disk as well. Returns the bytes moved.
+    @discardableResult
+    public func spillToDisk() -> Int64 {
+        ffmpeg_memfile_scope_spill(scope)
+    }
+
+    /// Copy the contents of the memory file `name`.
+    public func data(of name: String) throws -> Data {
+        guard let size = size(of: name) else {
+            throw SwiftFFmpegError.fileOperationFailed(path: url(name), errno: ENOENT)
+        }
+        var data = Data(count: Int(size))
+        let copied = data.withUnsafeMutableBytes { buffer in
+            ffmpeg_memfile_read(scope, name, 0, buffer.baseAddress, size)
+        }
+        if copied < 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: url(name), errno: Int32(-copied))
+        }
+        return data.prefix(Int(copied))
+    }
+
+    /// Free every memory file and the pass log directory. Safe to call more than once.
+    public func release() {
+        lock.lock()
+        defer { lock.unlock() }
+        guard !released else { return }
+        released = true
+        ffmpeg_memfile_scope_release(scope)
+        if let passLogDirectory {
+            try? FileManager.default.removeItem(at: passLogDirectory)
+        }
+    }
+}
+
+extension SwiftFFmpeg {
+    /// Run `body` with a set of memory-backed intermediate files that are freed when it returns.
+    public static func withMemoryFiles<T>(_ body: (FFmpegMemoryFiles) throws -> T) throws -> T {
+        let files = try FFmpegMemoryFiles()
+        defer { files.release() }
+        return try body(files)
+    }
+}
@@ -0,0 +1,391 @@
+import CryptoKit
+import Foundation
+
+/// Content-addressed cache of ffmpeg outputs.
+///
+/// Results are keyed by the identity of every input file, the argument list with input/output paths
+/// replaced by placeholders, and the FFmpeg build version. A hit materializes the stored output at the
+/// requested path instead of running ffmpeg again. Stored outputs are evicted least-recently-used
+/// first once the cache grows beyond `maxBytes`.
+public final class FFmpegResultCache {
+    /// How an input file is identified in the cache key.
+    public enum InputIdentity {
+        /// Device, inode, size and modification time. Cheap, but a copied file is a different input.
+        case fileAttributes
+        /// Size plus SHA-256 of the whole file, so identical content hits under any path. Reads every
+        /// input in full on every lookup.
+        case content
+        /// Size plus SHA-256 of the first, middle and last MiB only. Much cheaper than `content` for
+        /// large inputs, but a same-size change outside those windows (an in-place metadata or tag
+        /// edit, a patched packet) is not seen, and the stale output is served. Opt in only for inputs
+        /// that are never modified in place.
+        case contentSample
+    }
+
+    /// How a cached output is placed at the requested output path.
+    public enum Materialization {
+        /// Copy-on-write clone where the file system supports it, otherwise a copy.
+        case clone
+        /// Hard link to the cached file. Fastest, but later edits to the output also change the cache entry.
+        case hardLink
+        case copy
+    }
+
+    public struct Metrics {
+        public let hits: Int
+        public let misses: Int
+        public let evictions: Int
+        public let storedBytes: Int64
+
+        public var hitRate: Double {
+            hits + misses == 0 ? 0 : Double(hits) / Double(hits + misses)
+        }
+    }
+
+    public struct Execution {
+        public let outputPath: String
+        public let cacheHit: Bool
+        /// The ffmpeg result for a miss; `nil` when the output came from the cache.
+        public let execution: FFmpegExecutionResult?
+    }
+
+    private struct Entry: Codable {
+        let key: String
+        let fileName: String
+        let size: Int64
+        var lastAccess: Date
+    }
+
+    public let directory: URL
+    public let maxBytes: Int64
+    public let inputIdentity: InputIdentity
+    public let materialization: Materialization
+
+    private let lock = NSLock()
+    private var entries: [String: Entry] = [:]
+    private var hits = 0
+    private var misses = 0
+    private var evictions = 0
+
+    private var indexURL: URL { directory.appendingPathComponent("index.json") }
+
+    public init(
+        directory: URL,
+        maxBytes: Int64,
+        inputIdentity: InputIdentity = .fileAttributes,
+        materialization: Materialization = .clone
+    ) throws {
+        self.directory = directory
+        self.maxBytes = maxBytes
+        self.inputIdentity = inputIdentity
+        self.materialization = materialization
+
+        try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        if let data = try? Data(contentsOf: indexURL),
+           let stored = try? JSONDecoder().decode([Entry].self, from: data) {
+            for entry in stored where FileManager.default.fileExists(atPath: objectURL(entry.fileName).path) {
+                entries[entry.key] = entry
+            }
+        }
+    }
+
+    public var metrics: Metrics {
+        lock.lock()
+        defer { lock.unlock() }
+        return Metrics(
+            hits: hits,
+            misses: misses,
+            evictions: evictions,
+            storedBytes: entries.values.reduce(0) { $0 + $1.size }
+        )
+    }
+
+    /// Run ffmpeg with `arguments`, or reuse a cached output of an identical earlier run.
+    ///
+    /// Inputs are the values of every `-i` option, plus files named by filters such as `subtitles=`
+    /// or `movie=` and by options such as `-filter_complex_script`. Only regular files can be
+    /// identified: a run reading a URL, pipe, `shim:` input, lavfi graph or image sequence pattern
+    /// always misses and is not stored. The output is the last argument, and must be the only one.
+    public func execute(_ arguments: [String]) throws -> Execution {
+        let outputs = SwiftFFmpeg.outputPaths(in: arguments)
+        guard let outputPath = arguments.last, !outputPath.hasPrefix("-"), outputs == [outputPath] else {
+            throw SwiftFFmpegError.invalidArgument("the last argument must be the only output path")
+        }
+
+        guard let key = try cacheKey(for: arguments, outputPath: outputPath) else {
+            lock.lock()
+            misses += 1
+            lock.unlock()
+            let execution = try SwiftFFmpeg.executeDetailed(arguments)
+            return Execution(outputPath: outputPath, cacheHit: false, execution: execution)
+        }
+
+        if let cached = lookup(key) {
+            try materialize(cached, at: outputPath)
+            return Execution(outputPath: outputPath, cacheHit: true, execution: nil)
+        }
+
+        let execution = try SwiftFFmpeg.executeDetailed(arguments)
+        try store(outputPath, forKey: key)
+        return Execution(outputPath: outputPath, cacheHit: false, execution: execution)
+    }
+
+    /// Remove every cached output.
+    public func removeAll() {
+        lock.lock()
+        for entry in entries.values {
+            try? FileManager.default.removeItem(at: objectURL(entry.fileName))
+        }
+        entries.removeAll()
+        saveIndexLocked()
+        lock.unlock()
+    }
+
+    // MARK: - Keys
+
+    /// Nil when an input or referenced file is not a regular file, so the run cannot be cached.
+    private func cacheKey(for arguments: [String], outputPath: String) throws -> String? {
+        var normalized: [String] = []
+        var inputIdentities: [String] = []
+        var index = 0
+
+        while index < arguments.count {
+            let argument = arguments[index]
+            if argument == "-i", index + 1 < arguments.count {
+                let input = arguments[index + 1]
+                guard let inputIdentity = try identity(ofInput: input) else { return nil }
+                normalized += ["-i", "$IN\(inputIdentities.count)"]
+                inputIdentities.append(inputIdentity)
+                index += 2
+                continue
+            }
+            if index == arguments.count - 1 {
+                normalized.append("$OUT." + (outputPath as NSString).pathExtension)
+                break
+            }
+            // Options that only affect logging or overwrite prompts do not change the output.
+            if ["-y", "-n", "-hide_banner", "-nostats", "-stats"].contains(argument) {
+                index += 1
+                continue
+            }
+            if ["-v", "-loglevel"].contains(argument) {
+                index += 2
+                continue
+            }
+            // Files read through an option value are inputs too. Their spelling stays in the
+            // normalized arguments, and their identity joins the inputs'.
+            let referenced = Self.fileOptions.contains(argument) || argument.hasPrefix("-/")
+                ? (index + 1 < arguments.count ? [arguments[index + 1]] : [])
+                : Self.filterFileReferences(in: argument)
+            for reference in referenced {
+                guard let referenceIdentity = try identity(ofInput: reference) else { return nil }
+                inputIdentities.append("ref:" + referenceIdentity)
+            }
+            normalized.append(argument)
+            index += 1
+        }
+
+        var hasher = SHA256()
+        hasher.update(data: Data(SwiftFFmpeg.buildVersion.utf8))
+        for part in [normalized.joined(separator: "\u{0}")] + inputIdentities {
+            hasher.update(data: Data([0xff]))
+            hasher.update(data: Data(part.utf8))
+        }
+        return hasher.finalize().map { String(format: "%02x", $0) }.joined()
+    }
+
+    /// Options whose value names a file that ffmpeg reads.
+    private static let fileOptions: Set<String> = ["-filter_script", "-filter_complex_script", "-attach"]
+
+    /// Filter options and positional filter arguments that name a file the filter reads.
+    private static let filterFileKeys: Set<String> = [
+        "movie", "amovie", "subtitles", "ass", "filename", "f", "file", "fontfile", "textfile", "lut1d", "lut3d", "sofa", "model"
+    ]
+
+    private static let filterFilePattern = try! NSRegularExpression(
+        pattern: "(?<![\\w./-])(\\w+)=(?:'([^']*)'|([^=:,;\\[\\]'\\s]++)(?!=))"
+    )
+
+    /// Values of `key=value` pairs in a filter graph whose key names a file, such as
+    /// `subtitles=subs.srt` or `drawtext=fontfile=font.ttf`.
+    static func filterFileReferences(in argument: String) -> [String] {
+        guard argument.contains("=") else { return [] }
+        let range = NSRange(argument.startIndex..., in: argument)
+        return filterFilePattern.matches(in: argument, range: range).compactMap { match in
+            guard let key = Range(match.range(at: 1), in: argument),
+                  filterFileKeys.contains(String(argument[key])),
+                  let value = Range(match.range(at: 2), in: argument) ?? Range(match.range(at: 3), in: argument) else {
+                return nil
+            }
+            return String(argument[value])
+        }
+    }
+
+    /// Nil for anything but a regular file: URLs, pipes, devices, `shim:` inputs, lavfi graphs and
+    /// image sequence patterns would be identified by their spelling alone, and their content can
+    /// change under the same spelling.
+    private func identity(ofInput input: String) throws -> String? {
+        let path = input.hasPrefix("file:") ? String(input.dropFirst(5)) : input
+        guard !path.contains("%"),
+              let attributes = try? FileManager.default.attributesOfItem(atPath: path),
+              attributes[.type] as? FileAttributeType == .typeRegular else {
+            return nil
+        }
+
+        let size = (attributes[.size] as? NSNumber)?.int64Value ?? 0
+
+        switch inputIdentity {
+        case .fileAttributes:
+            let device = (attributes[.systemNumber] as? NSNumber)?.int64Value ?? 0
+            let inode = (attributes[.systemFileNumber] as? NSNumber)?.int64Value ?? 0
+            let modified = (attributes[.modificationDate] as? Date)?.timeIntervalSince1970 ?? 0
+            return "file:\(device):\(inode):\(size):\(modified)"
+        case .content, .contentSample:
+            guard let handle = FileHandle(forReadingAtPath: path) else {
+                throw SwiftFFmpegError.fileOperationFailed(path: path, errno: EACCES)
+            }
+            defer { handle.closeFile() }
+
+            let window: Int64 = 1 << 20
+            var hasher = SHA256()
+            if inputIdentity == .content {
+                var chunk = handle.readData(ofLength: Int(window))
+                while !chunk.isEmpty {
+                    hasher.update(data: chunk)
+                    chunk = handle.readData(ofLength: Int(window))
+                }
+            } else {
+                for offset in [0, max(size / 2 - window / 2, 0), max(size - window, 0)] {
+                    handle.seek(toFileOffset: UInt64(offset))
+                    hasher.update(data: handle.readData(ofLength: Int(window)))
+                }
+            }
+            let digest = hasher.finalize().map { String(format: "%02x", $0) }.joined()
+            // Sampled and full digests of the same file differ, so the prefixes keep them apart.
+            return "\(inputIdentity == .content ? "content" : "sample"):\(size):\(digest)"
+        }
+    }
+
+    // MARK: - Storage
+
+    private func objectURL(_ fileName: String) -> URL {
+        directory.appendingPathComponent(fileName)
+    }
+
+    private func lookup(_ key: String) -> Entry? {
+        lock.lock()
+        defer { lock.unlock() }
+        guard var entry = entries[key],
+              FileManager.default.fileExists(atPath: objectURL(entry.fileName).path) else {
+            entries[key] = nil
+            misses += 1
+            return nil
+        }
+        entry.lastAccess = Date()
+        entries[key] = entry
+        hits += 1
+        saveIndexLocked()
+        return entry
+    }
+
+    private func store(_ outputPath: String, forKey key: String) throws {
+        let pathExtension = (outputPath as NSString).pathExtension
+        let fileName = pathExtension.isEmpty ? key : "\(key).\(pathExtension)"
+        let destination = objectURL(fileName)
+
+        try? FileManager.default.removeItem(at: destination)
+        try Self.place(URL(fileURLWithPath: outputPath), at: destination, using: .clone)
+
+        let size = ((try? FileManager.default.attributesOfItem(atPath: destination.path))?[.size] as? NSNumber)?
+            .int64Value ?? 0
+
+        lock.lock()
+        entries[key] = Entry(key: key, fileName: fileName, size: size, lastAccess: Date())
+        evictLocked()
+        saveIndexLocked()
+        lock.unlock()
+    }
+
+    private func materialize(_ entry: Entry, at outputPath: String) throws {
+        let destination = URL(fileURLWithPath: outputPath)
+        try? FileManager.default.removeItem(at: destination)
+        try Self.place(objectURL(entry.fileName), at: destination, using: materialization)
+    }
+
+    private func evictLocked() {
+        var total = entries.values.reduce(0) { $0 + $1.size }
+        for entry in entries.values.sorted(by: { $0.lastAccess < $1.lastAccess }) where total > maxBytes {
+            try? FileManager.default.removeItem(at: objectURL(entry.fileName))
+            entries[entry.key] = nil
+            total -= entry.size
+            evictions += 1
+        }
+    }
+
+    private func saveIndexLocked() {
+        if let data = try? JSONEncoder().encode(Array(entries.values)) {
+            try? data.write(to: indexURL, options: .atomic)
+        }
+    }
+
+    private static func place(_ source: URL, at destination: URL, using materialization: Materialization) throws {
+        switch materialization {
+        case .hardLink:
+            if (try? FileManager.default.linkItem(at: source, to: destination)) != nil {
+                return
+            }
+        case .clone:
+            #if canImport(Darwin)
+            if clonefile(source.path, destination.path, 0) == 0 {
+                return
+            }
+            #endif
+        case .copy:
+            break
+        }
+        // On APFS copyItem clones as well; elsewhere it is a plain copy.
+        try FileManager.default.copyItem(at: source, to: destination)
+    }
+}
+
+extension SwiftFFmpeg {
+    /// ffmpeg options that take no value. Each also has a `-no` form, such as `-nostats`.
+    static let valuelessOptions: Set<String> = [
+        "-y", "-n", "-stats", "-stdin", "-hide_banner", "-benchmark", "-benchmark_all", "-dump", "-hex",
+        "-copy_unknown", "-ignore_unknown", "-debug_ts", "-xerror", "-psnr", "-qphist", "-vstats",
+        "-copyts", "-start_at_zero", "-shortest", "-bitexact", "-accurate_seek", "-seek_timestamp",
+        "-re", "-autorotate", "-autoscale", "-fix_sub_duration", "-copyinkf", "-find_stream_info",
+        "-vn", "-an", "-sn", "-dn", "-print_graphs"
+    ]
+
+    /// Whether `option` is an ffmpeg option that takes no value. Unknown options are assumed to
+    /// take one, as every codec, format and filter AVOption does.
+    static func isValueless(_ option: String) -> Bool {
+        let name = option.split(separator: ":", maxSplits: 1).first.map(String.init) ?? option
+        return valuelessOptions.contains(name) || (name.hasPrefix("-no") && valuelessOptions.contains("-" + name.dropFirst(3)))
+    }
+
+    /// Output URLs of an ffmpeg argument list: the arguments that are neither options, option
+    /// values nor `-i` inputs.
+    static func outputPaths(in arguments: [String]) -> [String] {
+        var outputs: [String] = []
+        var index = 0
+        while index < arguments.count {
+            let argument = arguments[index]
+            if argument.hasPrefix("-") && argument != "-" {
+                index += isValueless(argument) ? 1 : 2
+            } else {
+                outputs.append(argument)
+                index += 1
+            }
+        }
+        return outputs
+    }
+
+    /// First line of `ffmpeg -version`, identifying the linked FFmpeg build.
+    static let buildVersion: String = {
+        guard let result = try? executeDetailed(["-version"]) else { return "unknown" }
+        let output = result.stdout.isEmpty ? result.stderr : result.stdout
+        return output.split(whereSeparator: \.isNewline).first.map(String.init) ?? "unknown"
+    }()
+}
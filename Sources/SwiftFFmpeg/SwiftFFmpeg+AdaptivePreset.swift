@@ -0,0 +1,162 @@
+import Foundation
+
+/// One rung of an adaptive encode's preset ladder: encoder arguments and their name in reports.
+public struct FFmpegEncoderPreset: Equatable {
+    public let name: String
+    public let arguments: [String]
+
+    public init(name: String, arguments: [String]) {
+        self.name = name
+        self.arguments = arguments
+    }
+
+    /// `mpeg4` settings from best quality (slowest) to fastest, at a constant quantizer.
+    public static func mpeg4Ladder(quality: Int = 3) -> [FFmpegEncoderPreset] {
+        let base = ["-c:v", "mpeg4", "-q:v", String(quality)]
+        return [
+            FFmpegEncoderPreset(name: "rd-trellis", arguments: base + ["-mbd", "rd", "-trellis", "1", "-flags", "+mv4+aic", "-cmp", "2", "-subcmp", "2"]),
+            FFmpegEncoderPreset(name: "rd", arguments: base + ["-mbd", "rd", "-flags", "+mv4"]),
+            FFmpegEncoderPreset(name: "bits", arguments: base + ["-mbd", "bits"]),
+            FFmpegEncoderPreset(name: "fast", arguments: base)
+        ]
+    }
+}
+
+public struct FFmpegAdaptiveSegmentReport {
+    public let start: Double
+    public let duration: Double
+    public let preset: FFmpegEncoderPreset
+    public let encodeTime: TimeInterval
+
+    /// Media seconds encoded per wall-clock second.
+    public var speed: Double {
+        encodeTime > 0 ? duration / encodeTime : 0
+    }
+}
+
+public struct FFmpegAdaptiveEncodeResult {
+    public let outputPath: String
+    /// The preset chosen for each segment, in media order.
+    public let segments: [FFmpegAdaptiveSegmentReport]
+    public let elapsed: TimeInterval
+    public let metDeadline: Bool
+}
+
+extension SwiftFFmpeg {
+    /// Encode `input` to finish within `deadline` at the best quality the device manages.
+    ///
+    /// The input is encoded in segments of `segmentDuration` seconds. The first, shorter segment runs
+    /// with the best preset of `ladder` to measure this device's speed on this input; before each later
+    /// segment the remaining media and remaining time give the speed needed, and the best preset whose
+    /// measured (or extrapolated) speed meets it with `safetyMargin` to spare is used. Speeds are
+    /// updated from every segment, so a device that slows down (thermal throttling, background work)
+    /// moves to faster presets and one that has time left moves back up. Segments are joined by stream
+    /// copy, like `exportResumable`; the report lists the preset and speed of each segment.
+    ///
+    /// - Parameters:
+    ///   - ladder: Presets ordered from best quality to fastest; all must use the same encoder.
+    ///   - audioArguments: Audio encoding applied to every segment, or `["-an"]`.
+    public static func encodeAdaptive(
+        input: String,
+        to outputPath: String,
+        deadline: TimeInterval,
+        ladder: [FFmpegEncoderPreset] = FFmpegEncoderPreset.mpeg4Ladder(),
+        audioArguments: [String] = ["-c:a", "aac", "-b:a", "128k"],
+        segmentDuration: Double = 10,
+        safetyMargin: Double = 0.15
+    ) throws -> FFmpegAdaptiveEncodeResult {
+        guard !ladder.isEmpty else {
+            throw SwiftFFmpegError.invalidArgument("preset ladder is empty")
+        }
+        guard let duration = try probe(input).duration, duration > 0 else {
+            throw SwiftFFmpegError.invalidArgument("\(input) has no known duration")
+        }
+
+        let outputExtension = (outputPath as NSString).pathExtension.isEmpty
+            ? "mp4"
+            : (outputPath as NSString).pathExtension
+        let workDirectory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("adaptive-\(UUID().uuidString)", isDirectory: true)
+        try FileManager.default.createDirectory(at: workDirectory, withIntermediateDirectories: true)
+        defer { try? FileManager.default.removeItem(at: workDirectory) }
+
+        let started = Date()
+        var speeds = FFmpegPresetSpeeds(count: ladder.count)
+        var reports: [FFmpegAdaptiveSegmentReport] = []
+        var paths: [String] = []
+        var position = 0.0
+
+        while position < duration - 0.05 {
+            // A short first segment measures speed early; later ones use the full length.
+            let length = min(reports.isEmpty ? min(segmentDuration, 3) : segmentDuration, duration - position)
+            let remainingTime = deadline - Date().timeIntervalSince(started)
+            let requiredSpeed = remainingTime > 0 ? (duration - position) / remainingTime : .infinity
+            let rung = reports.isEmpty ? 0 : speeds.bestRung(meeting: requiredSpeed * (1 + safetyMargin))
+            let preset = ladder[rung]
+
+            let path = workDirectory.appendingPathComponent("segment-\(paths.count).\(outputExtension)").path
+            let segmentStarted = Date()
+            _ = try executeDetailed(
+                ["-y", "-ss", String(position), "-i", input, "-t", String(length), "-map", "0:v:0", "-map", "0:a:0?"]
+                    + preset.arguments + audioArguments + [path]
+            )
+            let encodeTime = Date().timeIntervalSince(segmentStarted)
+
+            let report = FFmpegAdaptiveSegmentReport(start: position, duration: length, preset: preset, encodeTime: encodeTime)
+            speeds.record(report.speed, rung: rung)
+            reports.append(report)
+            paths.append(path)
+            position += length
+        }
+
+        _ = try executeDetailed([
+            "-y",
+            "-f", "concat", "-safe", "0",
+            "-i", FFmpegConcatList.dataURL(for: paths),
+            "-map", "0",
+            "-c", "copy",
+            outputPath
+        ])
+
+        let elapsed = Date().timeIntervalSince(started)
+        return FFmpegAdaptiveEncodeResult(
+            outputPath: outputPath,
+            segments: reports,
+            elapsed: elapsed,
+            metDeadline: elapsed <= deadline
+        )
+    }
+}
+
+/// Encode speed per ladder rung: measured rungs use a moving average, others are extrapolated from
+/// the nearest measured rung assuming each step down the ladder is `stepFactor` times faster.
+struct FFmpegPresetSpeeds {
+    static let stepFactor = 1.5
+
+    private var measured: [Double?]
+
+    init(count: Int) {
+        measured = Array(repeating: nil, count: count)
+    }
+
+    mutating func record(_ speed: Double, rung: Int) {
+        guard speed > 0 else { return }
+        measured[rung] = measured[rung].map { $0 * 0.5 + speed * 0.5 } ?? speed
+    }
+
+    func estimate(_ rung: Int) -> Double? {
+        if let speed = measured[rung] {
+            return speed
+        }
+        let nearest = measured.indices
+            .filter { measured[$0] != nil }
+            .min { abs($0 - rung) < abs($1 - rung) }
+        guard let nearest, let speed = measured[nearest] else { return nil }
+        return speed * pow(Self.stepFactor, Double(rung - nearest))
+    }
+
+    /// Best quality rung expected to reach `speed`, or the fastest rung when none is.
+    func bestRung(meeting speed: Double) -> Int {
+        measured.indices.first { (estimate($0) ?? 0) >= speed } ?? measured.count - 1
+    }
+}
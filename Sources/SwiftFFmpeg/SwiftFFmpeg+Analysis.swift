@@ -0,0 +1,201 @@
+import Foundation
+
+/// Which frames a fast analysis visits.
+public enum FFmpegAnalysisSampling: Equatable {
+    /// Every keyframe, in one sequential pass that decodes nothing else.
+    case keyframes
+    /// The first keyframe at or after each multiple of the interval. Keyframes are located by listing
+    /// the packets of a short window at each multiple, reached by seeking with the container index,
+    /// and then decoded by seeking again, so the media between samples is neither decoded nor read.
+    case every(TimeInterval)
+}
+
+/// Measurements of one analyzed frame.
+public struct FFmpegAnalysisSample: Equatable {
+    /// Presentation time in the source, in seconds.
+    public let time: Double
+    /// Mean luma, 0 (black) to 1 (white).
+    public let averageLuma: Double
+    public let minimumLuma: Double
+    public let maximumLuma: Double
+    /// Fraction of pixels darker than the black threshold.
+    public let blackPixelRatio: Double
+    /// Difference from the previous sample, 0 (identical) to 1 (unrelated); 0 for the first sample.
+    public let sceneScore: Double
+
+    /// Whether nearly the whole frame is black.
+    public var isBlack: Bool {
+        blackPixelRatio >= 0.98
+    }
+}
+
+extension SwiftFFmpeg {
+    /// Measure brightness, black frames and scene changes of keyframes only.
+    ///
+    /// Decoders run with `-skip_frame nokey`, so only intra frames are decoded, and with `-lowres` for
+    /// codecs that can decode at reduced size (MPEG-4 part 2, MJPEG); other codecs decode at full size.
+    /// Frames are scaled to `analysisWidth` before measuring. Since keyframes are typically one to ten
+    /// seconds apart, hours of video reduce to hundreds or thousands of decoded frames. Scene scores
+    /// compare consecutive samples rather than consecutive frames.
+    ///
+    /// - Parameters:
+    ///   - lowres: Decoder downscaling as a power of two (0 to 3).
+    ///   - blackThreshold: Luma, 0 to 1, below which a pixel counts as black.
+    public static func analyzeKeyframes(
+        _ path: String,
+        sampling: FFmpegAnalysisSampling = .keyframes,
+        lowres: Int = 1,
+        analysisWidth: Int = 160,
+        blackThreshold: Double = 0.125
+    ) throws -> [FFmpegAnalysisSample] {
+        let filters = analysisFilters(width: analysisWidth, blackThreshold: blackThreshold)
+        let decoderOptions = ["-skip_frame", "nokey", "-lowres", String(min(max(lowres, 0), 3))]
+
+        guard case .every(let interval) = sampling, interval > 0 else {
+            return try runAnalysis(
+                decoderOptions + ["-copyts", "-i", path],
+                filters: filters,
+                times: nil
+            )
+        }
+
+        let info = try probe(path)
+        let keyframeSpacing = (info.duration ?? 0) > interval
+            ? try estimatedKeyframeSpacing(of: path, frameRate: info.videoStreams.first?.framesPerSecond ?? 60)
+            : nil
+        let keyframes = try keyframeTimes(of: path, near: interval, info: info, keyframeSpacing: keyframeSpacing)
+        let times = sampledKeyframes(keyframes, interval: interval)
+        guard !times.isEmpty else { return [] }
+
+        // One concat entry per sample, from the keyframe to just past it; the few non-key packets
+        // that may follow in decode order are skipped by the decoder.
+        let entries = times.map { FFmpegConcatList.Entry(path: path, inpoint: $0, outpoint: $0 + 0.001) }
+        let samples = try runAnalysis(
+            ["-f", "concat", "-safe", "0"] + decoderOptions + ["-i", FFmpegConcatList.dataURL(for: entries)],
+            filters: filters,
+            times: times
+        )
+        if samples.count == times.count {
+            return samples
+        }
+        // A seek that did not land on its keyframe breaks the one-frame-per-entry mapping; fall back
+        // to a sequential keyframe pass.
+        let wanted = Set(times)
+        return try analyzeKeyframes(path, lowres: lowres, analysisWidth: analysisWidth, blackThreshold: blackThreshold)
+            .filter { sample in wanted.contains { abs($0 - sample.time) < 0.0005 } }
+    }
+
+    /// Keyframe times around each multiple of `interval`. Each window starts at a multiple and is
+    /// long enough to reach the next keyframe, judging by `keyframeSpacing` (from
+    /// `estimatedKeyframeSpacing`); the whole file is listed when the spacing is unknown or windows
+    /// that long would cover the file anyway.
+    static func keyframeTimes(
+        of path: String,
+        near interval: Double,
+        info: FFmpegMediaInfo,
+        keyframeSpacing: Double?
+    ) throws -> [Double] {
+        let frameRate = info.videoStreams.first?.framesPerSecond ?? 60
+        var intervals: String?
+        var expectedPackets = info.videoStreams.first?.frameCount ?? Int((info.duration ?? 0) * frameRate)
+        if let duration = info.duration, duration > interval, let spacing = keyframeSpacing {
+            let window = 2 * spacing + 1
+            if window < interval {
+                let starts = Array(stride(from: 0, to: duration, by: interval))
+                intervals = starts.map { String(format: "%.3f%%+%.3f", $0, window) }.joined(separator: ",")
+                expectedPackets = Int(Double(starts.count) * window * frameRate)
+            }
+        }
+        return try packetIndex(of: path, intervals: intervals, expectedPackets: expectedPackets)
+            .filter(\.isKeyframe)
+            .map(\.time)
+            .sorted()
+    }
+
+    /// The first keyframe at or after each multiple of `interval`.
+    static func sampledKeyframes(_ keyframes: [Double], interval: Double) -> [Double] {
+        var times: [Double] = []
+        var next = -Double.infinity
+        for time in keyframes where time >= next {
+            times.append(time)
+            next = ((time / interval).rounded(.down) + 1) * interval
+        }
+        return times
+    }
+
+    private static func analysisFilters(width: Int, blackThreshold: Double) -> String {
+        let threshold = Int((min(max(blackThreshold, 0), 1) * 255).rounded())
+        return [
+            "scale=\(max(width, 16)):-2:flags=fast_bilinear",
+            "format=yuv420p",
+            "signalstats",
+            "blackframe=amount=0:threshold=\(threshold)",
+            "select='gte(scene,0)'"
+        ].joined(separator: ",")
+    }
+
+    /// Run the analysis graph on the first video stream of `inputArguments` and parse one sample per
+    /// frame. With `times`, the n-th frame is given the n-th time instead of its own timestamp.
+    private static func runAnalysis(_ inputArguments: [String], filters: String, times: [Double]?) throws -> [FFmpegAnalysisSample] {
+        try withMemoryFiles { files in
+            let report = files.url("analysis.txt")
+            _ = try executeDetailed(
+                ["-nostdin"] + inputArguments + [
+                    "-map", "0:v:0",
+                    "-an", "-sn", "-dn",
+                    "-vf", "\(filters),metadata=mode=print:file='\(report)'",
+                    "-fps_mode", "passthrough",
+                    "-f", "null", "-"
+                ]
+            )
+            guard files.size(of: "analysis.txt") != nil else { return [] }
+            let text = String(decoding: try files.data(of: "analysis.txt"), as: UTF8.self)
+            let samples = parseAnalysisReport(text)
+            guard let times else { return samples }
+            return zip(samples, times).map { sample, time in
+                FFmpegAnalysisSample(
+                    time: time,
+                    averageLuma: sample.averageLuma,
+                    minimumLuma: sample.minimumLuma,
+                    maximumLuma: sample.maximumLuma,
+                    blackPixelRatio: sample.blackPixelRatio,
+                    sceneScore: sample.sceneScore
+                )
+            }
+        }
+    }
+
+    /// Parse `metadata=mode=print` output: a `frame:N pts:P pts_time:T` line followed by `key=value`
+    /// lines for each frame.
+    static func parseAnalysisReport(_ text: String) -> [FFmpegAnalysisSample] {
+        var samples: [FFmpegAnalysisSample] = []
+        var time: Double?
+        var values: [String: Double] = [:]
+
+        func flush() {
+            guard let frameTime = time else { return }
+            samples.append(FFmpegAnalysisSample(
+                time: frameTime,
+                averageLuma: (values["lavfi.signalstats.YAVG"] ?? 0) / 255,
+                minimumLuma: (values["lavfi.signalstats.YMIN"] ?? 0) / 255,
+                maximumLuma: (values["lavfi.signalstats.YMAX"] ?? 0) / 255,
+                blackPixelRatio: (values["lavfi.blackframe.pblack"] ?? 0) / 100,
+                sceneScore: samples.isEmpty ? 0 : values["lavfi.scene_score"] ?? 0
+            ))
+        }
+
+        for line in text.split(whereSeparator: \.isNewline) {
+            if line.hasPrefix("frame:") {
+                flush()
+                values = [:]
+                time = line.split(separator: " ")
+                    .first { $0.hasPrefix("pts_time:") }
+                    .flatMap { Double($0.dropFirst("pts_time:".count)) }
+            } else if let separator = line.firstIndex(of: "=") {
+                values[String(line[..<separator])] = Double(line[line.index(after: separator)...])
+            }
+        }
+        flush()
+        return samples
+    }
+}
@@ -0,0 +1,98 @@
+import Foundation
+
+/// Runs at most one execution per key at a time; callers arriving while it runs share its result.
+final class FFmpegSingleFlight<Value> {
+    private final class Call {
+        let condition = NSCondition()
+        var result: Result<Value, Error>?
+    }
+
+    private let lock = NSLock()
+    private var calls: [String: Call] = [:]
+    private var executions = 0
+    private var sharedResults = 0
+
+    var counts: (executions: Int, shared: Int) {
+        lock.lock()
+        defer { lock.unlock() }
+        return (executions, sharedResults)
+    }
+
+    func run(key: String, _ body: () throws -> Value) throws -> Value {
+        lock.lock()
+        if let call = calls[key] {
+            sharedResults += 1
+            lock.unlock()
+
+            call.condition.lock()
+            while call.result == nil {
+                call.condition.wait()
+            }
+            let result = call.result!
+            call.condition.unlock()
+            return try result.get()
+        }
+
+        let call = Call()
+        calls[key] = call
+        executions += 1
+        lock.unlock()
+
+        let result = Result { try body() }
+
+        // Unregister before publishing so callers arriving from now on start a fresh execution.
+        lock.lock()
+        calls[key] = nil
+        lock.unlock()
+
+        call.condition.lock()
+        call.result = result
+        call.condition.broadcast()
+        call.condition.unlock()
+
+        return try result.get()
+    }
+}
+
+public struct FFmpegCoalescingMetrics {
+    /// Executions that actually ran.
+    public let executions: Int
+    /// Requests that attached to an identical execution already in flight.
+    public let coalesced: Int
+}
+
+extension SwiftFFmpeg {
+    private static let singleFlight = FFmpegSingleFlight<FFmpegExecutionResult>()
+
+    /// Execute like `executeDetailed`, but share one execution among identical concurrent requests.
+    ///
+    /// Requests are identical when the tool and the argument list match after dropping options that
+    /// only affect logging. A request arriving while an identical one runs waits for it and receives
+    /// the same result or error instead of queueing a duplicate behind the execution lock. Use it for
+    /// idempotent work such as probes and thumbnails; requests are not coalesced once the first has finished.
+    public static func executeCoalesced(_ arguments: [String], tool: FFmpegTool = .ffmpeg) throws -> FFmpegExecutionResult {
+        try singleFlight.run(key: coalescingKey(arguments, tool: tool)) {
+            try executeDetailed(arguments, tool: tool)
+        }
+    }
+
+    public static var coalescingMetrics: FFmpegCoalescingMetrics {
+        let counts = singleFlight.counts
+        return FFmpegCoalescingMetrics(executions: counts.executions, coalesced: counts.shared)
+    }
+
+    private static func coalescingKey(_ arguments: [String], tool: FFmpegTool) -> String {
+        var parts = [tool == .ffmpeg ? "ffmpeg" : "ffprobe"]
+        var index = 0
+        while index < arguments.count {
+            let argument = arguments[index]
+            if ["-y", "-hide_banner", "-nostats"].contains(argument) {
+                index += 1
+                continue
+            }
+            parts.append(argument)
+            index += 1
+        }
+        return parts.joined(separator: "\u{0}")
+    }
+}
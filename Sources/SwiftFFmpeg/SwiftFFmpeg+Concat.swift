@@ -0,0 +1,394 @@
+import Foundation
+
+/// How a clip reached the joined output.
+public enum FFmpegConcatClipPath: Equatable {
+    /// Packets were copied straight from the source clip.
+    case streamCopy
+    /// Stream parameters already matched, but the track layout did not; the clip was rewrapped with `-c copy`.
+    case remuxed
+    /// The clip was re-encoded to the reference stream parameters.
+    case reencoded(reason: String)
+}
+
+public struct FFmpegConcatClipReport {
+    public let path: String
+    public let clipPath: FFmpegConcatClipPath
+}
+
+public struct FFmpegConcatResult {
+    public let outputPath: String
+    public let clips: [FFmpegConcatClipReport]
+    public let execution: FFmpegExecutionResult
+}
+
+extension SwiftFFmpeg {
+    /// Join clips into `outputPath` without writing a concat list file.
+    ///
+    /// Every clip is probed first. The stream layout shared by most of the total duration becomes the
+    /// reference; clips matching it are stream-copied, and the rest are normalized to it in a single
+    /// multi-output ffmpeg run so their encodes proceed concurrently. The final join is always `-c copy`.
+    public static func concat(_ clips: [String], to outputPath: String) throws -> FFmpegConcatResult {
+        guard !clips.isEmpty else {
+            throw SwiftFFmpegError.invalidArgument("concat requires at least one clip")
+        }
+
+        let infos = try clips.map { try probe($0) }
+        let signatures = infos.map(FFmpegConcatSignature.init(info:))
+        guard let reference = FFmpegConcatSignature.reference(signatures, infos: infos) else {
+            throw SwiftFFmpegError.invalidArgument("none of the clips contain audio or video streams")
+        }
+
+        var paths: [FFmpegConcatClipPath] = signatures.map { signature in
+            if signature == reference {
+                return .streamCopy
+            }
+            return .reencoded(reason: signature.mismatchDescription(against: reference))
+        }
+
+        // Normalized clips always come out in the canonical video-then-audio layout, so clips that
+        // only match the reference by parameters must be rewrapped into that layout as well.
+        if paths.contains(where: { if case .reencoded = $0 { return true }; return false }),
+           !reference.hasCanonicalLayout {
+            paths = paths.map { $0 == .streamCopy ? .remuxed : $0 }
+        }
+
+        let workDirectory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("SwiftFFmpeg-concat-\(UUID().uuidString)", isDirectory: true)
+        defer { try? FileManager.default.removeItem(at: workDirectory) }
+
+        let outputExtension = (outputPath as NSString).pathExtension.isEmpty
+            ? "mp4"
+            : (outputPath as NSString).pathExtension
+        var joinPaths = clips
+        var normalizeArguments: [String] = []
+        var outputArguments: [String] = []
+        var inputCount = 0
+
+        for (index, clipPath) in paths.enumerated() where clipPath != .streamCopy {
+            if normalizeArguments.isEmpty {
+                try FileManager.default.createDirectory(at: workDirectory, withIntermediateDirectories: true)
+            }
+
+            let intermediate = workDirectory.appendingPathComponent("clip-\(index).\(outputExtension)").path
+            joinPaths[index] = intermediate
+
+            let sourceInput = inputCount
+            normalizeArguments += ["-i", clips[index]]
+            inputCount += 1
+
+            var blankInput: Int?
+            if let video = reference.video, signatures[index].video == nil, clipPath != .remuxed {
+                normalizeArguments += ["-f", "lavfi", "-i", video.blankSource]
+                blankInput = inputCount
+                inputCount += 1
+            }
+
+            var silenceInput: Int?
+            if reference.audio != nil, signatures[index].audio == nil, clipPath != .remuxed {
+                normalizeArguments += ["-f", "lavfi", "-i", reference.silenceSource]
+                silenceInput = inputCount
+                inputCount += 1
+            }
+
+            outputArguments += normalizationArguments(
+                for: clipPath,
+                sourceInput: sourceInput,
+                blankInput: blankInput,
+                silenceInput: silenceInput,
+                reference: reference,
+                duration: infos[index].duration
+            )
+            outputArguments.append(intermediate)
+        }
+
+        if !normalizeArguments.isEmpty {
+            _ = try executeDetailed(["-y"] + normalizeArguments + outputArguments)
+        }
+
+        var joinArguments = ["-y", "-f", "concat", "-safe", "0", "-i", FFmpegConcatList.dataURL(for: joinPaths)]
+        if reference.video != nil {
+            joinArguments += ["-map", "0:v:0"]
+        }
+        if reference.audio != nil {
+            joinArguments += ["-map", "0:a:0"]
+        }
+        joinArguments += ["-c", "copy", outputPath]
+
+        let execution = try executeDetailed(joinArguments)
+        let reports = zip(clips, paths).map { FFmpegConcatClipReport(path: $0, clipPath: $1) }
+        return FFmpegConcatResult(outputPath: outputPath, clips: reports, execution: execution)
+    }
+
+    private static func normalizationArguments(
+        for clipPath: FFmpegConcatClipPath,
+        sourceInput: Int,
+        blankInput: Int?,
+        silenceInput: Int?,
+        reference: FFmpegConcatSignature,
+        duration: Double?
+    ) -> [String] {
+        var arguments: [String] = []
+
+        if clipPath == .remuxed {
+            if reference.video != nil {
+                arguments += ["-map", "\(sourceInput):v:0"]
+            }
+            if reference.audio != nil {
+                arguments += ["-map", "\(sourceInput):a:0"]
+            }
+            return arguments + ["-c", "copy"]
+        }
+
+        if let video = reference.video {
+            arguments += ["-map", "\(blankInput ?? sourceInput):v:0", "-c:v", video.encoder]
+            arguments += ["-vf", video.normalizationFilter, "-pix_fmt", video.pixelFormat]
+            if let timescale = video.timescale {
+                arguments += ["-video_track_timescale", String(timescale)]
+            }
+            if let profile = video.encoderProfile {
+                arguments += ["-profile:v", profile]
+            }
+            if let bitRate = video.bitRate {
+                arguments += ["-b:v", String(bitRate)]
+            }
+        }
+
+        if let audio = reference.audio {
+            let audioInput = silenceInput ?? sourceInput
+            arguments += ["-map", "\(audioInput):a:0", "-c:a", audio.encoder]
+            arguments += ["-ar", String(audio.sampleRate), "-ac", String(audio.channels)]
+            if let bitRate = audio.bitRate {
+                arguments += ["-b:a", String(bitRate)]
+            }
+        }
+
+        // Synthesized black video and silence are endless; cut them at the clip's length.
+        if blankInput != nil || silenceInput != nil, let duration {
+            arguments += ["-t", String(duration)]
+        }
+
+        return arguments
+    }
+}
+
+/// In-memory concat demuxer script, passed to ffmpeg as a `data:` URL instead of a list file.
+enum FFmpegConcatList {
+    struct Entry {
+        let path: String
+        var inpoint: Double?
+        var outpoint: Double?
+    }
+
+    static func dataURL(for paths: [String]) -> String {
+        dataURL(for: paths.map { Entry(path: $0) })
+    }
+
+    static func dataURL(for entries: [Entry]) -> String {
+        var script = "ffconcat version 1.0\n"
+        for entry in entries {
+            // A `file:` URL keeps the demuxer from resolving the path against the data: base URL.
+            let url = entry.path.hasPrefix("/") ? "file:" + entry.path : entry.path
+            script += "file '\(url.replacingOccurrences(of: "'", with: "'\\''"))'\n"
+            if let inpoint = entry.inpoint {
+                script += "inpoint \(inpoint)\n"
+            }
+            if let outpoint = entry.outpoint {
+                script += "outpoint \(outpoint)\n"
+            }
+        }
+        return "data:text/plain;base64," + Data(script.utf8).base64EncodedString()
+    }
+}
+
+/// The stream parameters the concat demuxer needs to match for a stream-copy join.
+struct FFmpegConcatSignature: Equatable {
+    struct Video: Equatable {
+        let index: Int
+        let codec: String
+        let profile: String?
+        let width: Int
+        let height: Int
+        let pixelFormat: String
+        let sampleAspectRatio: String
+        /// Nominal frame rate as ffprobe reports it, e.g. `30000/1001`.
+        let frameRate: String
+        let timeBase: String?
+        let bitRate: Int64?
+
+        static func == (lhs: Video, rhs: Video) -> Bool {
+            lhs.index == rhs.index && lhs.codec == rhs.codec && lhs.profile == rhs.profile &&
+                lhs.width == rhs.width && lhs.height == rhs.height &&
+                lhs.pixelFormat == rhs.pixelFormat && lhs.sampleAspectRatio == rhs.sampleAspectRatio &&
+                lhs.frameRate == rhs.frameRate
+        }
+
+        /// Track timescale of the reference, so normalized clips share its timestamp units.
+        var timescale: Int? {
+            guard let timeBase, timeBase.hasPrefix("1/") else { return nil }
+            return Int(timeBase.dropFirst(2))
+        }
+
+        /// Black frames in the reference format, for clips without video.
+        var blankSource: String {
+            "color=c=black:s=\(width)x\(height):r=\(frameRate)"
+        }
+
+        var encoder: String {
+            switch codec {
+            case "h264": return "h264_videotoolbox"
+            case "hevc": return "hevc_videotoolbox"
+            default: return codec
+            }
+        }
+
+        var encoderProfile: String? {
+            guard let profile, codec == "h264" || codec == "hevc" else { return nil }
+            switch profile.lowercased() {
+            case "baseline", "constrained baseline": return "baseline"
+            case "main": return "main"
+            case "high": return "high"
+            case "main 10": return "main10"
+            default: return nil
+            }
+        }
+
+        var normalizationFilter: String {
+            let sar = sampleAspectRatio == "0:1" ? "1" : sampleAspectRatio.replacingOccurrences(of: ":", with: "/")
+            return "scale=\(width):\(height):force_original_aspect_ratio=decrease," +
+                "pad=\(width):\(height):(ow-iw)/2:(oh-ih)/2,setsar=\(sar),fps=\(frameRate)"
+        }
+    }
+
+    struct Audio: Equatable {
+        let index: Int
+        let codec: String
+        let profile: String?
+        let sampleRate: Int
+        let channels: Int
+        let bitRate: Int64?
+
+        static func == (lhs: Audio, rhs: Audio) -> Bool {
+            lhs.index == rhs.index && lhs.codec == rhs.codec && lhs.profile == rhs.profile &&
+                lhs.sampleRate == rhs.sampleRate && lhs.channels == rhs.channels
+        }
+
+        var encoder: String {
+            codec == "mp3" ? "libmp3lame" : codec
+        }
+    }
+
+    let video: Video?
+    let audio: Audio?
+
+    init(info: FFmpegMediaInfo) {
+        video = info.videoStreams.first.flatMap { stream in
+            guard let codec = stream.codecName, let width = stream.width, let height = stream.height else {
+                return nil
+            }
+            return Video(
+                index: stream.index,
+                codec: codec,
+                profile: stream.profile,
+                width: width,
+                height: height,
+                pixelFormat: stream.pixelFormat ?? "yuv420p",
+                sampleAspectRatio: stream.sampleAspectRatio ?? "1:1",
+                frameRate: stream.frameRate ?? "30/1",
+                timeBase: stream.timeBase,
+                bitRate: stream.bitRate
+            )
+        }
+        audio = info.audioStreams.first.flatMap { stream in
+            guard let codec = stream.codecName, let sampleRate = stream.sampleRate, let channels = stream.channels else {
+                return nil
+            }
+            return Audio(
+                index: stream.index,
+                codec: codec,
+                profile: stream.profile,
+                sampleRate: sampleRate,
+                channels: channels,
+                bitRate: stream.bitRate
+            )
+        }
+    }
+
+    /// True when the layout is exactly what a normalization run produces: video first, then audio.
+    var hasCanonicalLayout: Bool {
+        switch (video, audio) {
+        case let (video?, audio?): return video.index == 0 && audio.index == 1
+        case let (video?, nil): return video.index == 0
+        case let (nil, audio?): return audio.index == 0
+        case (nil, nil): return false
+        }
+    }
+
+    var silenceSource: String {
+        guard let audio else { return "anullsrc" }
+        return "anullsrc=r=\(audio.sampleRate):cl=\(audio.channels == 1 ? "mono" : "stereo")"
+    }
+
+    func mismatchDescription(against reference: FFmpegConcatSignature) -> String {
+        var differences: [String] = []
+        switch (video, reference.video) {
+        case let (video?, expected?):
+            if video.codec != expected.codec || video.profile != expected.profile {
+                differences.append("video codec \(video.codec) \(video.profile ?? "")")
+            }
+            if video.width != expected.width || video.height != expected.height {
+                differences.append("resolution \(video.width)x\(video.height)")
+            }
+            if video.pixelFormat != expected.pixelFormat {
+                differences.append("pixel format \(video.pixelFormat)")
+            }
+            if video.sampleAspectRatio != expected.sampleAspectRatio {
+                differences.append("sample aspect ratio \(video.sampleAspectRatio)")
+            }
+            if video.frameRate != expected.frameRate {
+                differences.append("frame rate \(video.frameRate)")
+            }
+            if video.index != expected.index {
+                differences.append("video track order")
+            }
+        case (nil, _?):
+            differences.append("missing video")
+        case (_?, nil):
+            differences.append("unexpected video")
+        case (nil, nil):
+            break
+        }
+        switch (audio, reference.audio) {
+        case let (audio?, expected?):
+            if audio.codec != expected.codec || audio.profile != expected.profile {
+                differences.append("audio codec \(audio.codec) \(audio.profile ?? "")")
+            }
+            if audio.sampleRate != expected.sampleRate || audio.channels != expected.channels {
+                differences.append("audio format \(audio.sampleRate) Hz \(audio.channels) ch")
+            }
+            if audio.index != expected.index {
+                differences.append("audio track order")
+            }
+        case (nil, _?):
+            differences.append("missing audio")
+        case (_?, nil):
+            differences.append("unexpected audio")
+        case (nil, nil):
+            break
+        }
+        return differences.map { $0.trimmingCharacters(in: .whitespaces) }.joined(separator: ", ")
+    }
+
+    /// The signature covering the largest share of the total duration, so the most material is copied.
+    static func reference(_ signatures: [FFmpegConcatSignature], infos: [FFmpegMediaInfo]) -> FFmpegConcatSignature? {
+        var best: (signature: FFmpegConcatSignature, weight: Double)?
+        for candidate in signatures where candidate.video != nil || candidate.audio != nil {
+            let weight = zip(signatures, infos)
+                .filter { $0.0 == candidate }
+                .reduce(0) { $0 + ($1.1.duration ?? 1) }
+            if best == nil || weight > best!.weight {
+                best = (candidate, weight)
+            }
+        }
+        return best?.signature
+    }
+}
@@ -0,0 +1,127 @@
+import Foundation
+
+/// How a progressive-playback MP4 was produced.
+public enum FFmpegFastStartPath: Equatable {
+    /// `moov` was written into space reserved at the front of the file; media data was written once.
+    case reserved(bytes: Int)
+    /// The reservation was too small and the export was redone with a larger one.
+    case reservedAfterRetry(bytes: Int)
+    /// No usable estimate; the muxer's two-pass `+faststart` relocation was used instead.
+    case faststartRelocation
+}
+
+public struct FFmpegFastStartResult {
+    public let path: FFmpegFastStartPath
+    public let execution: FFmpegExecutionResult
+}
+
+extension SwiftFFmpeg {
+    /// Export an MP4/MOV with `moov` at the front in a single write pass.
+    ///
+    /// The size of `moov` is estimated from a probe of `sourcePath` and reserved up front with the mp4
+    /// muxer's `moov_size` option, which avoids the second pass `-movflags +faststart` needs to move
+    /// `moov` in front of the media data. If the reservation turns out too small, the muxer reports the
+    /// shortfall and the export is retried once with a reservation that covers it. Without a duration
+    /// to estimate from, or when the failure reports no shortfall, `+faststart` is used.
+    ///
+    /// - Parameters:
+    ///   - arguments: Input and encoding arguments, without the output path.
+    ///   - outputPath: MP4 or MOV file to write.
+    ///   - sourcePath: The main input, probed for the estimate.
+    public static func exportFastStart(
+        _ arguments: [String],
+        to outputPath: String,
+        estimatingFrom sourcePath: String
+    ) throws -> FFmpegFastStartResult {
+        // Without periodic stats the muxer's trailer error stays within the captured stderr, however
+        // long the encode runs.
+        let baseArguments = ["-hide_banner", "-nostats"] + removingFaststartFlag(from: arguments)
+        let relocate = {
+            FFmpegFastStartResult(
+                path: .faststartRelocation,
+                execution: try executeDetailed(["-y"] + baseArguments + ["-movflags", "+faststart", outputPath])
+            )
+        }
+
+        guard let estimate = try? estimatedMoovSize(for: probe(sourcePath)) else {
+            return try relocate()
+        }
+
+        do {
+            let execution = try executeDetailed(
+                ["-y"] + baseArguments + ["-moov_size", String(estimate), outputPath]
+            )
+            return FFmpegFastStartResult(path: .reserved(bytes: estimate), execution: execution)
+        } catch let SwiftFFmpegError.executionFailed(_, _, stderr) {
+            guard let shortfall = moovShortfall(in: stderr) else {
+                return try relocate()
+            }
+            let retrySize = estimate + shortfall + max(4096, estimate / 4)
+            let execution = try executeDetailed(
+                ["-y"] + baseArguments + ["-moov_size", String(retrySize), outputPath]
+            )
+            return FFmpegFastStartResult(path: .reservedAfterRetry(bytes: retrySize), execution: execution)
+        }
+    }
+
+    /// Upper-bound estimate of the `moov` atom the mov muxer will write for the probed input.
+    ///
+    /// Sample tables dominate: `stsz` costs 4 bytes per sample, `stts`/`ctts` up to 8 bytes each per
+    /// video sample once B-frame reordering breaks the runs, `stss` 4 bytes per keyframe and
+    /// `stco`/`co64` plus `stsc` about 20 bytes per chunk (the muxer cuts roughly two chunks per second).
+    static func estimatedMoovSize(for info: FFmpegMediaInfo) -> Int? {
+        guard let duration = info.duration, duration > 0 else { return nil }
+
+        var bytes = 4096
+        for stream in info.streams {
+            let streamDuration = stream.duration ?? duration
+            let chunks = Int((streamDuration * 2).rounded(.up)) + 1
+            bytes += 1024 + chunks * 20
+
+            if stream.isVideo {
+                let fps = stream.framesPerSecond ?? 30
+                let samples = stream.frameCount ?? Int((streamDuration * fps).rounded(.up))
+                bytes += samples * (4 + 8 + 8)
+                bytes += Int(streamDuration.rounded(.up)) * 4
+            } else if stream.isAudio {
+                let sampleRate = Double(stream.sampleRate ?? 48000)
+                let samplesPerFrame: Double = stream.codecName == "mp3" ? 1152 : 1024
+                bytes += Int((streamDuration * sampleRate / samplesPerFrame).rounded(.up)) * 4
+            } else {
+                bytes += (stream.frameCount ?? Int(streamDuration.rounded(.up))) * 12
+            }
+        }
+        return bytes + bytes / 4
+    }
+
+    /// Parse "reserved_moov_size is too small, needed N additional" from the muxer log.
+    static func moovShortfall(in stderr: String) -> Int? {
+        guard let range = stderr.range(of: "reserved_moov_size is too small, needed ") else {
+            return nil
+        }
+        let digits = stderr[range.upperBound...].prefix(while: \.isNumber)
+        return Int(digits)
+    }
+
+    private static func removingFaststartFlag(from arguments: [String]) -> [String] {
+        var result: [String] = []
+        var index = 0
+        while index < arguments.count {
+            let argument = arguments[index]
+            if argument == "-movflags", index + 1 < arguments.count {
+                let flags = arguments[index + 1]
+                    .split(separator: "+", omittingEmptySubsequences: true)
+                    .map(String.init)
+                    .filter { $0 != "faststart" }
+                if !flags.isEmpty {
+                    result += ["-movflags", "+" + flags.joined(separator: "+")]
+                }
+                index += 2
+                continue
+            }
+            result.append(argument)
+            index += 1
+        }
+        return result
+    }
+}
@@ -0,0 +1,231 @@
+import Foundation
+internal import CFFmpegCLI
+
+/// A top-level MP4/MOV atom, read without touching media data.
+struct FFmpegMP4Atom {
+    let type: String
+    let offset: Int64
+    let size: Int64
+
+    var end: Int64 { offset + size }
+}
+
+public struct FFmpegHLSPackage {
+    public let playlistPath: String
+    /// The file the playlist's byte ranges point into.
+    public let mediaPath: String
+    public let segmentCount: Int
+    /// False when the playlist references the original file; true when a fragmented copy was written.
+    public let wroteMedia: Bool
+}
+
+extension SwiftFFmpeg {
+    /// Package an MP4 for HLS using `EXT-X-BYTERANGE` segments.
+    ///
+    /// A fragmented MP4 is indexed in place: fragment boundaries come from the top-level atom scan and
+    /// their timing from the packet index, so only the playlist is written. Any other input is remuxed
+    /// once with `-c copy` by the hls muxer in `single_file` fMP4 mode, which writes the fragmented copy
+    /// (to `fragmentedCopyPath`, next to the playlist by default) and its byte-range playlist in the same pass.
+    ///
+    /// - Parameter segmentDuration: Target duration; consecutive fragments are grouped up to it.
+    public static func packageHLS(
+        _ sourcePath: String,
+        playlistPath: String,
+        segmentDuration: Double = 6,
+        fragmentedCopyPath: String? = nil
+    ) throws -> FFmpegHLSPackage {
+        let atoms = try topLevelAtoms(of: sourcePath)
+        if atoms.contains(where: { $0.type == "moof" }) {
+            return try packageFragmentedMP4(
+                sourcePath,
+                atoms: atoms,
+                playlistPath: playlistPath,
+                segmentDuration: segmentDuration
+            )
+        }
+
+        let mediaPath = fragmentedCopyPath ?? URL(fileURLWithPath: playlistPath)
+            .deletingPathExtension()
+            .appendingPathExtension("mp4")
+            .path
+        _ = try executeDetailed([
+            "-y",
+            "-i", sourcePath,
+            "-map", "0:v?", "-map", "0:a?",
+            "-c", "copy",
+            "-f", "hls",
+            "-hls_segment_type", "fmp4",
+            "-hls_flags", "single_file",
+            "-hls_playlist_type", "vod",
+            "-hls_time", String(segmentDuration),
+            "-hls_segment_filename", mediaPath,
+            playlistPath
+        ])
+
+        let segmentCount = (try? String(contentsOfFile: playlistPath, encoding: .utf8))
+            .map { $0.components(separatedBy: "#EXTINF:").count - 1 } ?? 0
+        return FFmpegHLSPackage(
+            playlistPath: playlistPath,
+            mediaPath: mediaPath,
+            segmentCount: segmentCount,
+            wroteMedia: true
+        )
+    }
+
+    private static func packageFragmentedMP4(
+        _ sourcePath: String,
+        atoms: [FFmpegMP4Atom],
+        playlistPath: String,
+        segmentDuration: Double
+    ) throws -> FFmpegHLSPackage {
+        let fragments = atoms.filter { $0.type == "moof" }
+        guard let firstFragment = fragments.first else {
+            throw SwiftFFmpegError.invalidArgument("\(sourcePath) has no movie fragments")
+        }
+        let mediaEnd = atoms.last?.end ?? firstFragment.end
+
+        // A fragment spans from its moof to the next moof (or the end of the media), covering its
+        // mdat and any styp/sidx boxes in between.
+        let fragmentEnds = fragments.dropFirst().map(\.offset) + [mediaEnd]
+
+        let info = try probe(sourcePath)
+        let timingStream = info.videoStreams.isEmpty ? "a:0" : "v:0"
+        let expectedPackets = (info.videoStreams.first ?? info.audioStreams.first)?.frameCount
+            ?? Int((info.duration ?? 0) * 60)
+        let packets = try packetIndex(of: sourcePath, stream: timingStream, expectedPackets: expectedPackets)
+
+        // Fragments past the end of the index would silently fall out of the playlist.
+        let timingDuration = (info.videoStreams.first ?? info.audioStreams.first)?.duration ?? info.duration
+        if let first = packets.first, let last = packets.last, let timingDuration,
+           last.time + (last.duration ?? 0) - first.time < timingDuration - 1 {
+            throw SwiftFFmpegError.invalidArgument(
+                "packet index of \(sourcePath) ends at \(last.time)s, short of its \(timingDuration)s duration"
+            )
+        }
+
+        var startTimes = [Double?](repeating: nil, count: fragments.count)
+        var startsWithKeyframe = [Bool](repeating: false, count: fragments.count)
+        var firstPosition = [Int64](repeating: .max, count: fragments.count)
+        for packet in packets {
+            guard let position = packet.position,
+                  let index = fragmentIndex(containing: position, fragments: fragments, ends: fragmentEnds) else {
+                continue
+            }
+            startTimes[index] = min(startTimes[index] ?? packet.time, packet.time)
+            if position < firstPosition[index] {
+                firstPosition[index] = position
+                startsWithKeyframe[index] = packet.isKeyframe
+            }
+        }
+
+        let endTime = info.duration ?? (packets.last.map { $0.time + ($0.duration ?? 0) } ?? 0)
+        var segments: [(offset: Int64, length: Int64, duration: Double)] = []
+        var allIndependent = true
+        var current: (offset: Int64, end: Int64, start: Double)?
+        var leadingOffset: Int64?
+
+        for index in fragments.indices {
+            // Fragments without a packet of the timing stream still carry bytes of other streams;
+            // they belong to the segment before them (or the first one).
+            guard let start = startTimes[index] else {
+                if let open = current {
+                    current = (open.offset, fragmentEnds[index], open.start)
+                } else if leadingOffset == nil {
+                    leadingOffset = fragments[index].offset
+                }
+                continue
+            }
+            if let open = current,
+               start - open.start < segmentDuration || !startsWithKeyframe[index] {
+                current = (open.offset, fragmentEnds[index], open.start)
+                continue
+            }
+            if let open = current {
+                segments.append((open.offset, open.end - open.offset, start - open.start))
+            }
+            allIndependent = allIndependent && startsWithKeyframe[index]
+            current = (leadingOffset ?? fragments[index].offset, fragmentEnds[index], start)
+            leadingOffset = nil
+        }
+        if let open = current {
+            segments.append((open.offset, open.end - open.offset, max(endTime - open.start, 0)))
+        }
+
+        let mediaURI = playlistURI(for: sourcePath, relativeTo: playlistPath)
+        let targetDuration = Int((segments.map(\.duration).max() ?? segmentDuration).rounded(.up))
+        var playlist = """
+        #EXTM3U
+        #EXT-X-VERSION:7
+        #EXT-X-TARGETDURATION:\(max(targetDuration, 1))
+        #EXT-X-MEDIA-SEQUENCE:0
+        #EXT-X-PLAYLIST-TYPE:VOD
+
+        """
+        if allIndependent {
+            playlist += "#EXT-X-INDEPENDENT-SEGMENTS\n"
+        }
+        playlist += "#EXT-X-MAP:URI=\"\(mediaURI)\",BYTERANGE=\"\(firstFragment.offset)@0\"\n"
+        for segment in segments {
+            playlist += "#EXTINF:\(String(format: "%.6f", segment.duration)),\n"
+            playlist += "#EXT-X-BYTERANGE:\(segment.length)@\(segment.offset)\n"
+            playlist += "\(mediaURI)\n"
+        }
+        playlist += "#EXT-X-ENDLIST\n"
+
+        try playlist.write(toFile: playlistPath, atomically: true, encoding: .utf8)
+        return FFmpegHLSPackage(
+            playlistPath: playlistPath,
+            mediaPath: sourcePath,
+            segmentCount: segments.count,
+            wroteMedia: false
+        )
+    }
+
+    private static func fragmentIndex(containing position: Int64, fragments: [FFmpegMP4Atom], ends: [Int64]) -> Int? {
+        var low = 0
+        var high = fragments.count - 1
+        while low <= high {
+            let mid = (low + high) / 2
+            if position < fragments[mid].offset {
+                high = mid - 1
+            } else if position >= ends[mid] {
+                low = mid + 1
+            } else {
+                return mid
+            }
+        }
+        return nil
+    }
+
+    private static func playlistURI(for mediaPath: String, relativeTo playlistPath: String) -> String {
+        let mediaURL = URL(fileURLWithPath: mediaPath).standardizedFileURL
+        let playlistDirectory = URL(fileURLWithPath: playlistPath).standardizedFileURL.deletingLastPathComponent()
+        if mediaURL.deletingLastPathComponent().path == playlistDirectory.path {
+            return mediaURL.lastPathComponent
+        }
+        return mediaURL.absoluteString
+    }
+
+    /// Scan the top-level atoms of an MP4/MOV file.
+    static func topLevelAtoms(of path: String) throws -> [FFmpegMP4Atom] {
+        var capacity = 256
+        while true {
+            var atoms = [ffmpeg_mp4_atom](repeating: ffmpeg_mp4_atom(), count: capacity)
+            let count = Int(ffmpeg_mp4_scan_atoms(path, &atoms, Int32(capacity)))
+            if count < 0 {
+                throw SwiftFFmpegError.fileOperationFailed(path: path, errno: Int32(-count))
+            }
+            if count <= capacity {
+                return atoms.prefix(count).map { atom in
+                    let bytes = withUnsafeBytes(of: atom.type.bigEndian) { Array($0) }
+                    return FFmpegMP4Atom(
+                        type: String(decoding: bytes, as: UTF8.self),
+                        offset: atom.offset,
+                        size: atom.size
+                    )
+                }
+            }
+            capacity = count
+        }
+    }
+}
@@ -0,0 +1,438 @@
+import Foundation
+internal import CFFmpegCLI
+
+public struct FFmpegHTTPCacheStats {
+    /// HTTP requests made, including the revalidation each input makes when it is opened.
+    public let requests: Int64
+    /// Bytes transferred by range requests.
+    public let fetchedBytes: Int64
+    /// Bytes served from cached blocks in memory.
+    public let memoryHitBytes: Int64
+    /// Bytes served from cached blocks on disk.
+    public let diskHitBytes: Int64
+}
+
+extension SwiftFFmpeg {
+    /// URL that reads the remote file at `url` through the HTTP range cache.
+    ///
+    /// The file is fetched in 256 KiB blocks with range requests. A read that misses fetches the whole
+    /// run of adjacent missing blocks at once, so probing and seeking cost a handful of requests rather
+    /// than one per demuxer read. Blocks are kept in memory and, when a directory is configured, on
+    /// disk, keyed by URL and the server's ETag (or Last-Modified): later jobs on the same URL are
+    /// served locally after a single revalidation request, and a changed file is fetched afresh.
+    /// Files the server sends without either header are cached in memory only.
+    public static func cachedHTTPInput(_ url: String) -> String {
+        HTTPFetcher.install()
+        return "shim:httpcache/\(url)"
+    }
+
+    /// Set where and how much the HTTP range cache keeps. Blocks already on disk in `directory` are
+    /// reused. The defaults hold 32 MiB in memory and nothing on disk.
+    public static func configureHTTPCache(directory: URL?, memoryBytes: Int64 = 32 << 20, diskBytes: Int64 = 512 << 20) throws {
+        if let directory = directory {
+            try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+        }
+        let result = directory?.path.withCString { ffmpeg_httpcache_configure($0, memoryBytes, diskBytes) }
+            ?? ffmpeg_httpcache_configure(nil, memoryBytes, 0)
+        if result != 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: directory?.path ?? "", errno: -result)
+        }
+    }
+
+    /// Drop every cached block from memory and disk.
+    public static func clearHTTPCache() {
+        ffmpeg_httpcache_clear()
+    }
+
+    /// Cumulative counters of every cached HTTP input since launch.
+    public static var httpCacheStats: FFmpegHTTPCacheStats {
+        var stats = ffmpeg_httpcache_stats()
+        ffmpeg_httpcache_get_stats(&stats)
+        return FFmpegHTTPCacheStats(
+            requests: stats.requests,
+            fetchedBytes: stats.fetched_bytes,
+            memoryHitBytes: stats.memory_hit_bytes,
+            diskHitBytes: stats.disk_hit_bytes
+        )
+    }
+}
+
+/// Range requests for "shim:" HTTP inputs, made with URLSession from the FFmpeg I/O threads.
+///
+/// FFmpeg's own http protocol does not report ETag or Last-Modified to its caller, and its
+/// connections close with every run, so shim inputs reach the network through this fetcher. Its
+/// session is the process-wide keep-alive pool shared by every job.
+enum HTTPFetcher {
+    private static let sessionLock = NSLock()
+    private static var currentSession = makeSession(maximumConnectionsPerHost: 6)
+
+    static var session: URLSession {
+        sessionLock.lock()
+        defer { sessionLock.unlock() }
+        return currentSession
+    }
+
+    /// Replace the pool. Requests in flight finish on the old session, which then closes its connections.
+    static func resetSession(maximumConnectionsPerHost: Int) {
+        let replacement = makeSession(maximumConnectionsPerHost: maximumConnectionsPerHost)
+        sessionLock.lock()
+        let previous = currentSession
+        currentSession = replacement
+        sessionLock.unlock()
+        previous.finishTasksAndInvalidate()
+    }
+
+    private static func makeSession(maximumConnectionsPerHost: Int) -> URLSession {
+        let configuration = URLSessionConfiguration.ephemeral
+        configuration.requestCachePolicy = .reloadIgnoringLocalCacheData
+        configuration.urlCache = nil
+        configuration.httpMaximumConnectionsPerHost = maximumConnectionsPerHost
+        return URLSession(configuration: configuration, delegate: HTTPTransfers.shared, delegateQueue: nil)
+    }
+
+    private static let installed: Void = {
+        ffmpeg_http_set_fetcher { url, offset, length, buffer, resource in
+            guard let url = url, let resource = resource else { return Int64(-EINVAL) }
+            return HTTPFetcher.fetch(String(cString: url), offset: offset, length: length, into: buffer, resource: resource)
+        }
+    }()
+
+    static func install() {
+        _ = installed
+    }
+
+    private static let readsLock = NSLock()
+    /// URLs whose server answered a range request with the whole file.
+    private static var rangeIgnoringURLs = Set<String>()
+    private static var sequentialReads: [String: HTTPSequentialRead] = [:]
+    private static let maximumSequentialReads = 4
+
+    /// Blocking range request. Returns the bytes copied into `buffer`, or a negative errno value.
+    static func fetch(
+        _ urlString: String,
+        offset: Int64,
+        length: Int64,
+        into buffer: UnsafeMutableRawPointer?,
+        resource: UnsafeMutablePointer<ffmpeg_http_resource>
+    ) -> Int64 {
+        guard let url = URL(string: urlString) else { return Int64(-EINVAL) }
+        if length > 0, let read = sequentialRead(of: url, key: urlString, at: offset) {
+            let result = read.read(at: offset, length: Int(length), into: buffer)
+            if result <= 0 {
+                endSequentialRead(read, key: urlString)
+            }
+            return result
+        }
+
+        // Descriptions ask for the first byte rather than sending HEAD, which presigned URLs
+        // signed for GET answer with 403.
+        var request = URLRequest(url: url)
+        let last = length > 0 ? offset + length - 1 : offset
+        request.setValue("bytes=\(offset)-\(last)", forHTTPHeaderField: "Range")
+        let transfer = HTTPTransfer(offset: offset, length: Int(length))
+        let task = HTTPTransfers.shared.start(request, on: session, handler: transfer)
+        guard wait(for: transfer.done, cancelling: task) else { return Int64(-ECANCELED) }
+
+        guard transfer.error == nil, let response = transfer.response else { return Int64(-EIO) }
+        switch response.statusCode {
+        case 200, 206:
+            break
+        case 416:
+            return 0
+        case 401, 403:
+            return Int64(-EACCES)
+        case 404, 410:
+            return Int64(-ENOENT)
+        default:
+            return Int64(-EIO)
+        }
+        if response.statusCode == 200 {
+            // The server ignores ranges: later reads share one sequential download instead of
+            // fetching the whole file again for every chunk.
+            readsLock.lock()
+            rangeIgnoringURLs.insert(urlString)
+            readsLock.unlock()
+        }
+
+        describe(response, into: resource)
+        guard length > 0 else { return 0 }
+        let count = min(Int(length), transfer.body.count)
+        if let buffer = buffer, count > 0 {
+            transfer.body.copyBytes(to: buffer.assumingMemoryBound(to: UInt8.self), count: count)
+        }
+        return Int64(count)
+    }
+
+    /// Wait for `done`, cancelling `task` once the running job is cancelled. Returns false on cancel.
+    static func wait(for done: DispatchSemaphore, cancelling task: URLSessionTask) -> Bool {
+        while done.wait(timeout: .now() + .milliseconds(100)) == .timedOut {
+            if ffmpeg_cancel_requested() != 0 {
+                task.cancel()
+                return false
+            }
+        }
+        return true
+    }
+
+    /// The sequential download serving `offset` of a range-ignoring URL, restarted from the top
+    /// when the read lies behind it. Nil for servers that honour ranges.
+    private static func sequentialRead(of url: URL, key: String, at offset: Int64) -> HTTPSequentialRead? {
+        readsLock.lock()
+        defer { readsLock.unlock() }
+        guard rangeIgnoringURLs.contains(key) else { return nil }
+        if let read = sequentialReads[key], read.canRead(at: offset) {
+            return read
+        }
+        sequentialReads.removeValue(forKey: key)?.cancel()
+        if sequentialReads.count >= maximumSequentialReads, let oldest = sequentialReads.min(by: { $0.value.started < $1.value.started }) {
+            sequentialReads.removeValue(forKey: oldest.key)?.cancel()
+        }
+        let read = HTTPSequentialRead(url: url, session: session)
+        sequentialReads[key] = read
+        return read
+    }
+
+    private static func endSequentialRead(_ read: HTTPSequentialRead, key: String) {
+        readsLock.lock()
+        defer { readsLock.unlock() }
+        if sequentialReads[key] === read {
+            sequentialReads.removeValue(forKey: key)
+        }
+        read.cancel()
+    }
+
+    private static func describe(_ response: HTTPURLResponse, into resource: UnsafeMutablePointer<ffmpeg_http_resource>) {
+        resource.pointee.size = -1
+        if let range = response.value(forHTTPHeaderField: "Content-Range"),
+           let total = range.split(separator: "/").last.flatMap({ Int64($0) }) {
+            resource.pointee.size = total
+        } else if response.statusCode == 200 {
+            resource.pointee.size = response.expectedContentLength
+        }
+
+        let validator = response.value(forHTTPHeaderField: "ETag") ?? response.value(forHTTPHeaderField: "Last-Modified") ?? ""
+        withUnsafeMutableBytes(of: &resource.pointee.validator) { bytes in
+            let utf8 = Array(validator.utf8.prefix(bytes.count - 1))
+            bytes.copyBytes(from: utf8)
+            bytes[utf8.count] = 0
+        }
+    }
+}
+
+/// Callbacks of one data task of the fetcher's session, delivered on the session's delegate queue.
+protocol HTTPTransferHandler: AnyObject {
+    func received(_ response: HTTPURLResponse, on task: URLSessionDataTask) -> URLSession.ResponseDisposition
+    func received(_ data: Data, on task: URLSessionDataTask)
+    func completed(with error: Error?)
+}
+
+/// Session delegate of the fetcher. Streams each task's data to its handler, so a transfer can stop
+/// once it has what it asked for, and forwards metrics to `HTTPConnectionMetrics`.
+final class HTTPTransfers: NSObject, URLSessionDataDelegate {
+    static let shared = HTTPTransfers()
+
+    private let lock = NSLock()
+    private var handlers: [ObjectIdentifier: HTTPTransferHandler] = [:]
+
+    func start(_ request: URLRequest, on session: URLSession, handler: HTTPTransferHandler) -> URLSessionDataTask {
+        let task = session.dataTask(with: request)
+        lock.lock()
+        handlers[ObjectIdentifier(task)] = handler
+        lock.unlock()
+        task.resume()
+        return task
+    }
+
+    private func handler(of task: URLSessionTask, removing: Bool = false) -> HTTPTransferHandler? {
+        lock.lock()
+        defer { lock.unlock() }
+        return removing ? handlers.removeValue(forKey: ObjectIdentifier(task)) : handlers[ObjectIdentifier(task)]
+    }
+
+    func urlSession(
+        _ session: URLSession,
+        dataTask: URLSessionDataTask,
+        didReceive response: URLResponse,
+        completionHandler: @escaping (URLSession.ResponseDisposition) -> Void
+    ) {
+        guard let handler = handler(of: dataTask), let response = response as? HTTPURLResponse else {
+            completionHandler(.cancel)
+            return
+        }
+        completionHandler(handler.received(response, on: dataTask))
+    }
+
+    func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive data: Data) {
+        handler(of: dataTask)?.received(data, on: dataTask)
+    }
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didCompleteWithError error: Error?) {
+        handler(of: task, removing: true)?.completed(with: error)
+    }
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didFinishCollecting metrics: URLSessionTaskMetrics) {
+        HTTPConnectionMetrics.shared.urlSession(session, task: task, didFinishCollecting: metrics)
+    }
+}
+
+/// One range request of `length` bytes at `offset`; a `length` of 0 only describes the resource.
+/// When the server ignores the range, the body is skipped up to `offset` and the download stops
+/// after `length` bytes rather than running to the end of the file.
+final class HTTPTransfer: HTTPTransferHandler {
+    let done = DispatchSemaphore(value: 0)
+    private(set) var response: HTTPURLResponse?
+    private(set) var body = Data()
+    private(set) var error: Error?
+
+    private let length: Int
+    private var skip: Int64 = 0
+    private var stopped = false
+
+    init(offset: Int64, length: Int) {
+        self.skip = offset
+        self.length = length
+    }
+
+    func received(_ response: HTTPURLResponse, on task: URLSessionDataTask) -> URLSession.ResponseDisposition {
+        self.response = response
+        if response.statusCode != 200 {
+            skip = 0
+        }
+        // A description needs only the headers of a whole-file answer.
+        if length == 0 && response.statusCode == 200 {
+            stopped = true
+            return .cancel
+        }
+        return .allow
+    }
+
+    func received(_ data: Data, on task: URLSessionDataTask) {
+        var data = data
+        if skip > 0 {
+            let skipped = min(Int(skip), data.count)
+            data.removeFirst(skipped)
+            skip -= Int64(skipped)
+        }
+        body.append(data.prefix(max(0, max(length, 1) - body.count)))
+        if response?.statusCode == 200 && body.count >= length && skip == 0 {
+            stopped = true
+            task.cancel()
+        }
+    }
+
+    func completed(with error: Error?) {
+        self.error = stopped ? nil : error
+        done.signal()
+    }
+}
+
+/// One GET of a resource whose server ignores ranges, consumed in order by consecutive fetches.
+/// The download pauses while more than `maximumBuffer` bytes wait to be read.
+final class HTTPSequentialRead: HTTPTransferHandler {
+    private static let maximumBuffer = 8 << 20
+
+    let started = Date()
+    private let condition = NSCondition()
+    private var task: URLSessionDataTask?
+    /// Resource offset of the first buffered byte.
+    private var position: Int64 = 0
+    private var buffered = Data()
+    private var suspended = false
+    private var finished = false
+    private var failed = false
+    private var cancelled = false
+
+    init(url: URL, session: URLSession) {
+        task = HTTPTransfers.shared.start(URLRequest(url: url), on: session, handler: self)
+    }
+
+    func canRead(at offset: Int64) -> Bool {
+        condition.lock()
+        defer { condition.unlock() }
+        return offset >= position && !failed && !cancelled
+    }
+
+    func cancel() {
+        condition.lock()
+        cancelled = true
+        let task = self.task
+        condition.broadcast()
+        condition.unlock()
+        task?.cancel()
+    }
+
+    /// Copy up to `length` bytes at `offset` once they arrive. Returns 0 at the end of the resource,
+    /// or a negative errno value.
+    func read(at offset: Int64, length: Int, into buffer: UnsafeMutableRawPointer?) -> Int64 {
+        condition.lock()
+        defer { condition.unlock() }
+        while true {
+            guard offset >= position, !cancelled else { return Int64(-EIO) }
+            let skipped = min(Int(offset - position), buffered.count)
+            if skipped > 0 {
+                buffered.removeFirst(skipped)
+                position += Int64(skipped)
+            }
+            resumeIfDrained()
+            if offset == position && (buffered.count >= length || finished || failed) {
+                break
+            }
+            if ffmpeg_cancel_requested() != 0 {
+                task?.cancel()
+                return Int64(-ECANCELED)
+            }
+            condition.wait(until: Date(timeIntervalSinceNow: 0.1))
+        }
+        if failed && buffered.isEmpty {
+            return Int64(-EIO)
+        }
+        let count = min(length, buffered.count)
+        if let buffer = buffer, count > 0 {
+            buffered.copyBytes(to: buffer.assumingMemoryBound(to: UInt8.self), count: count)
+        }
+        buffered.removeFirst(count)
+        position += Int64(count)
+        resumeIfDrained()
+        return Int64(count)
+    }
+
+    private func resumeIfDrained() {
+        if suspended && buffered.count < Self.maximumBuffer / 2 {
+            suspended = false
+            task?.resume()
+        }
+    }
+
+    func received(_ response: HTTPURLResponse, on task: URLSessionDataTask) -> URLSession.ResponseDisposition {
+        guard response.statusCode == 200 else {
+            condition.lock()
+            failed = true
+            condition.broadcast()
+            condition.unlock()
+            return .cancel
+        }
+        return .allow
+    }
+
+    func received(_ data: Data, on task: URLSessionDataTask) {
+        condition.lock()
+        defer { condition.unlock() }
+        buffered.append(data)
+        if buffered.count > Self.maximumBuffer && !suspended {
+            suspended = true
+            task.suspend()
+        }
+        condition.broadcast()
+    }
+
+    func completed(with error: Error?) {
+        condition.lock()
+        defer { condition.unlock() }
+        if error == nil {
+            finished = true
+        } else {
+            failed = true
+        }
+        condition.broadcast()
+    }
+}
@@ -0,0 +1,111 @@
+import Foundation
+
+public struct FFmpegHTTPPoolStats {
+    /// Requests that went to the network through the pool.
+    public let requests: Int64
+    /// Requests sent on a connection that was already open.
+    public let reusedConnections: Int64
+    /// Time spent opening new connections, including TLS handshakes.
+    public let connectTime: TimeInterval
+
+    /// Fraction of requests that reused a pooled connection.
+    public var reuseRate: Double {
+        requests > 0 ? Double(reusedConnections) / Double(requests) : 0
+    }
+}
+
+extension SwiftFFmpeg {
+    private static let httpRoutingLock = NSLock()
+    private static var routesHTTPInputsEnabled = false
+
+    /// URL that reads the remote file at `url` over the shared keep-alive connection pool.
+    ///
+    /// FFmpeg's http protocol closes its connections when a run ends, so every job pays for new TCP
+    /// connections and TLS handshakes. This input reaches the network through a URLSession that lives
+    /// for the whole process instead: later jobs, and the range requests of seeks within one job, reuse
+    /// open connections to the same host. Reads are range requests that grow while reading sequentially.
+    public static func pooledHTTPInput(_ url: String) -> String {
+        HTTPFetcher.install()
+        return "shim:http/\(url)"
+    }
+
+    /// Read every `http`/`https` `-i` input of ffmpeg runs through `pooledHTTPInput(_:)`. Off by default.
+    ///
+    /// Playlists and manifests (HLS, DASH) are left to FFmpeg's http protocol, since their segments
+    /// would resolve against the `shim:` URL. So are inputs given http protocol options such as
+    /// `-headers`, `-user_agent`, `-cookies`, `-timeout` or `-reconnect`, which the pool does not send.
+    public static var routesHTTPInputs: Bool {
+        get {
+            httpRoutingLock.lock()
+            defer { httpRoutingLock.unlock() }
+            return routesHTTPInputsEnabled
+        }
+        set {
+            httpRoutingLock.lock()
+            routesHTTPInputsEnabled = newValue
+            httpRoutingLock.unlock()
+        }
+    }
+
+    /// Limit the pool to `maximumConnectionsPerHost` open connections per host. Replaces the pool, so
+    /// the next requests open new connections.
+    public static func configureHTTPConnectionPool(maximumConnectionsPerHost: Int) {
+        HTTPFetcher.resetSession(maximumConnectionsPerHost: max(1, maximumConnectionsPerHost))
+    }
+
+    /// Cumulative connection counters of the pool since launch.
+    public static var httpConnectionPoolStats: FFmpegHTTPPoolStats {
+        HTTPConnectionMetrics.shared.stats
+    }
+
+    /// Options of FFmpeg's http protocol that change the requests it sends.
+    private static let httpProtocolOptions: Set<String> = [
+        "headers", "user_agent", "user-agent", "referer", "cookies", "auth_type", "method",
+        "timeout", "rw_timeout", "http_proxy", "icy", "multiple_requests", "seekable",
+        "ca_file", "cert_file", "key_file", "tls_verify", "verifyhost"
+    ]
+
+    static func routingHTTPInputs(_ arguments: [String]) -> [String] {
+        var routed = arguments
+        for index in routed.indices.dropLast() where routed[index] == "-i" {
+            let input = routed[index + 1].lowercased()
+            guard input.hasPrefix("http://") || input.hasPrefix("https://") else { continue }
+            let options = inputOptions(in: routed, before: index)
+            guard !referencesOtherFiles(input, options: options),
+                  !options.contains(where: { httpProtocolOptions.contains(String($0.dropFirst())) || $0.hasPrefix("-reconnect") }) else {
+                continue
+            }
+            routed[index + 1] = pooledHTTPInput(routed[index + 1])
+        }
+        return routed
+    }
+}
+
+/// Session delegate that records whether each request of the pool reused a connection.
+final class HTTPConnectionMetrics: NSObject, URLSessionTaskDelegate {
+    static let shared = HTTPConnectionMetrics()
+
+    private let lock = NSLock()
+    private var requests: Int64 = 0
+    private var reused: Int64 = 0
+    private var connectTime: TimeInterval = 0
+
+    var stats: FFmpegHTTPPoolStats {
+        lock.lock()
+        defer { lock.unlock() }
+        return FFmpegHTTPPoolStats(requests: requests, reusedConnections: reused, connectTime: connectTime)
+    }
+
+    func urlSession(_ session: URLSession, task: URLSessionTask, didFinishCollecting metrics: URLSessionTaskMetrics) {
+        lock.lock()
+        defer { lock.unlock() }
+        for transaction in metrics.transactionMetrics where transaction.resourceFetchType == .networkLoad {
+            requests += 1
+            if transaction.isReusedConnection {
+                reused += 1
+            } else if let start = transaction.connectStartDate, let end = transaction.connectEndDate {
+                connectTime += end.timeIntervalSince(start)
+            }
+        }
+    }
+}
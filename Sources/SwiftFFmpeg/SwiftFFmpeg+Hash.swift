@@ -0,0 +1,124 @@
+import Foundation
+internal import CFFmpegCLI
+
+public struct FFmpegHashedExecution {
+    public let outputPath: String
+    /// SHA-256 over the SHA-256 digests of each 4 MiB block of the output, in order.
+    public let contentHash: String
+    /// SHA-256 of the whole file; `nil` when the muxer seeked while writing.
+    public let sha256: String?
+    /// SHA-256 of each output stream's encoded packets, keyed by output stream index.
+    public let streamHashes: [Int: String]
+    /// Bytes read back after muxing because the muxer rewrote them, e.g. a patched `mdat` size.
+    public let rehashedBytes: Int64
+    public let execution: FFmpegExecutionResult
+}
+
+extension SwiftFFmpeg {
+    /// Run ffmpeg and hash the output while it is written, so it never has to be read back in full.
+    ///
+    /// The output is written through the shim's hashing protocol. Blocks a muxer rewrites after
+    /// seeking back (a `moov` or `mdat` header patch, a faststart relocation) are marked dirty and
+    /// only those blocks are re-read when the file is closed, so `contentHash` is always the hash of
+    /// the final bytes. With `streamHashes` the packets are also fed to the `streamhash` muxer via
+    /// `tee`; when `arguments` contain no `-map`, the first input's video and audio are mapped.
+    ///
+    /// - Parameters:
+    ///   - arguments: Everything before the output path, e.g. `["-i", input, "-c", "copy"]`.
+    ///   - format: Output format; guessed from the output extension when `nil`.
+    ///   - muxerOptions: Options for the output muxer, e.g. `["movflags": "+faststart"]`.
+    public static func executeHashed(
+        _ arguments: [String],
+        to outputPath: String,
+        format: String? = nil,
+        muxerOptions: [String: String] = [:],
+        streamHashes: Bool = false
+    ) throws -> FFmpegHashedExecution {
+        let id = ffmpeg_hash_output_create(outputPath)
+        if id < 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: outputPath, errno: -id)
+        }
+
+        let name = "output." + ((outputPath as NSString).pathExtension.isEmpty
+            ? (format ?? "bin")
+            : (outputPath as NSString).pathExtension)
+        let hashURL = "shim:hash/\(id)/\(name)"
+        let sortedOptions = muxerOptions.sorted { $0.key < $1.key }
+
+        var runArguments = ["-y"] + arguments
+        if streamHashes {
+            if !arguments.contains("-map") {
+                runArguments += ["-map", "0:v?", "-map", "0:a?"]
+            }
+            var fileSlave = sortedOptions.map { "\($0.key)=\(teeEscaped($0.value))" }
+            if let format {
+                fileSlave.insert("f=\(format)", at: 0)
+            }
+            let slaves = [
+                (fileSlave.isEmpty ? "" : "[\(fileSlave.joined(separator: ":"))]") + hashURL,
+                "[f=streamhash:hash=sha256]pipe:1"
+            ]
+            runArguments += ["-f", "tee", slaves.joined(separator: "|")]
+        } else {
+            if let format {
+                runArguments += ["-f", format]
+            }
+            for option in sortedOptions {
+                runArguments += ["-\(option.key)", option.value]
+            }
+            runArguments.append(hashURL)
+        }
+
+        let execution: FFmpegExecutionResult
+        do {
+            execution = try executeDetailed(runArguments)
+        } catch {
+            _ = ffmpeg_hash_output_finish(id, nil)
+            throw error
+        }
+
+        var hash = ffmpeg_output_hash()
+        let code = ffmpeg_hash_output_finish(id, &hash)
+        if code < 0 {
+            throw SwiftFFmpegError.fileOperationFailed(path: outputPath, errno: -code)
+        }
+
+        let contentHash = withUnsafeBytes(of: hash.content_hash) { String(decoding: $0.prefix(64), as: UTF8.self) }
+        let sha256 = withUnsafeBytes(of: hash.sha256) { String(decoding: $0.prefix(64), as: UTF8.self) }
+
+        return FFmpegHashedExecution(
+            outputPath: outputPath,
+            contentHash: contentHash,
+            sha256: hash.sequential != 0 ? sha256 : nil,
+            streamHashes: streamHashes ? parseStreamHashes(execution.stdout) : [:],
+            rehashedBytes: hash.bytes_rehashed,
+            execution: execution
+        )
+    }
+
+    /// Parse `streamhash` lines of the form `0,v,SHA256=<hex>`.
+    private static func parseStreamHashes(_ output: String) -> [Int: String] {
+        var hashes: [Int: String] = [:]
+        for line in output.split(whereSeparator: \.isNewline) {
+            let fields = line.split(separator: ",")
+            guard fields.count == 3, let index = Int(fields[0]),
+                  let separator = fields[2].firstIndex(of: "=") else {
+                continue
+            }
+            hashes[index] = String(fields[2][fields[2].index(after: separator)...])
+        }
+        return hashes
+    }
+
+    /// Escape the characters the tee muxer treats as option separators.
+    private static func teeEscaped(_ value: String) -> String {
+        var escaped = ""
+        for character in value {
+            if ":|[]\\".contains(character) {
+                escaped.append("\\")
+            }
+            escaped.append(character)
+        }
+        return escaped
+    }
+}
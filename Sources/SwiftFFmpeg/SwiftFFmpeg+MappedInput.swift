@@ -0,0 +1,86 @@
+import Foundation
+
+extension SwiftFFmpeg {
+    private static let mappedInputLock = NSLock()
+    private static var mapsLocalInputsEnabled = false
+
+    /// Read every local `-i` file of ffmpeg runs through the shim's memory-mapped input.
+    ///
+    /// When enabled, `-i` values that name existing regular files are rewritten to `mappedInput(_:)`
+    /// URLs before execution. Network URLs, devices, image sequence patterns and ffprobe inputs are
+    /// left alone, and so are playlists and lists (HLS, DASH, concat, SDP) whose entries the demuxer
+    /// resolves relative to the input URL. Files modified in the last minute are not mapped either,
+    /// since another writer may still truncate them, which would crash the mapping reader with
+    /// SIGBUS. Off by default.
+    public static var mapsLocalInputs: Bool {
+        get {
+            mappedInputLock.lock()
+            defer { mappedInputLock.unlock() }
+            return mapsLocalInputsEnabled
+        }
+        set {
+            mappedInputLock.lock()
+            mapsLocalInputsEnabled = newValue
+            mappedInputLock.unlock()
+        }
+    }
+
+    /// URL that reads the local file at `path` from a read-only memory mapping.
+    ///
+    /// Demuxer refills become copies from the mapped pages instead of `read()` calls, and the pages
+    /// ahead of the read position are prefetched. The file must not be truncated while it is read:
+    /// that raises SIGBUS. Files the mapping fails for (address space limits) are read with `pread`.
+    public static func mappedInput(_ path: String) -> String {
+        let localPath = path.hasPrefix("file:") ? String(path.dropFirst(5)) : path
+        return "shim:mmap/" + URL(fileURLWithPath: localPath).standardizedFileURL.path
+    }
+
+    /// How long a file must have gone unmodified before it is mapped automatically.
+    static let mappedInputQuietPeriod: TimeInterval = 60
+
+    static func mappingLocalInputs(_ arguments: [String]) -> [String] {
+        var mapped = arguments
+        for index in mapped.indices.dropLast() where mapped[index] == "-i" {
+            let input = mapped[index + 1]
+            let path = input.hasPrefix("file:") ? String(input.dropFirst(5)) : input
+            guard !path.contains("://"), !path.hasPrefix("shim:"), !path.contains("%"),
+                  !referencesOtherFiles(input, options: inputOptions(in: mapped, before: index)) else {
+                continue
+            }
+
+            // A file truncated while mapped kills the process with SIGBUS, so files modified recently,
+            // which may still be being written or trimmed, are read with read() instead.
+            guard let attributes = try? FileManager.default.attributesOfItem(atPath: path),
+                  attributes[.type] as? FileAttributeType == .typeRegular,
+                  let modified = attributes[.modificationDate] as? Date,
+                  Date().timeIntervalSince(modified) > mappedInputQuietPeriod else {
+                continue
+            }
+            mapped[index + 1] = mappedInput(path)
+        }
+        return mapped
+    }
+
+    /// Demuxers that open further files named inside the input, relative to its URL.
+    private static let listFormats: Set<String> = ["concat", "hls", "applehttp", "dash", "sdp"]
+    private static let listExtensions: Set<String> = ["m3u8", "m3u", "mpd", "ffconcat", "concat", "sdp"]
+
+    /// Whether `input` is a playlist or list whose entries would break behind a `shim:` URL.
+    static func referencesOtherFiles(_ input: String, options: ArraySlice<String>) -> Bool {
+        if let format = zip(options, options.dropFirst()).last(where: { $0.0 == "-f" })?.1,
+           listFormats.contains(format.lowercased()) {
+            return true
+        }
+        let path = input.split(separator: "?").first.map(String.init) ?? input
+        return listExtensions.contains((path as NSString).pathExtension.lowercased())
+    }
+
+    /// Options given for the `-i` at `index`: the arguments after the previous input, or the start.
+    static func inputOptions(in arguments: [String], before index: Int) -> ArraySlice<String> {
+        var start = index
+        while start >= 2, arguments[start - 2] != "-i" {
+            start -= 1
+        }
+        return arguments[start..<index]
+    }
+}
@@ -0,0 +1,206 @@
+import Foundation
+internal import CFFmpegCLI
+
+public enum FFmpegMemoryPressure: Int, Comparable {
+    case normal = 0
+    case warning = 1
+    case critical = 2
+
+    public static func < (lhs: FFmpegMemoryPressure, rhs: FFmpegMemoryPressure) -> Bool {
+        lhs.rawValue < rhs.rawValue
+    }
+}
+
+/// What was done in response to one memory pressure signal.
+public struct FFmpegMemoryPressureResponse {
+    public let level: FFmpegMemoryPressure
+    /// Bytes each measure released, by measure name: `httpCache` (the HTTP range cache memory tier),
+    /// `memoryFiles` (`FFmpegMemoryFiles` contents moved to temporary files on disk at the critical
+    /// level), `probeCache` (probes kept by cost estimators) and every handler added with
+    /// `addMemoryPressureHandler(named:release:)`.
+    public let released: [String: Int]
+    /// Codec and filter threads for jobs started from now on, or `nil` for FFmpeg's automatic count.
+    /// Fewer threads keep fewer frames in flight.
+    public let threadBudget: Int?
+    /// Whether background jobs are held until pressure drops.
+    public let pausesBackgroundJobs: Bool
+    /// Change of the process memory footprint across the response; negative when memory went back
+    /// to the system. Freed memory the allocator keeps for reuse does not show here.
+    public let footprintChange: Int
+
+    public var totalReleased: Int {
+        released.values.reduce(0, +)
+    }
+}
+
+public struct FFmpegMemoryPressureStats {
+    public let signals: Int
+    public let httpCacheBytesReleased: Int64
+    /// Times a background job waited for pressure to clear.
+    public let backgroundPauses: Int
+    public let pausedTime: TimeInterval
+    /// Times a paused background job was cancelled and run again to let a waiting job in.
+    public let backgroundRequeues: Int
+    public let memoryFileBytesSpilled: Int64
+}
+
+extension SwiftFFmpeg {
+    private static let pressureLock = NSLock()
+    private static var pressureHandlers: [String: (FFmpegMemoryPressure) -> Int] = [:]
+    private static var pressureObserver: ((FFmpegMemoryPressureResponse) -> Void)?
+    #if canImport(Darwin)
+    private static var pressureSource: DispatchSourceMemoryPressure?
+    #endif
+
+    /// The memory pressure level in effect.
+    public static var memoryPressure: FFmpegMemoryPressure {
+        FFmpegMemoryPressure(rawValue: Int(ffmpeg_pressure_level())) ?? .normal
+    }
+
+    /// Called with every response, on the thread that delivered the signal.
+    public static var memoryPressureObserver: ((FFmpegMemoryPressureResponse) -> Void)? {
+        get {
+            pressureLock.lock()
+            defer { pressureLock.unlock() }
+            return pressureObserver
+        }
+        set {
+            pressureLock.lock()
+            pressureObserver = newValue
+            pressureLock.unlock()
+        }
+    }
+
+    /// Release app memory under pressure alongside the built-in measures. `release` is called when the
+    /// level rises above normal and returns the bytes it freed. A handler with the same name is replaced.
+    public static func addMemoryPressureHandler(named name: String, release: @escaping (FFmpegMemoryPressure) -> Int) {
+        pressureLock.lock()
+        pressureHandlers[name] = release
+        pressureLock.unlock()
+    }
+
+    public static func removeMemoryPressureHandler(named name: String) {
+        pressureLock.lock()
+        pressureHandlers[name] = nil
+        pressureLock.unlock()
+    }
+
+    /// Respond to the platform's memory pressure notifications: the dispatch memory pressure source
+    /// on Apple platforms, pressure stall information (`/proc/pressure/memory`) on Linux, where
+    /// `warning` and `critical` are the "some" and "full" avg10 percentages that trigger each level.
+    public static func startMemoryPressureMonitoring(warning: Double = 10, critical: Double = 5) throws {
+        #if canImport(Darwin)
+        pressureLock.lock()
+        defer { pressureLock.unlock() }
+        guard pressureSource == nil else { return }
+        let source = DispatchSource.makeMemoryPressureSource(eventMask: [.normal, .warning, .critical], queue: .global(qos: .utility))
+        source.setEventHandler { [weak source] in
+            guard let event = source?.data else { return }
+            let level: FFmpegMemoryPressure = event.contains(.critical) ? .critical : event.contains(.warning) ? .warning : .normal
+            respondToMemoryPressure(level)
+        }
+        source.resume()
+        pressureSource = source
+        #else
+        let result = ffmpeg_pressure_monitor_start(warning, critical, 1000) { level in
+            SwiftFFmpeg.respondToMemoryPressure(FFmpegMemoryPressure(rawValue: Int(level)) ?? .normal)
+        }
+        guard result == 0 || result == -EBUSY else {
+            throw SwiftFFmpegError.fileOperationFailed(path: "/proc/pressure/memory", errno: -result)
+        }
+        #endif
+    }
+
+    public static func stopMemoryPressureMonitoring() {
+        #if canImport(Darwin)
+        pressureLock.lock()
+        pressureSource?.cancel()
+        pressureSource = nil
+        pressureLock.unlock()
+        #else
+        ffmpeg_pressure_monitor_stop()
+        #endif
+    }
+
+    /// Deliver a pressure signal as if the platform had sent it, for tests and for apps with their own
+    /// pressure heuristics.
+    @discardableResult
+    public static func simulateMemoryPressure(_ level: FFmpegMemoryPressure) -> FFmpegMemoryPressureResponse {
+        respondToMemoryPressure(level)
+    }
+
+    /// Run a job that yields to memory pressure: it waits to start while pressure is critical, and a
+    /// running job blocks in its `shim:` reads and writes until pressure drops. Jobs reading plain
+    /// paths only pause at the start unless `mapsLocalInputs` routes them through the shim. Time spent
+    /// paused counts towards a deadline but not towards the stall timeout.
+    ///
+    /// Runs are serialized, so a paused job would hold up every job queued behind it. Instead, as soon
+    /// as another job is waiting, the paused job cancels itself and is run again from the start once
+    /// pressure drops, with a fresh deadline. Its outputs are rewritten, so an ffmpeg job must pass
+    /// `-y`, and no job may read an input that can only be read once (a `FFmpegFeed`, `pipe:`,
+    /// `fd:` or standard input); such argument lists throw `invalidArgument`.
+    public static func executeInBackground(_ arguments: [String], tool: FFmpegTool = .ffmpeg) throws -> FFmpegExecutionResult {
+        if tool == .ffmpeg && !arguments.contains("-y") {
+            throw SwiftFFmpegError.invalidArgument("background jobs may be restarted and need -y to overwrite their outputs")
+        }
+        // ffprobe takes its input positionally; ffmpeg's outputs may be "-" or pipes.
+        let inputs = tool == .ffprobe ? arguments : zip(arguments, arguments.dropFirst()).filter { $0.0 == "-i" }.map(\.1)
+        if let input = inputs.first(where: isOneShotInput) {
+            throw SwiftFFmpegError.invalidArgument("background jobs may be restarted and cannot read \(input) twice")
+        }
+        ffmpeg_set_job_background(1)
+        defer { ffmpeg_set_job_background(0) }
+        return try executeDetailed(arguments, tool: tool)
+    }
+
+    /// Whether an argument names a source that a restarted job could not read again.
+    private static func isOneShotInput(_ argument: String) -> Bool {
+        argument == "-" || argument.contains("shim:feed/") || argument.hasPrefix("pipe:") ||
+            argument.hasPrefix("fd:") || argument == "/dev/stdin"
+    }
+
+    /// Cumulative memory pressure counters since launch.
+    public static var memoryPressureStats: FFmpegMemoryPressureStats {
+        var stats = ffmpeg_pressure_stats()
+        ffmpeg_pressure_get_stats(&stats)
+        return FFmpegMemoryPressureStats(
+            signals: Int(stats.signals),
+            httpCacheBytesReleased: stats.httpcache_bytes_released,
+            backgroundPauses: Int(stats.background_pauses),
+            pausedTime: TimeInterval(stats.paused_us) / 1_000_000,
+            backgroundRequeues: Int(stats.background_requeues),
+            memoryFileBytesSpilled: stats.memfile_bytes_spilled
+        )
+    }
+
+    @discardableResult
+    private static func respondToMemoryPressure(_ level: FFmpegMemoryPressure) -> FFmpegMemoryPressureResponse {
+        let footprint = FFmpegCostEstimator.residentMemory()
+        var response = ffmpeg_pressure_response()
+        ffmpeg_pressure_signal(Int32(level.rawValue), &response)
+
+        var released = [
+            "httpCache": Int(response.httpcache_bytes_released),
+            "memoryFiles": Int(response.memfile_bytes_spilled)
+        ]
+        if level > .normal {
+            released["probeCache"] = FFmpegCostEstimator.releaseProbeCaches()
+            pressureLock.lock()
+            let handlers = pressureHandlers
+            pressureLock.unlock()
+            for (name, release) in handlers {
+                released[name] = max(release(level), 0)
+            }
+        }
+
+        let result = FFmpegMemoryPressureResponse(
+            level: level,
+            released: released,
+            threadBudget: response.thread_budget > 0 ? Int(response.thread_budget) : nil,
+            pausesBackgroundJobs: level == .critical,
+            footprintChange: Int(FFmpegCostEstimator.residentMemory() - footprint)
+        )
+        memoryPressureObserver?(result)
+        return result
+    }
+}
@@ -0,0 +1,86 @@
+import Foundation
+internal import CFFmpegCLI
+
+/// How a metadata edit was applied.
+public enum FFmpegMetadataEditPath {
+    /// Only the `moov` atom was rewritten; media data was not touched.
+    case inPlace
+    /// The container could not be patched in place and was remuxed with `-c copy`.
+    case rewritten
+}
+
+extension SwiftFFmpeg {
+    /// Change container metadata and display rotation of an MP4/MOV file.
+    ///
+    /// MP4 and MOV files are patched in place when the rebuilt `moov` atom fits into its old space
+    /// (including trailing `free` padding) or sits at the end of the file. The existing `udta/meta`
+    /// handler and its other children are kept. Anything else, including other containers, keys
+    /// without an iTunes atom mapping and QuickTime `mdta` metadata (a `keys` list rather than an
+    /// iTunes item list), falls back to a stream-copy remux that replaces the original file.
+    ///
+    /// On APFS, Btrfs and XFS the patch is applied to a copy-on-write clone that is then renamed over
+    /// the original, so an interrupted edit leaves the old file intact. Other file systems are patched
+    /// directly and synced; a crash during that write can damage the `moov` atom.
+    ///
+    /// - Parameters:
+    ///   - tags: Metadata using FFmpeg's key names (`title`, `artist`, `comment`, ...). An empty value removes the tag.
+    ///   - rotation: Clockwise display rotation in degrees (0, 90, 180 or 270), or `nil` to keep the current one.
+    @discardableResult
+    public static func editMetadata(
+        at path: String,
+        tags: [String: String] = [:],
+        rotation: Int? = nil
+    ) throws -> FFmpegMetadataEditPath {
+        if let rotation, ![0, 90, 180, 270].contains(rotation) {
+            throw SwiftFFmpegError.invalidArgument("rotation must be 0, 90, 180 or 270 degrees")
+        }
+
+        let keys = Array(tags.keys)
+        let cKeys: [UnsafeMutablePointer<CChar>?] = keys.map { strdup($0) }
+        let cValues: [UnsafeMutablePointer<CChar>?] = keys.map { strdup(tags[$0] ?? "") }
+        defer {
+            for ptr in cKeys + cValues {
+                free(ptr)
+            }
+        }
+
+        let code = ffmpeg_mp4_edit_metadata(
+            path,
+            cKeys.map { UnsafePointer($0) },
+            cValues.map { UnsafePointer($0) },
+            Int32(keys.count),
+            Int32(rotation ?? -1)
+        )
+
+        if code == 0 {
+            return .inPlace
+        }
+        if code != FFMPEG_MP4_EDIT_NEEDS_REWRITE && code != -EINVAL {
+            throw SwiftFFmpegError.fileOperationFailed(path: path, errno: -code)
+        }
+
+        try rewriteMetadata(at: path, tags: tags, rotation: rotation)
+        return .rewritten
+    }
+
+    private static func rewriteMetadata(at path: String, tags: [String: String], rotation: Int?) throws {
+        let source = URL(fileURLWithPath: path)
+        let temporary = source.deletingLastPathComponent()
+            .appendingPathComponent(".\(UUID().uuidString).\(source.pathExtension)")
+        defer { try? FileManager.default.removeItem(at: temporary) }
+
+        var arguments = ["-y"]
+        if let rotation {
+            // -display_rotation is counter-clockwise.
+            arguments += ["-display_rotation:v:0", String(-rotation)]
+        }
+        arguments += ["-i", path, "-map", "0", "-c", "copy", "-map_metadata", "0"]
+        for (key, value) in tags.sorted(by: { $0.key < $1.key }) {
+            arguments += ["-metadata", "\(key)=\(value)"]
+        }
+        arguments.append(temporary.path)
+
+        _ = try executeDetailed(arguments)
+        _ = try FileManager.default.replaceItemAt(source, withItemAt: temporary)
+    }
+}
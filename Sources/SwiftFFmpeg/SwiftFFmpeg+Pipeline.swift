@@ -0,0 +1,98 @@
+import Foundation
+
+public struct FFmpegPipelineStageResult {
+    public let execution: FFmpegExecutionResult
+    public let duration: TimeInterval
+    /// Size of the intermediate this stage wrote, or 0 for the last stage.
+    public let intermediateBytes: Int64
+    /// Bytes of that intermediate that went to a temporary file because memory was at its bound.
+    public let spilledBytes: Int64
+}
+
+public struct FFmpegPipelineResult {
+    public let stages: [FFmpegPipelineStageResult]
+    /// Largest amount of intermediate data held in memory at once.
+    public let peakIntermediateBytes: Int64
+}
+
+/// Multi-step ffmpeg jobs (for example extract → normalize → encode) joined by in-memory intermediates.
+///
+/// Each stage receives the URL it reads and the URL it writes. The first stage reads the pipeline's
+/// input, the last writes its output, and every other hand-off goes through a memory file, so no
+/// stage touches temporary files on disk. An intermediate is freed as soon as the stage reading it
+/// finishes, which keeps at most two of them alive.
+///
+/// Memory held by intermediates never exceeds `maximumIntermediateBytes`: an intermediate that would
+/// take the total past it continues in an unlinked temporary file in `spillDirectory`, which the
+/// next stage reads through the same URL.
+///
+/// fftools keeps its state in process globals and runs are serialized, so stages run one after
+/// another rather than concurrently. Steps that are only filters are better written as one stage with
+/// a longer filter chain: FFmpeg runs the decoder, filters and encoder of a single job in parallel.
+public struct FFmpegPipeline {
+    public typealias Stage = (_ input: String, _ output: String) -> [String]
+
+    private var stages: [(format: String, arguments: Stage)] = []
+
+    /// Bound on the memory held by the intermediates alive at once, or `nil` for no bound.
+    public var maximumIntermediateBytes: Int64? = 512 << 20
+    /// Where intermediates over the bound are written.
+    public var spillDirectory = FileManager.default.temporaryDirectory
+
+    public init() {}
+
+    /// A pipeline with `stage` appended. `intermediateFormat` is the file extension (and so the muxer)
+    /// of the memory file the stage writes when it is not the last one.
+    public func appending(intermediateFormat: String = "nut", _ stage: @escaping Stage) -> FFmpegPipeline {
+        var pipeline = self
+        pipeline.stages.append((intermediateFormat, stage))
+        return pipeline
+    }
+
+    /// Run every stage in order from `input` to `output`.
+    public func run(input: String, output: String) throws -> FFmpegPipelineResult {
+        guard !stages.isEmpty else {
+            throw SwiftFFmpegError.invalidArgument("pipeline has no stages")
+        }
+
+        var results: [FFmpegPipelineStageResult] = []
+        var peak: Int64 = 0
+        var reading: (files: FFmpegMemoryFiles, name: String)?
+        defer { reading?.files.release() }
+
+        for (index, stage) in stages.enumerated() {
+            let isLast = index == stages.count - 1
+            let stageInput = reading.map { $0.files.url($0.name) } ?? input
+            let writing = isLast ? nil : (files: try FFmpegMemoryFiles(), name: "stage\(index).\(stage.format)")
+            if let writing, let maximum = maximumIntermediateBytes {
+                // The intermediate being read is complete, so what it holds comes off the bound.
+                try writing.files.limitMemory(to: max(maximum - (reading?.files.bytesInUse ?? 0), 1), spillDirectory: spillDirectory)
+            }
+            let stageOutput = writing.map { $0.files.url($0.name) } ?? output
+
+            let started = Date()
+            let execution: FFmpegExecutionResult
+            do {
+                execution = try SwiftFFmpeg.executeDetailed(stage.arguments(stageInput, stageOutput))
+            } catch {
+                writing?.files.release()
+                throw error
+            }
+            let duration = Date().timeIntervalSince(started)
+
+            let held = writing.map { $0.files.bytesInUse } ?? 0
+            let spilled = writing.map { $0.files.spilledBytes } ?? 0
+            peak = max(peak, held + (reading?.files.bytesInUse ?? 0))
+            reading?.files.release()
+            reading = writing
+
+            results.append(FFmpegPipelineStageResult(
+                execution: execution,
+                duration: duration,
+                intermediateBytes: held + spilled,
+                spilledBytes: spilled
+            ))
+        }
+        return FFmpegPipelineResult(stages: results, peakIntermediateBytes: peak)
+    }
+}
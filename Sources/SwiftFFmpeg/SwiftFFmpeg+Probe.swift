@@ -0,0 +1,235 @@
+import Foundation
+
+/// Container and stream description decoded from `ffprobe -show_format -show_streams -of json`.
+public struct FFmpegMediaInfo: Decodable {
+    public struct Format: Decodable {
+        public let filename: String?
+        public let formatName: String?
+        public let duration: Double?
+        public let size: Int64?
+        public let bitRate: Int64?
+        public let tags: [String: String]
+
+        private enum CodingKeys: String, CodingKey {
+            case filename
+            case formatName = "format_name"
+            case duration
+            case size
+            case bitRate = "bit_rate"
+            case tags
+        }
+
+        public init(from decoder: Decoder) throws {
+            let container = try decoder.container(keyedBy: CodingKeys.self)
+            filename = try container.decodeIfPresent(String.self, forKey: .filename)
+            formatName = try container.decodeIfPresent(String.self, forKey: .formatName)
+            duration = container.decodeLossyDouble(forKey: .duration)
+            size = container.decodeLossyInt64(forKey: .size)
+            bitRate = container.decodeLossyInt64(forKey: .bitRate)
+            tags = (try? container.decodeIfPresent([String: String].self, forKey: .tags)) ?? [:]
+        }
+    }
+
+    public struct Stream: Decodable {
+        public let index: Int
+        public let codecType: String?
+        public let codecName: String?
+        public let profile: String?
+        public let width: Int?
+        public let height: Int?
+        public let pixelFormat: String?
+        public let sampleAspectRatio: String?
+        public let frameRate: String?
+        public let timeBase: String?
+        public let sampleRate: Int?
+        public let channels: Int?
+        public let channelLayout: String?
+        public let duration: Double?
+        public let frameCount: Int?
+        public let bitRate: Int64?
+        public let rotation: Double?
+        public let tags: [String: String]
+
+        public var isVideo: Bool { codecType == "video" }
+        public var isAudio: Bool { codecType == "audio" }
+
+        private enum CodingKeys: String, CodingKey {
+            case index
+            case codecType = "codec_type"
+            case codecName = "codec_name"
+            case profile
+            case width
+            case height
+            case pixelFormat = "pix_fmt"
+            case sampleAspectRatio = "sample_aspect_ratio"
+            case frameRate = "r_frame_rate"
+            case timeBase = "time_base"
+            case sampleRate = "sample_rate"
+            case channels
+            case channelLayout = "channel_layout"
+            case duration
+            case frameCount = "nb_frames"
+            case bitRate = "bit_rate"
+            case sideDataList = "side_data_list"
+            case tags
+        }
+
+        private struct SideData: Decodable {
+            let rotation: Double?
+        }
+
+        public init(from decoder: Decoder) throws {
+            let container = try decoder.container(keyedBy: CodingKeys.self)
+            index = try container.decode(Int.self, forKey: .index)
+            codecType = try container.decodeIfPresent(String.self, forKey: .codecType)
+            codecName = try container.decodeIfPresent(String.self, forKey: .codecName)
+            profile = try container.decodeIfPresent(String.self, forKey: .profile)
+            width = try container.decodeIfPresent(Int.self, forKey: .width)
+            height = try container.decodeIfPresent(Int.self, forKey: .height)
+            pixelFormat = try container.decodeIfPresent(String.self, forKey: .pixelFormat)
+            sampleAspectRatio = try container.decodeIfPresent(String.self, forKey: .sampleAspectRatio)
+            frameRate = try container.decodeIfPresent(String.self, forKey: .frameRate)
+            timeBase = try container.decodeIfPresent(String.self, forKey: .timeBase)
+            sampleRate = container.decodeLossyInt64(forKey: .sampleRate).map { Int($0) }
+            channels = try container.decodeIfPresent(Int.self, forKey: .channels)
+            channelLayout = try container.decodeIfPresent(String.self, forKey: .channelLayout)
+            duration = container.decodeLossyDouble(forKey: .duration)
+            frameCount = container.decodeLossyInt64(forKey: .frameCount).map { Int($0) }
+            bitRate = container.decodeLossyInt64(forKey: .bitRate)
+            tags = (try? container.decodeIfPresent([String: String].self, forKey: .tags)) ?? [:]
+
+            let sideData = (try? container.decodeIfPresent([SideData].self, forKey: .sideDataList)) ?? []
+            if let matrixRotation = sideData.compactMap(\.rotation).first {
+                rotation = matrixRotation
+            } else {
+                rotation = tags["rotate"].flatMap(Double.init)
+            }
+        }
+
+        /// Frame rate as a floating point value, parsed from the `num/den` form ffprobe reports.
+        public var framesPerSecond: Double? {
+            guard let frameRate else { return nil }
+            return FFmpegMediaInfo.parseRational(frameRate)
+        }
+    }
+
+    public let format: Format
+    public let streams: [Stream]
+
+    public var videoStreams: [Stream] { streams.filter(\.isVideo) }
+    public var audioStreams: [Stream] { streams.filter(\.isAudio) }
+
+    /// Best known duration in seconds: the container duration, else the longest stream.
+    public var duration: Double? {
+        format.duration ?? streams.compactMap(\.duration).max()
+    }
+
+    static func parseRational(_ value: String) -> Double? {
+        let parts = value.split(separator: "/")
+        if parts.count == 2, let num = Double(parts[0]), let den = Double(parts[1]) {
+            return den == 0 ? nil : num / den
+        }
+        return Double(value)
+    }
+}
+
+/// One demuxed packet of a single stream, read without decoding.
+struct FFmpegPacketIndexEntry {
+    let time: Double
+    let duration: Double?
+    let position: Int64?
+    let isKeyframe: Bool
+}
+
+extension SwiftFFmpeg {
+    /// Probe a media file with ffprobe and decode the format and stream description.
+    /// Concurrent probes of the same path share one ffprobe run.
+    public static func probe(_ path: String) throws -> FFmpegMediaInfo {
+        let result = try executeCoalesced(
+            ["-v", "error", "-show_format", "-show_streams", "-of", "json", path],
+            tool: .ffprobe
+        )
+        return try JSONDecoder().decode(FFmpegMediaInfo.self, from: Data(result.stdout.utf8))
+    }
+
+    /// List the packets of one stream (timestamps, byte positions, keyframe flags) by demuxing only.
+    ///
+    /// - Parameters:
+    ///   - stream: ffprobe stream specifier, `v:0` by default.
+    ///   - intervals: ffprobe `-read_intervals` specification. Each interval is reached by seeking, so
+    ///     only the packets inside the intervals are read. The whole file when nil.
+    ///   - expectedPackets: Sizing hint for the output capture; roughly 48 bytes are reserved per packet.
+    ///     A listing that fills the capture is run again with a larger one.
+    static func packetIndex(
+        of path: String,
+        stream: String = "v:0",
+        intervals: String? = nil,
+        expectedPackets: Int
+    ) throws -> [FFmpegPacketIndexEntry] {
+        var bufferSize = 64 * 1024 + max(expectedPackets, 0) * 48
+        var result: FFmpegExecutionResult
+        while true {
+            result = try executeDetailed(
+                ["-v", "error"] + (intervals.map { ["-read_intervals", $0] } ?? []) + [
+                    "-select_streams", stream,
+                    "-show_entries", "packet=pts_time,duration_time,pos,flags",
+                    "-of", "csv=p=0",
+                    path
+                ],
+                tool: .ffprobe,
+                outputBufferSize: bufferSize
+            )
+            // A capture filled to its last byte was cut short.
+            guard result.stdout.utf8.count >= bufferSize - 1, bufferSize < 1 << 30 else { break }
+            bufferSize *= 2
+        }
+
+        return result.stdout.split(whereSeparator: \.isNewline).compactMap { line in
+            let fields = line.split(separator: ",", omittingEmptySubsequences: false)
+            guard fields.count >= 4, let time = Double(fields[0]) else { return nil }
+            return FFmpegPacketIndexEntry(
+                time: time,
+                duration: Double(fields[1]),
+                position: Int64(fields[2]),
+                isKeyframe: fields[3].hasPrefix("K")
+            )
+        }
+    }
+}
+
+extension SwiftFFmpeg {
+    /// Mean spacing of the video keyframes in the first `window` seconds of `path`, from a packet
+    /// listing of that window only. Nil when it holds fewer than two keyframes.
+    static func estimatedKeyframeSpacing(of path: String, window: Double = 30, frameRate: Double) throws -> Double? {
+        let keyframes = try packetIndex(
+            of: path,
+            intervals: "%+\(String(format: "%.3f", window))",
+            expectedPackets: Int(window * max(frameRate, 1))
+        ).filter(\.isKeyframe).map(\.time).sorted()
+        guard let first = keyframes.first, let last = keyframes.last, keyframes.count >= 2 else { return nil }
+        return (last - first) / Double(keyframes.count - 1)
+    }
+}
+
+private extension KeyedDecodingContainer {
+    // ffprobe reports most numeric values as JSON strings.
+    func decodeLossyDouble(forKey key: Key) -> Double? {
+        if let value = try? decodeIfPresent(Double.self, forKey: key) {
+            return value
+        }
+        if let string = try? decodeIfPresent(String.self, forKey: key) {
+            return Double(string)
+        }
+        return nil
+    }
+
+    func decodeLossyInt64(forKey key: Key) -> Int64? {
+        if let value = try? decodeIfPresent(Int64.self, forKey: key) {
+            return value
+        }
+        if let string = try? decodeIfPresent(String.self, forKey: key) {
+            return Int64(string)
+        }
+        return nil
+    }
+}
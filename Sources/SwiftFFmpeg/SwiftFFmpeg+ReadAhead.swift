@@ -0,0 +1,44 @@
+import Foundation
+internal import CFFmpegCLI
+
+public struct FFmpegReadAheadStats {
+    /// Bytes read from sources by prefetch threads.
+    public let sourceBytes: Int64
+    /// Read requests prefetch threads made to sources.
+    public let sourceReads: Int64
+    /// Prefetched bytes dropped because the demuxer seeked elsewhere.
+    public let discardedBytes: Int64
+    /// Time demuxers spent waiting for data that had not been prefetched yet.
+    public let readerWait: TimeInterval
+}
+
+extension SwiftFFmpeg {
+    /// URL that reads `source` through a background prefetch buffer.
+    ///
+    /// A thread reads ahead of the demuxer into a ring buffer of `bufferSize` bytes, so slow or
+    /// network-mounted storage is read in large requests while decoding continues. Prefetching only
+    /// goes deep once reads are sequential; a seek outside the buffer cancels it and restarts at the
+    /// new position. `source` is a local path or another `shim:` URL.
+    public static func readAheadInput(_ source: String, bufferSize: Int = 8 << 20) -> String {
+        "shim:readahead/\(bufferSize)/\(source)"
+    }
+
+    /// Cumulative counters of every read-ahead input since launch.
+    public static var readAheadStats: FFmpegReadAheadStats {
+        var stats = ffmpeg_readahead_stats()
+        ffmpeg_readahead_get_stats(&stats)
+        return FFmpegReadAheadStats(
+            sourceBytes: stats.source_bytes,
+            sourceReads: stats.source_reads,
+            discardedBytes: stats.discarded_bytes,
+            readerWait: TimeInterval(stats.reader_wait_us) / 1_000_000
+        )
+    }
+
+    /// URL that reads `source` with a fixed delay per read plus transfer time at `bytesPerSecond`
+    /// (0 for unlimited). A stand-in for slow storage in tests; the kind is only enabled from here.
+    static func throttledInput(_ source: String, latency: TimeInterval, bytesPerSecond: Int = 0) -> String {
+        ffmpeg_io_enable_test_kinds()
+        return "shim:throttle/\(Int(latency * 1_000_000))/\(bytesPerSecond)/\(source)"
+    }
+}
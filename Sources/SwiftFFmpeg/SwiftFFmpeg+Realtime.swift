@@ -0,0 +1,186 @@
+import Foundation
+internal import CFFmpegCLI
+
+/// Latency-oriented settings for live transcoding, applied across demuxing, decoding, encoding and muxing.
+///
+/// Inputs are opened without probing buffers or demuxer buffering and decoded with slice threads
+/// only, since frame threading holds back one frame per thread. Encoders emit no B-frames, and
+/// VideoToolbox encoders run in real-time mode. Muxers flush every packet and interleave with at most
+/// `maximumInterleaveDelay` of queueing. The profile expects a single output as the last argument.
+public struct FFmpegRealtimeProfile {
+    /// Bytes the demuxer may read to detect stream parameters (32 is FFmpeg's minimum).
+    public var probeSize: Int = 32_768
+    /// Longest time the muxer may queue packets to interleave streams.
+    public var maximumInterleaveDelay: TimeInterval = 0.1
+
+    public init() {}
+
+    var inputOptions: [String] {
+        [
+            "-fflags", "+nobuffer",
+            "-flags", "low_delay",
+            "-probesize", String(max(32, probeSize)),
+            "-analyzeduration", "0",
+            "-thread_type", "slice"
+        ]
+    }
+
+    func outputOptions(for arguments: [String]) -> [String] {
+        var options = [
+            "-bf", "0",
+            "-flush_packets", "1",
+            "-muxdelay", "0",
+            "-muxpreload", "0",
+            "-max_interleave_delta", String(Int(maximumInterleaveDelay * 1_000_000))
+        ]
+        if arguments.contains(where: { $0.hasSuffix("_videotoolbox") }) {
+            options += ["-realtime", "1"]
+        }
+        return options
+    }
+
+    /// `arguments` with the profile's input options before every `-i` and output options before the output.
+    ///
+    /// Throws `invalidArgument` when the arguments already ask for something the profile rules out,
+    /// such as B-frames, encoder lookahead or frame threading.
+    public func applying(to arguments: [String]) throws -> [String] {
+        guard let output = arguments.last, arguments.count > 1 else {
+            throw SwiftFFmpegError.invalidArgument("real-time jobs need an output as the last argument")
+        }
+        let conflicts = Self.conflicts(in: arguments)
+        guard conflicts.isEmpty else {
+            throw SwiftFFmpegError.invalidArgument("not allowed in real-time jobs: \(conflicts.joined(separator: ", "))")
+        }
+
+        var applied: [String] = []
+        for argument in arguments.dropLast() {
+            if argument == "-i" {
+                applied += inputOptions
+            }
+            applied.append(argument)
+        }
+        return applied + outputOptions(for: arguments) + [output]
+    }
+
+    private static func conflicts(in arguments: [String]) -> [String] {
+        var conflicts: [String] = []
+        for (option, value) in zip(arguments, arguments.dropFirst()) {
+            let name = option.split(separator: ":").first.map(String.init) ?? option
+            switch name {
+            case "-bf" where value != "0",
+                 "-rc-lookahead" where value != "0",
+                 "-lookahead" where value != "0",
+                 "-thread_type" where value.contains("frame"),
+                 "-max_muxing_queue_size":
+                conflicts.append("\(option) \(value)")
+            default:
+                break
+            }
+        }
+        return conflicts
+    }
+}
+
+public struct FFmpegLatencyReport {
+    /// Latency of each video packet from the arrival of its source frame until it is handed to the
+    /// muxer, in muxing order. This is encode-side latency: the muxer's interleaving queue and output
+    /// writes come after the sample point and are not included.
+    public let frameLatencies: [TimeInterval]
+
+    public var median: TimeInterval { percentile(0.5) }
+    public var p95: TimeInterval { percentile(0.95) }
+    public var maximum: TimeInterval { frameLatencies.max() ?? 0 }
+
+    /// Latency below which `fraction` of the frames fall.
+    public func percentile(_ fraction: Double) -> TimeInterval {
+        guard !frameLatencies.isEmpty else { return 0 }
+        let sorted = frameLatencies.sorted()
+        let index = Int((Double(sorted.count - 1) * min(max(fraction, 0), 1)).rounded())
+        return sorted[index]
+    }
+}
+
+public struct FFmpegRealtimeExecution {
+    public let execution: FFmpegExecutionResult
+    /// Per-frame latency, when it was measured.
+    public let latency: FFmpegLatencyReport?
+}
+
+extension SwiftFFmpeg {
+    /// Run a live transcode with `profile` applied.
+    ///
+    /// With `measuringLatency`, input packets are timestamped with the wall clock as the demuxer reads
+    /// them and the timestamps are kept (`-copyts`, `-fps_mode passthrough`), and every video packet
+    /// is compared with the clock as it is handed to the muxer (`-stats_mux_pre`). The result is the
+    /// encode-side latency of each frame, from the moment the demuxer received it through decoding,
+    /// filtering and encoding. Time spent in the muxer's interleaving queue and in output writes is
+    /// not measured, so `maximumInterleaveDelay` and `-flush_packets` do not show in it; FFmpeg has no
+    /// per-packet report after `av_interleaved_write_frame`. This needs inputs that deliver
+    /// frames in real time (a live stream, a device, a lavfi graph ending in `realtime`) rather than
+    /// `-re`, which paces reads by the very timestamps being replaced. Output timestamps become
+    /// wall-clock based, so measure in test runs rather than for outputs that are kept.
+    public static func executeRealtime(
+        _ arguments: [String],
+        profile: FFmpegRealtimeProfile = FFmpegRealtimeProfile(),
+        measuringLatency: Bool = false
+    ) throws -> FFmpegRealtimeExecution {
+        let applied = try profile.applying(to: arguments)
+        guard measuringLatency else {
+            return FFmpegRealtimeExecution(execution: try executeDetailed(applied), latency: nil)
+        }
+        return try executeMeasuringLatency(applied)
+    }
+
+    /// Encode `duration` seconds of the lavfi `source`, released at its native frame rate like a live
+    /// capture, and report the encode-side latency of every frame. Without `profile`, FFmpeg's throughput-oriented
+    /// defaults are used, so running both shows what the profile saves.
+    public static func benchmarkRealtimeLatency(
+        source: String = "testsrc2=size=1280x720:rate=30",
+        duration: TimeInterval = 10,
+        encoderArguments: [String] = ["-c:v", "mpeg4", "-q:v", "5"],
+        profile: FFmpegRealtimeProfile?
+    ) throws -> FFmpegLatencyReport {
+        // The graph ends itself (-t would compare against wall-clock timestamps); millisecond
+        // timestamps keep encoders with limited time bases (mpeg4) usable.
+        let graph = "\(source),trim=duration=\(duration),settb=1/1000,realtime"
+        var arguments = ["-y", "-f", "lavfi", "-i", graph]
+        arguments += encoderArguments + ["-f", "mpegts", "/dev/null"]
+
+        let run = try profile.map { try executeRealtime(arguments, profile: $0, measuringLatency: true) }
+            ?? executeMeasuringLatency(arguments)
+        return run.latency ?? FFmpegLatencyReport(frameLatencies: [])
+    }
+
+    private static func executeMeasuringLatency(_ arguments: [String]) throws -> FFmpegRealtimeExecution {
+        try withLatencyProbe { probeURL in
+            var measured = ["-copyts"]
+            for argument in arguments.dropLast() {
+                if argument == "-i" {
+                    measured += ["-use_wallclock_as_timestamps", "1"]
+                }
+                measured.append(argument)
+            }
+            measured += ["-fps_mode", "passthrough"]
+            // Sampled before the muxer's interleaving queue: see `executeRealtime`.
+            measured += ["-stats_mux_pre:v:0", probeURL, "-stats_mux_pre_fmt:v:0", "{pts} {tb}"]
+            return try executeDetailed(measured + [arguments[arguments.count - 1]])
+        }
+    }
+
+    private static func withLatencyProbe(_ run: (String) throws -> FFmpegExecutionResult) throws -> FFmpegRealtimeExecution {
+        let probe = ffmpeg_latency_probe_create()
+        guard probe >= 0 else {
+            throw SwiftFFmpegError.invalidArgument("too many latency measurements in progress")
+        }
+        defer { ffmpeg_latency_probe_release(probe) }
+
+        let execution = try run("shim:latency/\(probe)")
+        let count = max(0, ffmpeg_latency_probe_samples(probe, nil, 0))
+        var samples = [Int64](repeating: 0, count: Int(count))
+        let copied = samples.withUnsafeMutableBufferPointer { buffer in
+            ffmpeg_latency_probe_samples(probe, buffer.baseAddress, Int64(buffer.count))
+        }
+        let latencies = samples.prefix(Int(max(0, min(copied, count)))).map { TimeInterval($0) / 1_000_000 }
+        return FFmpegRealtimeExecution(execution: execution, latency: FFmpegLatencyReport(frameLatencies: latencies))
+    }
+}
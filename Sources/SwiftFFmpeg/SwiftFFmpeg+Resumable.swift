@@ -0,0 +1,146 @@
+import Foundation
+
+public struct FFmpegResumableExportResult {
+    public let outputPath: String
+    public let segmentCount: Int
+    /// Media time the final run started from; 0 when nothing had been completed before.
+    public let resumedFrom: Double
+}
+
+extension SwiftFFmpeg {
+    /// Export `input` as independently valid segments that survive cancellation, then join them.
+    ///
+    /// Each run encodes with the segment muxer into `workDirectory`. The muxer appends a line to the
+    /// run's CSV segment list every time a segment is closed, and that list is the checkpoint journal:
+    /// it is still on disk if the app is suspended or killed. Calling this again with the same
+    /// arguments seeks to the end of the last journaled segment and continues numbering from there.
+    /// When the input is fully encoded the segments are joined by stream copy and the work
+    /// directory is removed. Changing the arguments discards previous progress.
+    ///
+    /// - Parameters:
+    ///   - arguments: Encoding arguments placed between the input and the output, e.g. `["-c:v", "h264_videotoolbox", "-b:v", "5M"]`.
+    ///   - segmentDuration: Seconds per segment; keyframes are forced on segment boundaries.
+    public static func exportResumable(
+        input: String,
+        to outputPath: String,
+        arguments: [String],
+        workDirectory: URL,
+        segmentDuration: Double = 10
+    ) throws -> FFmpegResumableExportResult {
+        let outputExtension = (outputPath as NSString).pathExtension.isEmpty
+            ? "mp4"
+            : (outputPath as NSString).pathExtension
+        let manifest = FFmpegResumableManifest(
+            input: input,
+            arguments: arguments,
+            segmentDuration: segmentDuration,
+            outputExtension: outputExtension
+        )
+        try manifest.prepare(workDirectory)
+
+        var segments = FFmpegResumableManifest.journaledSegments(in: workDirectory)
+        let resumeFrom = segments.last?.end ?? 0
+        let duration = try? probe(input).duration
+
+        if duration.map({ resumeFrom < $0 - 0.05 }) ?? true {
+            let runList = workDirectory.appendingPathComponent(
+                "run-\(Int((resumeFrom * 1000).rounded())).csv"
+            )
+            var runArguments = ["-y"]
+            if resumeFrom > 0 {
+                runArguments += ["-ss", String(resumeFrom)]
+            }
+            runArguments += ["-i", input] + arguments
+            runArguments += [
+                "-force_key_frames", "expr:gte(t,n_forced*\(segmentDuration))",
+                "-f", "segment",
+                "-segment_time", String(segmentDuration),
+                "-segment_format", outputExtension,
+                "-reset_timestamps", "1",
+                "-segment_start_number", String(segments.count),
+                "-segment_list", runList.path,
+                "-segment_list_type", "csv",
+                workDirectory.appendingPathComponent("segment-%05d.\(outputExtension)").path
+            ]
+            _ = try executeDetailed(runArguments)
+            segments = FFmpegResumableManifest.journaledSegments(in: workDirectory)
+        }
+
+        guard !segments.isEmpty else {
+            throw SwiftFFmpegError.invalidArgument("\(input) produced no segments")
+        }
+
+        _ = try executeDetailed([
+            "-y",
+            "-f", "concat", "-safe", "0",
+            "-i", FFmpegConcatList.dataURL(for: segments.map(\.path)),
+            "-map", "0",
+            "-c", "copy",
+            outputPath
+        ])
+        try? FileManager.default.removeItem(at: workDirectory)
+
+        return FFmpegResumableExportResult(
+            outputPath: outputPath,
+            segmentCount: segments.count,
+            resumedFrom: resumeFrom
+        )
+    }
+
+    /// Media seconds already journaled in `workDirectory` by an interrupted `exportResumable`.
+    public static func resumableProgress(in workDirectory: URL) -> Double {
+        FFmpegResumableManifest.journaledSegments(in: workDirectory).last?.end ?? 0
+    }
+}
+
+/// Identity of a resumable export; progress is only reused when it matches.
+struct FFmpegResumableManifest: Codable, Equatable {
+    struct Segment {
+        let path: String
+        let start: Double
+        let end: Double
+    }
+
+    let input: String
+    let arguments: [String]
+    let segmentDuration: Double
+    let outputExtension: String
+
+    func prepare(_ workDirectory: URL) throws {
+        let manifestURL = workDirectory.appendingPathComponent("manifest.json")
+        if let data = try? Data(contentsOf: manifestURL),
+           let existing = try? JSONDecoder().decode(FFmpegResumableManifest.self, from: data),
+           existing == self {
+            return
+        }
+        try? FileManager.default.removeItem(at: workDirectory)
+        try FileManager.default.createDirectory(at: workDirectory, withIntermediateDirectories: true)
+        try JSONEncoder().encode(self).write(to: manifestURL, options: .atomic)
+    }
+
+    /// Segments listed by every run's CSV journal, in media order, shifted by the run's start time.
+    /// Segment files that were still open when a run died are not listed and are ignored.
+    static func journaledSegments(in workDirectory: URL) -> [Segment] {
+        let runLists = (try? FileManager.default.contentsOfDirectory(atPath: workDirectory.path)) ?? []
+        var segments: [Segment] = []
+
+        for name in runLists where name.hasPrefix("run-") && name.hasSuffix(".csv") {
+            guard let startMillis = Int(name.dropFirst(4).dropLast(4)),
+                  let list = try? String(contentsOf: workDirectory.appendingPathComponent(name), encoding: .utf8) else {
+                continue
+            }
+            let runStart = Double(startMillis) / 1000
+            for line in list.split(whereSeparator: \.isNewline) {
+                let fields = line.split(separator: ",")
+                guard fields.count >= 3, let start = Double(fields[1]), let end = Double(fields[2]) else {
+                    continue
+                }
+                let path = workDirectory.appendingPathComponent(String(fields[0])).path
+                guard FileManager.default.fileExists(atPath: path), end > start else { continue }
+                segments.append(Segment(path: path, start: runStart + start, end: runStart + end))
+            }
+        }
+
+        return segments.sorted { $0.start < $1.start }
+    }
+}
@@ -0,0 +1,68 @@
+import Foundation
+
+/// What a retime does with the audio track.
+public enum FFmpegRetimeAudio: Equatable {
+    /// Leave audio out, keeping the job a pure remux.
+    case drop
+    /// Re-encode only the audio, time-stretched with `atempo` (pitch is preserved).
+    case tempo(encoderArguments: [String])
+
+    /// AAC at 128 kb/s.
+    public static let aac = FFmpegRetimeAudio.tempo(encoderArguments: ["-c:a", "aac", "-b:a", "128k"])
+}
+
+public struct FFmpegRetimeResult {
+    public let outputPath: String
+    /// Playback speed relative to the source; 2 plays twice as fast.
+    public let speed: Double
+    public let execution: FFmpegExecutionResult
+}
+
+extension SwiftFFmpeg {
+    /// Change the playback speed of `input` without re-encoding the video.
+    ///
+    /// Video packets are stream-copied with their timestamps scaled by `1 / speed` as they are demuxed
+    /// (`-itsscale`), so every frame, and every keyframe's position in the sequence, is kept and the job
+    /// costs about as much as a remux. The audio is dropped, or read a second time from `input` and
+    /// re-encoded alone through `atempo`. Frame rate changes with the speed: 30 fps played at 2x is
+    /// stored as 60 fps, so players and encoders downstream must accept the result.
+    public static func retime(
+        input: String,
+        to outputPath: String,
+        speed: Double,
+        audio: FFmpegRetimeAudio = .drop
+    ) throws -> FFmpegRetimeResult {
+        guard speed > 0, speed.isFinite else {
+            throw SwiftFFmpegError.invalidArgument("speed must be a positive number")
+        }
+
+        var arguments = ["-y", "-nostdin", "-itsscale:v:0", String(1 / speed), "-i", input]
+        switch audio {
+        case .drop:
+            arguments += ["-map", "0:v:0", "-an"]
+        case .tempo(let encoderArguments):
+            arguments += ["-i", input, "-map", "0:v:0", "-map", "1:a:0?"]
+            arguments += ["-filter:a", atempoChain(speed)] + encoderArguments
+        }
+        arguments += ["-map_metadata", "0", "-c:v", "copy", "-sn", "-dn", outputPath]
+
+        let execution = try executeDetailed(arguments)
+        return FFmpegRetimeResult(outputPath: outputPath, speed: speed, execution: execution)
+    }
+
+    /// `atempo` stages reaching `speed`, each within the 0.5–2 range every FFmpeg version accepts.
+    static func atempoChain(_ speed: Double) -> String {
+        var remaining = speed
+        var stages: [Double] = []
+        while remaining > 2 {
+            stages.append(2)
+            remaining /= 2
+        }
+        while remaining < 0.5 {
+            stages.append(0.5)
+            remaining /= 0.5
+        }
+        stages.append(remaining)
+        return stages.map { "atempo=\($0)" }.joined(separator: ",")
+    }
+}
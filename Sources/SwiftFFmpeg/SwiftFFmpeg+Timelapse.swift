@@ -0,0 +1,100 @@
+import Foundation
+
+/// How a timelapse reaches the source frames it keeps.
+public enum FFmpegTimelapseStrategy: Equatable {
+    /// Every frame is decoded; the decimation is too small to skip any.
+    case full
+    /// Non-reference frames (typically B-frames) are not decoded, since no other frame needs them.
+    case nonReference
+    /// Only keyframes are decoded, in one sequential pass.
+    case keyframes
+    /// One keyframe per output frame is reached by seeking; the media in between is not read.
+    case seekKeyframes
+}
+
+public struct FFmpegTimelapseResult {
+    public let outputPath: String
+    public let strategy: FFmpegTimelapseStrategy
+    /// Source seconds between consecutive output frames.
+    public let sourceFrameSpacing: Double
+    /// Average source seconds between keyframes in the first 30 seconds, when it was measured.
+    public let keyframeInterval: Double?
+    public let execution: FFmpegExecutionResult
+}
+
+extension SwiftFFmpeg {
+    /// Speed `input` up by `speedup` into a silent video at `frameRate`, decoding as few frames as the
+    /// decimation allows.
+    ///
+    /// An output frame is needed every `speedup / frameRate` source seconds. When that spacing is
+    /// several keyframe intervals, each output frame is the keyframe found by seeking (located by
+    /// listing packets near each needed time only); when it is at least one keyframe interval, only
+    /// keyframes are decoded (`-skip_frame nokey`); when it is at least two frames, non-reference
+    /// frames are skipped (`-skip_frame noref`); otherwise every frame is decoded. The keyframe
+    /// interval is measured on the first 30 seconds of the source. The larger the speedup, the smaller
+    /// the fraction of the source that is decoded. Keyframe strategies take the keyframe at or after
+    /// each needed time, so frame timing follows the source's keyframe placement.
+    public static func makeTimelapse(
+        input: String,
+        to outputPath: String,
+        speedup: Double,
+        frameRate: Double = 30,
+        encoderArguments: [String] = ["-c:v", "mpeg4", "-q:v", "3"]
+    ) throws -> FFmpegTimelapseResult {
+        guard speedup >= 1, frameRate > 0 else {
+            throw SwiftFFmpegError.invalidArgument("speedup must be at least 1 and frameRate positive")
+        }
+        let info = try probe(input)
+        guard let video = info.videoStreams.first else {
+            throw SwiftFFmpegError.invalidArgument("\(input) has no video stream")
+        }
+        let spacing = speedup / frameRate
+        let sourceFrameDuration = 1 / (video.framesPerSecond ?? 30)
+
+        // The strategy only needs the typical keyframe spacing, measured on the first 30 seconds.
+        var keyframeInterval: Double?
+        if spacing >= 2 * sourceFrameDuration {
+            keyframeInterval = try estimatedKeyframeSpacing(of: input, frameRate: video.framesPerSecond ?? 30)
+        }
+
+        let strategy: FFmpegTimelapseStrategy
+        if let interval = keyframeInterval, spacing >= 4 * interval {
+            strategy = .seekKeyframes
+        } else if let interval = keyframeInterval, spacing >= interval {
+            strategy = .keyframes
+        } else if spacing >= 2 * sourceFrameDuration {
+            strategy = .nonReference
+        } else {
+            strategy = .full
+        }
+
+        let rate = String(frameRate)
+        var arguments = ["-y", "-nostdin"]
+        switch strategy {
+        case .seekKeyframes:
+            // One concat entry per output frame, each ending just past its keyframe; output frames
+            // are then numbered at the target rate. Keyframes are listed only near each needed time.
+            let keyframes = try keyframeTimes(of: input, near: spacing, info: info, keyframeSpacing: keyframeInterval)
+            let entries = sampledKeyframes(keyframes, interval: spacing)
+                .map { FFmpegConcatList.Entry(path: input, inpoint: $0, outpoint: $0 + 0.001) }
+            arguments += ["-f", "concat", "-safe", "0", "-skip_frame", "nokey", "-i", FFmpegConcatList.dataURL(for: entries)]
+            arguments += ["-vf", "setpts=N/(\(rate)*TB)", "-fps_mode", "passthrough", "-r", rate]
+        case .keyframes, .nonReference, .full:
+            if strategy != .full {
+                arguments += ["-skip_frame", strategy == .keyframes ? "nokey" : "noref"]
+            }
+            arguments += ["-i", input]
+            arguments += ["-vf", "setpts=(PTS-STARTPTS)/\(speedup),fps=\(rate)"]
+        }
+        arguments += ["-map", "0:v:0", "-an", "-sn", "-dn"] + encoderArguments + [outputPath]
+
+        let execution = try executeDetailed(arguments)
+        return FFmpegTimelapseResult(
+            outputPath: outputPath,
+            strategy: strategy,
+            sourceFrameSpacing: spacing,
+            keyframeInterval: keyframeInterval,
+            execution: execution
+        )
+    }
+}
@@ -0,0 +1,138 @@
+import Foundation
+#if os(iOS) || os(tvOS) || os(watchOS)
+import os
+#endif
+
+/// Where pass 2 of a two-pass encode read its video frames from.
+public enum FFmpegTwoPassFrameSource: Equatable {
+    /// Frames decoded during pass 1 were kept in memory as raw video; the input was decoded once.
+    case cachedFrames(bytes: Int64)
+    /// The cache would have exceeded the limit, so pass 2 decoded the input again.
+    case redecodedInput
+}
+
+public struct FFmpegTwoPassResult {
+    public let outputPath: String
+    /// Video bit rate both passes targeted, in bits per second.
+    public let videoBitRate: Int
+    public let frameSource: FFmpegTwoPassFrameSource
+    public let execution: FFmpegExecutionResult
+}
+
+extension SwiftFFmpeg {
+    /// Encode `input` to roughly `targetBytes` with a two-pass video encode whose intermediates stay in memory.
+    ///
+    /// Pass 1 decodes the input once and, in the same run, writes the rate-control statistics, the final
+    /// audio, and (when the estimated raw size fits `frameCacheLimit`) the decoded frames to memory files.
+    /// Pass 2 runs immediately afterwards from the cached frames and copies the audio, so neither the
+    /// input decode nor the audio encode is repeated. Everything is freed when the call returns.
+    ///
+    /// Rate control comes from the encoder's `-pass` support, so `videoCodec` must be a two-pass capable
+    /// encoder in this build such as `mpeg4` or `mpeg2video`; VideoToolbox encoders are single pass.
+    ///
+    /// The intermediates are held to the limit: frames that outgrow the estimate, or memory pressure
+    /// of `warning` or above during the encode, move the cache to a temporary file, and pass 2 reads
+    /// it from there.
+    ///
+    /// - Parameters:
+    ///   - targetBytes: Desired output size; the video bit rate is derived from it after audio and ~1% muxing overhead.
+    ///   - frameCacheLimit: Largest raw frame cache to hold in memory, in bytes. Defaults to
+    ///     `defaultFrameCacheLimit`.
+    public static func encodeTwoPass(
+        input: String,
+        to outputPath: String,
+        targetBytes: Int64,
+        videoCodec: String = "mpeg4",
+        audioBitRate: Int = 128_000,
+        frameCacheLimit: Int64 = SwiftFFmpeg.defaultFrameCacheLimit
+    ) throws -> FFmpegTwoPassResult {
+        let info = try probe(input)
+        guard let video = info.videoStreams.first, let duration = info.duration, duration > 0 else {
+            throw SwiftFFmpegError.invalidArgument("\(input) has no video stream with a known duration")
+        }
+        let hasAudio = !info.audioStreams.isEmpty
+
+        let totalBitRate = Double(targetBytes) * 8 * 0.99 / duration
+        let videoBitRate = Int(totalBitRate) - (hasAudio ? audioBitRate : 0)
+        guard videoBitRate >= 16_000 else {
+            throw SwiftFFmpegError.invalidArgument("\(targetBytes) bytes is too small for \(duration) seconds")
+        }
+
+        let cacheBytes = estimatedRawVideoBytes(video, duration: duration)
+        let cacheFrames = cacheBytes.map { $0 <= frameCacheLimit } ?? false
+        let videoArguments = ["-c:v", videoCodec, "-b:v", String(videoBitRate)]
+
+        return try withMemoryFiles { files in
+            let audioBytes = hasAudio ? Int64(Double(audioBitRate) / 8 * duration * 1.1) : 0
+            try files.limitMemory(to: frameCacheLimit + audioBytes)
+            let handlerName = "encodeTwoPass.\(UUID().uuidString)"
+            addMemoryPressureHandler(named: handlerName) { level in
+                level >= .warning ? Int(files.spillToDisk()) : 0
+            }
+            defer { removeMemoryPressureHandler(named: handlerName) }
+
+            let passLog = files.passLogPrefix
+            let frames = files.url("frames.nut")
+            let audio = files.url("audio.nut")
+
+            var pass1 = ["-y", "-i", input, "-map", "0:v:0"] + videoArguments
+            pass1 += ["-pass", "1", "-passlogfile", passLog, "-an", "-f", "null", "-"]
+            if hasAudio {
+                pass1 += ["-map", "0:a:0", "-c:a", "aac", "-b:a", String(audioBitRate), "-vn", audio]
+            }
+            if cacheFrames {
+                pass1 += ["-map", "0:v:0", "-c:v", "rawvideo", "-an", frames]
+            }
+            _ = try executeDetailed(pass1)
+
+            var pass2 = ["-y", "-i", cacheFrames ? frames : input]
+            if hasAudio {
+                pass2 += ["-i", audio, "-map", "0:v:0", "-map", "1:a:0", "-c:a", "copy"]
+            } else {
+                pass2 += ["-map", "0:v:0"]
+            }
+            pass2 += videoArguments + ["-pass", "2", "-passlogfile", passLog, outputPath]
+            let execution = try executeDetailed(pass2)
+
+            return FFmpegTwoPassResult(
+                outputPath: outputPath,
+                videoBitRate: videoBitRate,
+                frameSource: cacheFrames ? .cachedFrames(bytes: files.size(of: "frames.nut") ?? 0) : .redecodedInput,
+                execution: execution
+            )
+        }
+    }
+
+    /// Default raw frame cache of `encodeTwoPass`: a quarter of the memory the process can still
+    /// allocate before the system terminates it (`os_proc_available_memory`) on iOS, tvOS and watchOS,
+    /// a sixteenth of physical memory elsewhere, and never more than 256 MiB.
+    public static var defaultFrameCacheLimit: Int64 {
+        let cap: Int64 = 256 << 20
+        #if os(iOS) || os(tvOS) || os(watchOS)
+        let available = Int64(os_proc_available_memory())
+        if available > 0 {
+            return min(available / 4, cap)
+        }
+        #endif
+        return min(Int64(ProcessInfo.processInfo.physicalMemory / 16), cap)
+    }
+
+    /// Size of the decoded frames of `stream` as raw video, or `nil` without dimensions.
+    private static func estimatedRawVideoBytes(_ stream: FFmpegMediaInfo.Stream, duration: Double) -> Int64? {
+        guard let width = stream.width, let height = stream.height else { return nil }
+        let pixelFormat = stream.pixelFormat ?? "yuv420p"
+
+        var bytesPerPixel = 1.5
+        if pixelFormat.contains("444") || pixelFormat.hasPrefix("rgb") || pixelFormat.hasPrefix("bgr") {
+            bytesPerPixel = 3
+        } else if pixelFormat.contains("422") {
+            bytesPerPixel = 2
+        }
+        if pixelFormat.contains("10") || pixelFormat.contains("12") || pixelFormat.contains("16") {
+            bytesPerPixel *= 2
+        }
+
+        let frameCount = stream.frameCount.map(Double.init) ?? duration * (stream.framesPerSecond ?? 30)
+        return Int64(Double(width * height) * bytesPerPixel * frameCount)
+    }
+}
@@ -0,0 +1,64 @@
+import Foundation
+internal import CFFmpegCLI
+
+/// Wall-clock and no-progress limits for a single ffmpeg or ffprobe run.
+///
+/// A run that exceeds `deadline`, or whose frame count, output size and output time all stay unchanged
+/// for `stallTimeout`, is cancelled and fails with a dedicated exit code, so a hung input or a
+/// pathological filter cannot hold the execution slot and block every queued job. The stall check uses
+/// ffmpeg's `-progress` reports, which are added to the arguments; it does not apply to ffprobe or to
+/// runs that already pass `-progress`.
+public struct FFmpegJobLimits {
+    /// Exit code of runs cancelled because `deadline` passed.
+    public static let deadlineExitCode = Int(FFMPEG_EXIT_DEADLINE_EXCEEDED)
+    /// Exit code of runs cancelled because progress stopped for `stallTimeout`.
+    public static let stallExitCode = Int(FFMPEG_EXIT_STALLED)
+
+    public var deadline: TimeInterval?
+    public var stallTimeout: TimeInterval?
+
+    public init(deadline: TimeInterval? = nil, stallTimeout: TimeInterval? = nil) {
+        self.deadline = deadline
+        self.stallTimeout = stallTimeout
+    }
+
+    var deadlineMicroseconds: Int64 {
+        deadline.map { Int64(max($0, 0.001) * 1_000_000) } ?? 0
+    }
+
+    var stallMicroseconds: Int64 {
+        stallTimeout.map { Int64(max($0, 0.001) * 1_000_000) } ?? 0
+    }
+
+    func applying(to arguments: [String], tool: FFmpegTool) -> [String] {
+        guard stallTimeout != nil, tool == .ffmpeg, !arguments.contains("-progress") else { return arguments }
+        return ["-progress", "shim:progress/watchdog"] + arguments
+    }
+}
+
+extension SwiftFFmpegError {
+    /// Whether the run was cancelled by `FFmpegJobLimits` rather than failing on its own.
+    public var isWatchdogCancellation: Bool {
+        guard case .executionFailed(let code, _, _) = self else { return false }
+        return code == FFmpegJobLimits.deadlineExitCode || code == FFmpegJobLimits.stallExitCode
+    }
+}
+
+extension SwiftFFmpeg {
+    private static let jobLimitsLock = NSLock()
+    private static var defaultJobLimitsValue: FFmpegJobLimits?
+
+    /// Limits applied to every run that does not pass its own. `nil` (the default) disables the watchdog.
+    public static var defaultJobLimits: FFmpegJobLimits? {
+        get {
+            jobLimitsLock.lock()
+            defer { jobLimitsLock.unlock() }
+            return defaultJobLimitsValue
+        }
+        set {
+            jobLimitsLock.lock()
+            defaultJobLimitsValue = newValue
+            jobLimitsLock.unlock()
+        }
+    }
+}
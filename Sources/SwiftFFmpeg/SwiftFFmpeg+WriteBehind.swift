@@ -0,0 +1,35 @@
+import Foundation
+internal import CFFmpegCLI
+
+public struct FFmpegWriteBehindStats {
+    /// Bytes applied to outputs by writer threads.
+    public let bytesWritten: Int64
+    /// Time muxers were blocked because an output's queue was over its budget.
+    public let stallTime: TimeInterval
+    /// Largest amount of data queued for a single output.
+    public let peakQueuedBytes: Int64
+}
+
+extension SwiftFFmpeg {
+    /// URL that writes `sink` from a background thread.
+    ///
+    /// Muxer writes are copied into a queue and return immediately; the muxer only waits for storage
+    /// when more than `budget` bytes are queued. Writes keep their offsets and are applied in order, so
+    /// muxers that seek back to patch headers produce the same file as a direct write, and a muxer that
+    /// reopens the output for reading (`+faststart`) sees everything queued before it. `sink` is a local
+    /// path or another `shim:` URL; use the returned URL as the output.
+    public static func writeBehindOutput(_ sink: String, budget: Int = 16 << 20) -> String {
+        "shim:writebehind/\(budget)/\(sink)"
+    }
+
+    /// Cumulative counters of every write-behind output since launch.
+    public static var writeBehindStats: FFmpegWriteBehindStats {
+        var stats = ffmpeg_writebehind_stats()
+        ffmpeg_writebehind_get_stats(&stats)
+        return FFmpegWriteBehindStats(
+            bytesWritten: stats.bytes_written,
+            stallTime: TimeInterval(stats.stall_us) / 1_000_000,
+            peakQueuedBytes: stats.peak_queued_bytes
+        )
+    }
+}
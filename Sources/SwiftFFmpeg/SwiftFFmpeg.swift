@@ -3,6 +3,8 @@ internal import CFFmpegCLI
 
 public enum SwiftFFmpegError: Error {
     case executionFailed(code: Int, stdout: String, stderr: String)
+    case invalidArgument(String)
+    case fileOperationFailed(path: String, errno: Int32)
 }
 
 public struct FFmpegExecutionResult {
@@ -84,14 +86,41 @@ public enum SwiftFFmpeg {
 
     /// Execute FFmpeg or ffprobe with separate stdout and stderr capture.
     public static func executeDetailed(_ arguments: [String], tool: FFmpegTool = .ffmpeg) throws -> FFmpegExecutionResult {
+        try executeDetailed(arguments, tool: tool, outputBufferSize: 64 * 1024)
+    }
+
+    /// Same as `executeDetailed(_:tool:)`, cancelling the run when it exceeds `limits`.
+    /// A run stopped by the watchdog throws `executionFailed` with `FFmpegJobLimits.deadlineExitCode`
+    /// or `FFmpegJobLimits.stallExitCode`.
+    public static func executeDetailed(_ arguments: [String], tool: FFmpegTool = .ffmpeg, limits: FFmpegJobLimits) throws -> FFmpegExecutionResult {
+        try executeDetailed(arguments, tool: tool, outputBufferSize: 64 * 1024, limits: limits)
+    }
+
+    /// Same as `executeDetailed(_:tool:)` with a caller-chosen capture size for stdout and stderr,
+    /// for commands such as packet listings whose output exceeds the default 64 KB.
+    static func executeDetailed(
+        _ arguments: [String],
+        tool: FFmpegTool,
+        outputBufferSize bufferSize: Int,
+        limits explicitLimits: FFmpegJobLimits? = nil
+    ) throws -> FFmpegExecutionResult {
         ffmpeg_clear_cancel()
 
         let programName = tool == .ffmpeg ? "ffmpeg" : "ffprobe"
-        let allArgs = [programName] + arguments
+        var toolArguments = tool == .ffmpeg && mapsLocalInputs ? mappingLocalInputs(arguments) : arguments
+        if routesHTTPInputs {
+            toolArguments = routingHTTPInputs(toolArguments)
+        }
+        let limits = explicitLimits ?? defaultJobLimits
+        if let limits {
+            toolArguments = limits.applying(to: toolArguments, tool: tool)
+        }
+        ffmpeg_set_job_limits(limits?.deadlineMicroseconds ?? 0, limits?.stallMicroseconds ?? 0)
+        defer { ffmpeg_set_job_limits(0, 0) }
+        let allArgs = [programName] + toolArguments
         var cArgs: [UnsafeMutablePointer<CChar>?] = allArgs.map { strdup($0) }
         let cArgsCopy = cArgs
 
-        let bufferSize = 64 * 1024
         let stdoutBuffer = UnsafeMutablePointer<CChar>.allocate(capacity: bufferSize)
         let stderrBuffer = UnsafeMutablePointer<CChar>.allocate(capacity: bufferSize)
 
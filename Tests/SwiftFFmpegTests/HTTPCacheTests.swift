@@ -0,0 +1,145 @@
+import Network
+import XCTest
+@testable import SwiftFFmpeg
+
+final class HTTPCacheTests: XCTestCase {
+    /// Minimal HTTP/1.1 origin that serves one file with Range and ETag, and counts requests and
+    /// connections. Like a URL presigned for GET, it answers HEAD with 403.
+    final class RangeServer {
+        let body: Data
+        let etag: String
+        let ignoresRanges: Bool
+        private let listener: NWListener
+        private let queue = DispatchQueue(label: "HTTPCacheTests.RangeServer")
+        private(set) var requestCount = 0
+        private(set) var servedBytes = 0
+        private(set) var connectionCount = 0
+
+        init(body: Data, etag: String = "\"test-1\"", ignoresRanges: Bool = false) throws {
+            self.body = body
+            self.etag = etag
+            self.ignoresRanges = ignoresRanges
+            listener = try NWListener(using: .tcp, on: .any)
+            let ready = DispatchSemaphore(value: 0)
+            listener.stateUpdateHandler = { state in
+                if case .ready = state { ready.signal() }
+            }
+            listener.newConnectionHandler = { [unowned self] connection in
+                self.connectionCount += 1
+                connection.start(queue: self.queue)
+                self.receive(on: connection, buffered: Data())
+            }
+            listener.start(queue: queue)
+            ready.wait()
+        }
+
+        var url: String {
+            "http://127.0.0.1:\(listener.port!.rawValue)/media.nut"
+        }
+
+        func stop() {
+            listener.cancel()
+        }
+
+        private func receive(on connection: NWConnection, buffered: Data) {
+            connection.receive(minimumIncompleteLength: 1, maximumLength: 65536) { [unowned self] data, _, isComplete, error in
+                var pending = buffered + (data ?? Data())
+                while let end = pending.range(of: Data("\r\n\r\n".utf8)) {
+                    let head = String(decoding: pending[..<end.lowerBound], as: UTF8.self)
+                    pending = pending[end.upperBound...]
+                    connection.send(content: self.respond(to: head), completion: .contentProcessed { _ in })
+                }
+                if isComplete || error != nil {
+                    connection.cancel()
+                } else {
+                    self.receive(on: connection, buffered: Data(pending))
+                }
+            }
+        }
+
+        private func respond(to head: String) -> Data {
+            requestCount += 1
+            let lines = head.components(separatedBy: "\r\n")
+            if lines.first?.hasPrefix("HEAD ") ?? false {
+                return Data("HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n\r\n".utf8)
+            }
+            var range = 0..<body.count
+            var status = "200 OK"
+            var headers = ["ETag: \(etag)", "Accept-Ranges: bytes"]
+
+            if !ignoresRanges, let line = lines.first(where: { $0.lowercased().hasPrefix("range: bytes=") }) {
+                let bounds = line.dropFirst("range: bytes=".count).split(separator: "-", omittingEmptySubsequences: false)
+                let start = Int(bounds[0]) ?? 0
+                let last = min(Int(bounds[1]) ?? body.count - 1, body.count - 1)
+                guard start < body.count else {
+                    return Data("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */\(body.count)\r\nContent-Length: 0\r\n\r\n".utf8)
+                }
+                range = start..<(last + 1)
+                status = "206 Partial Content"
+                headers.append("Content-Range: bytes \(start)-\(last)/\(body.count)")
+            }
+            headers.append("Content-Length: \(range.count)")
+
+            servedBytes += range.count
+            return Data("HTTP/1.1 \(status)\r\n\(headers.joined(separator: "\r\n"))\r\n\r\n".utf8) + body[range]
+        }
+    }
+
+    func testRepeatedJobsOnSameURLAreServedFromCache() throws {
+        let source = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).nut")
+        let cacheDirectory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+        defer {
+            try? FileManager.default.removeItem(at: source)
+            try? FileManager.default.removeItem(at: cacheDirectory)
+        }
+        _ = try SwiftFFmpeg.executeDetailed([
+            "-y",
+            "-f", "lavfi", "-i", "testsrc2=size=320x240:rate=25:duration=5",
+            "-c:v", "mpeg4", "-q:v", "4",
+            source.path
+        ])
+
+        let server = try RangeServer(body: Data(contentsOf: source))
+        defer { server.stop() }
+        try SwiftFFmpeg.configureHTTPCache(directory: cacheDirectory, memoryBytes: 1 << 20)
+        defer { SwiftFFmpeg.clearHTTPCache() }
+        let input = SwiftFFmpeg.cachedHTTPInput(server.url)
+
+        let copy = ["-y", "-i", input, "-map", "0", "-c", "copy", "-f", "null", "-"]
+        _ = try SwiftFFmpeg.executeDetailed(copy)
+        let firstRequests = server.requestCount
+        let firstBytes = server.servedBytes
+        // Opening the input revalidates by fetching its first byte.
+        XCTAssertEqual(firstBytes, server.body.count + 1, "every byte should be fetched exactly once")
+
+        let before = SwiftFFmpeg.httpCacheStats
+        _ = try SwiftFFmpeg.executeDetailed(copy)
+        let after = SwiftFFmpeg.httpCacheStats
+
+        // The second job only revalidates; its data comes from memory and disk.
+        XCTAssertEqual(server.servedBytes, firstBytes + 1)
+        XCTAssertEqual(server.requestCount, firstRequests + 1)
+        XCTAssertEqual(after.fetchedBytes, before.fetchedBytes)
+        XCTAssertGreaterThan(after.memoryHitBytes + after.diskHitBytes, before.memoryHitBytes + before.diskHitBytes)
+    }
+
+    func testServerIgnoringRangesIsReadSequentially() throws {
+        let source = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).nut")
+        defer { try? FileManager.default.removeItem(at: source) }
+        _ = try SwiftFFmpeg.executeDetailed([
+            "-y",
+            "-f", "lavfi", "-i", "testsrc2=size=640x360:rate=30:duration=10",
+            "-c:v", "mpeg4", "-q:v", "2",
+            source.path
+        ])
+
+        let server = try RangeServer(body: Data(contentsOf: source), ignoresRanges: true)
+        defer { server.stop() }
+        let result = try SwiftFFmpeg.executeDetailed(["-y", "-i", SwiftFFmpeg.pooledHTTPInput(server.url), "-map", "0", "-c", "copy", "-f", "null", "-"])
+        XCTAssertEqual(result.exitCode, 0)
+
+        // Growing range requests would cost a whole-file answer per chunk. After the first 200, reads
+        // share one download, restarted only when the demuxer seeks backwards.
+        XCTAssertLessThanOrEqual(server.requestCount, 6)
+    }
+}
@@ -0,0 +1,35 @@
+import XCTest
+@testable import SwiftFFmpeg
+
+final class HTTPConnectionPoolTests: XCTestCase {
+    func testJobsReusePooledConnections() throws {
+        let source = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).nut")
+        defer { try? FileManager.default.removeItem(at: source) }
+        _ = try SwiftFFmpeg.executeDetailed([
+            "-y",
+            "-f", "lavfi", "-i", "testsrc2=size=320x240:rate=25:duration=5",
+            "-c:v", "mpeg4", "-q:v", "4",
+            source.path
+        ])
+
+        let server = try HTTPCacheTests.RangeServer(body: Data(contentsOf: source))
+        defer { server.stop() }
+        SwiftFFmpeg.configureHTTPConnectionPool(maximumConnectionsPerHost: 2)
+
+        SwiftFFmpeg.routesHTTPInputs = true
+        defer { SwiftFFmpeg.routesHTTPInputs = false }
+
+        let before = SwiftFFmpeg.httpConnectionPoolStats
+        for _ in 0..<3 {
+            _ = try SwiftFFmpeg.executeDetailed(["-y", "-i", server.url, "-map", "0", "-c", "copy", "-f", "null", "-"])
+        }
+        let after = SwiftFFmpeg.httpConnectionPoolStats
+
+        let requests = after.requests - before.requests
+        let reused = after.reusedConnections - before.reusedConnections
+
+        XCTAssertEqual(Int64(server.requestCount), requests)
+        XCTAssertLessThanOrEqual(server.connectionCount, 2)
+        XCTAssertEqual(reused, requests - Int64(server.connectionCount))
+    }
+}
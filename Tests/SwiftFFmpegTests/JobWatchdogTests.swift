@@ -0,0 +1,66 @@
+import XCTest
+@testable import SwiftFFmpeg
+
+final class JobWatchdogTests: XCTestCase {
+    func testDeadlineCancelsLongRun() {
+        let started = Date()
+        XCTAssertThrowsError(try SwiftFFmpeg.executeDetailed(
+            ["-re", "-f", "lavfi", "-i", "testsrc2=size=160x120:rate=25", "-f", "null", "-"],
+            limits: FFmpegJobLimits(deadline: 1)
+        )) { error in
+            guard case SwiftFFmpegError.executionFailed(let code, _, _) = error else {
+                return XCTFail("unexpected error \(error)")
+            }
+            XCTAssertEqual(code, FFmpegJobLimits.deadlineExitCode)
+        }
+        XCTAssertLessThan(Date().timeIntervalSince(started), 10)
+    }
+
+    func testStalledInputIsCancelled() throws {
+        // A feed that never receives data stands in for a hung input.
+        let feed = try FFmpegFeed()
+        defer { feed.release() }
+
+        XCTAssertThrowsError(try SwiftFFmpeg.executeDetailed(
+            ["-f", "nut", "-i", feed.url, "-f", "null", "-"],
+            limits: FFmpegJobLimits(stallTimeout: 1)
+        )) { error in
+            guard case SwiftFFmpegError.executionFailed(let code, _, _) = error else {
+                return XCTFail("unexpected error \(error)")
+            }
+            XCTAssertEqual(code, FFmpegJobLimits.stallExitCode)
+            XCTAssertTrue((error as? SwiftFFmpegError)?.isWatchdogCancellation ?? false)
+        }
+    }
+
+    func testInputStallingMidTranscodeIsCancelled() throws {
+        let source = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).nut")
+        defer { try? FileManager.default.removeItem(at: source) }
+        _ = try SwiftFFmpeg.executeDetailed([
+            "-y",
+            "-f", "lavfi", "-i", "testsrc2=size=320x240:rate=25:duration=10",
+            "-c:v", "mpeg4", "-q:v", "5",
+            source.path
+        ])
+        let data = try Data(contentsOf: source)
+
+        // Half the file arrives, so transcoding is well under way when the producer goes quiet.
+        let feed = try FFmpegFeed()
+        defer { feed.release() }
+        DispatchQueue.global().async {
+            try? feed.write(data.prefix(data.count / 2))
+        }
+
+        let started = Date()
+        XCTAssertThrowsError(try SwiftFFmpeg.executeDetailed(
+            ["-f", "nut", "-i", feed.url, "-c:v", "mpeg4", "-f", "null", "-"],
+            limits: FFmpegJobLimits(stallTimeout: 1)
+        )) { error in
+            guard case SwiftFFmpegError.executionFailed(let code, _, _) = error else {
+                return XCTFail("unexpected error \(error)")
+            }
+            XCTAssertEqual(code, FFmpegJobLimits.stallExitCode)
+        }
+        XCTAssertLessThan(Date().timeIntervalSince(started), 10)
+    }
+}
@@ -0,0 +1,83 @@
+import XCTest
+@testable import SwiftFFmpeg
+
+final class MetadataEditTests: XCTestCase {
+    private func atom(_ type: String, _ payload: Data) -> Data {
+        var data = Data()
+        var size = UInt32(8 + payload.count).bigEndian
+        withUnsafeBytes(of: &size) { data.append(contentsOf: $0) }
+        data.append(contentsOf: Array(type.utf8))
+        data.append(payload)
+        return data
+    }
+
+    func testEditInPlaceUsesFreePaddingAndKeepsMediaData() throws {
+        let mediaData = Data(repeating: 0x55, count: 4096)
+        // Version 0 tkhd payload: identity matrix at offset 40, then 1920x1080 in 16.16 fixed point.
+        var tkhd = Data(count: 76)
+        tkhd.replaceSubrange(40..<44, with: [0, 1, 0, 0])
+        tkhd.replaceSubrange(56..<60, with: [0, 1, 0, 0])
+        tkhd.replaceSubrange(72..<76, with: [0x40, 0, 0, 0])
+        tkhd.append(contentsOf: [0x07, 0x80, 0, 0, 0x04, 0x38, 0, 0])
+
+        let moov = atom("moov", atom("mvhd", Data(count: 100)) + atom("trak", atom("tkhd", tkhd)))
+        let file = atom("ftyp", Data("isom\0\0\u{2}\0".utf8)) + moov +
+            atom("free", Data(count: 512)) + atom("mdat", mediaData)
+
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).mp4")
+        try file.write(to: url)
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        let path = try SwiftFFmpeg.editMetadata(at: url.path, tags: ["title": "Edited"], rotation: 90)
+        XCTAssertEqual(path, .inPlace)
+
+        let edited = try Data(contentsOf: url)
+        XCTAssertEqual(edited.count, file.count)
+        XCTAssertEqual(edited.suffix(mediaData.count), mediaData)
+        XCTAssertNotNil(edited.range(of: Data("Edited".utf8)))
+    }
+
+    func testEditInPlaceKeepsHandlerAndOtherMetaChildren() throws {
+        var hdlr = Data(count: 8)
+        hdlr.append(contentsOf: Array("mdir".utf8) + Array("appl".utf8))
+        hdlr.append(Data(count: 8))
+        hdlr.append(contentsOf: Array("Vendor handler\0".utf8))
+        let meta = atom("meta", Data(count: 4) + atom("hdlr", hdlr) + atom("xtra", Data("keep me".utf8)))
+        let moov = atom("moov", atom("mvhd", Data(count: 100)) + atom("udta", meta))
+        let file = atom("ftyp", Data("isom\0\0\u{2}\0".utf8)) + moov +
+            atom("free", Data(count: 512)) + atom("mdat", Data(repeating: 0x55, count: 4096))
+
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).mp4")
+        try file.write(to: url)
+        defer { try? FileManager.default.removeItem(at: url) }
+
+        let path = try SwiftFFmpeg.editMetadata(at: url.path, tags: ["title": "Edited"])
+        XCTAssertEqual(path, .inPlace)
+
+        let edited = try Data(contentsOf: url)
+        XCTAssertNotNil(edited.range(of: Data("Vendor handler".utf8)))
+        XCTAssertNotNil(edited.range(of: Data("keep me".utf8)))
+        XCTAssertNotNil(edited.range(of: Data("Edited".utf8)))
+    }
+
+    func testRotationShowsInProbedDisplayMatrix() throws {
+        let url = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).mp4")
+        defer { try? FileManager.default.removeItem(at: url) }
+        _ = try SwiftFFmpeg.executeDetailed([
+            "-y",
+            "-f", "lavfi", "-i", "testsrc2=size=320x240:rate=30:duration=1",
+            "-c:v", "mpeg4", "-q:v", "5",
+            url.path
+        ])
+
+        let path = try SwiftFFmpeg.editMetadata(at: url.path, tags: ["title": "Rotated"], rotation: 90)
+        XCTAssertEqual(path, .inPlace)
+
+        let info = try SwiftFFmpeg.probe(url.path)
+        let video = try XCTUnwrap(info.videoStreams.first)
+        // The display matrix holds the counterclockwise angle, so 90 degrees clockwise reads as -90.
+        XCTAssertEqual(video.rotation, -90)
+        XCTAssertEqual(video.width, 320)
+        XCTAssertEqual(info.format.tags["title"], "Rotated")
+    }
+}
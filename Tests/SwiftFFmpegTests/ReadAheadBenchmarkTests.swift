@@ -0,0 +1,32 @@
+import XCTest
+@testable import SwiftFFmpeg
+
+final class ReadAheadBenchmarkTests: XCTestCase {
+    func testReadAheadReadsSlowStorageInLargeRequests() throws {
+        let source = FileManager.default.temporaryDirectory.appendingPathComponent("\(UUID().uuidString).nut")
+        defer { try? FileManager.default.removeItem(at: source) }
+
+        _ = try SwiftFFmpeg.executeDetailed([
+            "-y",
+            "-f", "lavfi", "-i", "testsrc2=size=640x360:rate=30:duration=10",
+            "-c:v", "mpeg4", "-q:v", "2",
+            source.path
+        ])
+        let fileSize = try XCTUnwrap(FileManager.default.attributesOfItem(atPath: source.path)[.size] as? Int64)
+
+        // 2 ms per request stands in for a network-mounted volume.
+        let slowSource = SwiftFFmpeg.throttledInput(source.path, latency: 0.002)
+
+        let before = SwiftFFmpeg.readAheadStats
+        _ = try SwiftFFmpeg.executeDetailed(["-y", "-i", SwiftFFmpeg.readAheadInput(slowSource), "-map", "0", "-c", "copy", "-f", "null", "-"])
+        let after = SwiftFFmpeg.readAheadStats
+
+        let bytes = after.sourceBytes - before.sourceBytes
+        let reads = after.sourceReads - before.sourceReads
+        XCTAssertGreaterThanOrEqual(bytes, fileSize)
+        XCTAssertGreaterThan(reads, 0)
+        // The demuxer reads 32 KiB at a time; the prefetch thread reaches the source in chunks
+        // several times larger.
+        XCTAssertGreaterThanOrEqual(bytes / max(reads, 1), 64 << 10)
+    }
+}
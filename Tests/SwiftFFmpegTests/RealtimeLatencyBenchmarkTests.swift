@@ -0,0 +1,36 @@
+import XCTest
+@testable import SwiftFFmpeg
+
+final class RealtimeLatencyBenchmarkTests: XCTestCase {
+    func testProfileAppliesInputAndOutputOptions() throws {
+        var profile = FFmpegRealtimeProfile()
+        profile.maximumInterleaveDelay = 0.05
+        let applied = try profile.applying(to: ["-y", "-i", "in.ts", "-c:v", "mpeg4", "out.ts"])
+
+        let input = try XCTUnwrap(applied.firstIndex(of: "-i"))
+        XCTAssertEqual(Array(applied[..<input].suffix(profile.inputOptions.count)), profile.inputOptions)
+        XCTAssertEqual(applied.last, "out.ts")
+        XCTAssertEqual(Array(applied.dropLast().suffix(10)), [
+            "-bf", "0",
+            "-flush_packets", "1",
+            "-muxdelay", "0",
+            "-muxpreload", "0",
+            "-max_interleave_delta", "50000"
+        ])
+    }
+
+    func testBenchmarkRecordsEveryFrame() throws {
+        let report = try SwiftFFmpeg.benchmarkRealtimeLatency(duration: 5, profile: FFmpegRealtimeProfile())
+
+        // 5 s at 30 fps, allowing for frames still queued when the graph ends.
+        XCTAssertGreaterThan(report.frameLatencies.count, 100)
+        XCTAssertLessThanOrEqual(report.frameLatencies.count, 150)
+        XCTAssertTrue(report.frameLatencies.allSatisfy { $0 >= 0 })
+        XCTAssertLessThanOrEqual(report.median, report.p95)
+        XCTAssertLessThanOrEqual(report.p95, report.maximum)
+    }
+
+    func testProfileRejectsBFrames() {
+        XCTAssertThrowsError(try FFmpegRealtimeProfile().applying(to: ["-i", "in.ts", "-c:v", "mpeg4", "-bf", "2", "out.ts"]))
+    }
+}